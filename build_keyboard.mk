@@ -104,6 +104,9 @@ else
     $(error "$(MAIN_KEYMAP_C)/keymap.c" does not exist)
 endif
 
+# The keyboard rules that depend on options the keymap can set
+-include $(KEYBOARD_PATH)/post_rules.mk
+
 
 # Object files directory
 #     To put object files in current directory, use a dot (.), do NOT make
@@ -143,9 +146,16 @@ endif
 ifeq ($(strip $(AUDIO_ENABLE)), yes)
     OPT_DEFS += -DAUDIO_ENABLE
 	SRC += $(QUANTUM_DIR)/process_keycode/process_music.c
-	SRC += $(QUANTUM_DIR)/audio/audio.c
-	SRC += $(QUANTUM_DIR)/audio/voices.c
-	SRC += $(QUANTUM_DIR)/audio/luts.c
+	SRC += $(QUANTUM_DIR)/audio/song_list.c
+	ifeq ($(PLATFORM),CHIBIOS)
+		SRC += $(QUANTUM_DIR)/audio/audio_arm.c
+		SRC += $(QUANTUM_DIR)/audio/audio_mixer.c
+	else
+		SRC += $(QUANTUM_DIR)/audio/audio.c
+		SRC += $(QUANTUM_DIR)/audio/audio_engine.c
+		SRC += $(QUANTUM_DIR)/audio/voices.c
+		SRC += $(QUANTUM_DIR)/audio/luts.c
+	endif
 endif
 
 ifeq ($(strip $(UCIS_ENABLE)), yes)
@@ -161,7 +171,15 @@ endif
 ifeq ($(strip $(RGBLIGHT_ENABLE)), yes)
 	OPT_DEFS += -DRGBLIGHT_ENABLE
 	SRC += $(QUANTUM_DIR)/light_ws2812.c
+	SRC += $(QUANTUM_DIR)/color.c
 	SRC += $(QUANTUM_DIR)/rgblight.c
+	SRC += $(QUANTUM_DIR)/rgblight_reactive.c
+endif
+
+ifeq ($(strip $(WS2812_SPI_ENABLE)), yes)
+	OPT_DEFS += -DWS2812_SPI_ENABLE
+	SRC += $(QUANTUM_DIR)/ws2812_encode.c
+	SRC += $(QUANTUM_DIR)/ws2812_spi.c
 endif
 
 ifeq ($(strip $(TAP_DANCE_ENABLE)), yes)
@@ -169,6 +187,11 @@ ifeq ($(strip $(TAP_DANCE_ENABLE)), yes)
 	SRC += $(QUANTUM_DIR)/process_keycode/process_tap_dance.c
 endif
 
+ifeq ($(strip $(DYNAMIC_KEYMAP_ENABLE)), yes)
+	OPT_DEFS += -DDYNAMIC_KEYMAP_ENABLE
+	SRC += $(QUANTUM_DIR)/dynamic_keymap.c
+endif
+
 ifeq ($(strip $(SERIAL_LINK_ENABLE)), yes)
 	SRC += $(patsubst $(QUANTUM_PATH)/%,%,$(SERIAL_SRC))
 	OPT_DEFS += $(SERIAL_DEFS)
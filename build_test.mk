@@ -43,6 +43,11 @@ VPATH += $(COMMON_VPATH)
 
 include $(TMK_PATH)/common.mk
 include $(QUANTUM_PATH)/serial_link/tests/rules.mk
+include $(TMK_PATH)/common/chibios/tests/rules.mk
+include $(TMK_PATH)/common/tests/rules.mk
+include $(QUANTUM_PATH)/tests/rules.mk
+include $(QUANTUM_PATH)/audio/tests/rules.mk
+include $(QUANTUM_PATH)/visualizer/tests/rules.mk
 
 $(TEST_OBJ)/$(TEST)_SRC := $($(TEST)_SRC)
 $(TEST_OBJ)/$(TEST)_INC := $($(TEST)_INC) $(VPATH) $(GTEST_INC)
@@ -35,6 +35,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "matrix.h"
 #include "ez.h"
 #include "i2cmaster.h"
+#include "i2c_async.h"
 #ifdef DEBUG_MATRIX_SCAN_RATE
 #include  "timer.h"
 #endif
@@ -43,8 +44,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
  * This constant define not debouncing time in msecs, but amount of matrix
  * scan loops which should be made to get stable debounced results.
  *
- * On Ergodox matrix scan rate is relatively low, because of slow I2C.
- * Now it's only 317 scans/second, or about 3.15 msec/scan.
+ * On Ergodox matrix scan rate used to be relatively low, because of slow I2C.
+ * It was only 317 scans/second, or about 3.15 msec/scan. The left half is
+ * now read in the background, so the scan no longer waits for I2C, but the
+ * left half rows still only change once per completed I2C read.
  * According to Cherry specs, debouncing time is 5 msec.
  *
  * And so, there is no sense to have DEBOUNCE higher than 2.
@@ -66,6 +69,47 @@ static void select_row(uint8_t row);
 
 static uint8_t mcp23018_reset_loop;
 
+/* MCP23018 transactions
+ *
+ * The left half is read in batches, each batch selects a row, reads the
+ * columns of that row, and so on for all seven rows, and finally unselects
+ * the rows. A batch is queued in one go and runs on the TWI interrupt while
+ * the right half is scanned. Its result is collected by the first scan that
+ * finds the bus idle, which then queues the next batch.
+ *
+ * The select and the read are separate transactions, so that the stop and
+ * the register write of the read give the row at least 30us to settle.
+ */
+#define MCP23018_ROWS 7
+#define MCP23018_TRANSACTIONS (MCP23018_ROWS * 2 + 1)
+
+#if MCP23018_TRANSACTIONS >= I2C_ASYNC_QUEUE_SIZE
+#   error "I2C_ASYNC_QUEUE_SIZE is too small for a batch of MCP23018 reads"
+#endif
+
+static const uint8_t mcp23018_gpiob = GPIOB;
+static const uint8_t mcp23018_unselect[2] = { GPIOA, 0xFF & ~(0<<7) };
+static uint8_t mcp23018_select[MCP23018_ROWS][2];
+static uint8_t mcp23018_cols[MCP23018_ROWS];
+static i2c_async_transaction_t mcp23018_batch[MCP23018_TRANSACTIONS];
+static bool mcp23018_scanning;
+
+// Same as init_mcp23018(), but without blocking the scan when the left half
+// isn't there
+static const uint8_t mcp23018_iodir[3] = { IODIRA, 0b00000000, 0b00111111 };
+static const uint8_t mcp23018_gppu[3] = { GPPUA, 0b00000000, 0b00111111 };
+static i2c_async_transaction_t mcp23018_reset[2];
+static bool mcp23018_resetting;
+
+// Columns of the left half, as of the last completed batch
+static matrix_row_t left_cols[MCP23018_ROWS];
+
+static void mcp23018_init_transactions(void);
+static void mcp23018_start_batch(void);
+static void mcp23018_collect_batch(void);
+static void mcp23018_start_reset(void);
+static uint8_t mcp23018_reset_status(void);
+
 #ifdef DEBUG_MATRIX_SCAN_RATE
 uint32_t matrix_timer;
 uint32_t matrix_scan_count;
@@ -105,6 +149,7 @@ void matrix_init(void)
     // initialize row and col
 
     mcp23018_status = init_mcp23018();
+    mcp23018_init_transactions();
 
 
     unselect_rows();
@@ -126,6 +171,12 @@ void matrix_init(void)
 }
 
 void matrix_power_up(void) {
+    // the blocking driver can't be used while a batch is in flight
+    while (i2c_async_busy()) {
+        i2c_async_task();
+    }
+    mcp23018_scanning = false;
+    mcp23018_resetting = false;
     mcp23018_status = init_mcp23018();
 
     unselect_rows();
@@ -146,12 +197,11 @@ void matrix_power_up(void) {
 
 uint8_t matrix_scan(void)
 {
-    if (mcp23018_status) { // if there was an error
-        if (++mcp23018_reset_loop == 0) {
-            // since mcp23018_reset_loop is 8 bit - we'll try to reset once in 255 matrix scans
-            // this will be approx bit more frequent than once per second
-            print("trying to reset mcp23018\n");
-            mcp23018_status = init_mcp23018();
+    i2c_async_task();
+    if (!i2c_async_busy()) {
+        if (mcp23018_resetting) {
+            mcp23018_resetting = false;
+            mcp23018_status = mcp23018_reset_status();
             if (mcp23018_status) {
                 print("left side not responding\n");
             } else {
@@ -159,6 +209,19 @@ uint8_t matrix_scan(void)
                 ergodox_blink_all_leds();
             }
         }
+        if (mcp23018_scanning) {
+            mcp23018_collect_batch();
+        }
+        if (mcp23018_status) { // if there was an error
+            if (++mcp23018_reset_loop == 0) {
+                // since mcp23018_reset_loop is 8 bit - we'll try to reset once in 255 matrix scans
+                // this will be approx bit more frequent than once per second
+                print("trying to reset mcp23018\n");
+                mcp23018_start_reset();
+            }
+        } else {
+            mcp23018_start_batch();
+        }
     }
 
 #ifdef DEBUG_MATRIX_SCAN_RATE
@@ -176,8 +239,10 @@ uint8_t matrix_scan(void)
 #endif
 
     for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
-        select_row(i);
-        wait_us(30);  // without this wait read unstable value.
+        if (i >= MCP23018_ROWS) {
+            select_row(i);
+            wait_us(30);  // without this wait read unstable value.
+        }
         matrix_row_t cols = read_cols(i);
         if (matrix_debouncing[i] != cols) {
             matrix_debouncing[i] = cols;
@@ -186,7 +251,9 @@ uint8_t matrix_scan(void)
             }
             debouncing = DEBOUNCE;
         }
-        unselect_rows();
+        if (i >= MCP23018_ROWS) {
+            unselect_rows();
+        }
     }
 
     if (debouncing) {
@@ -269,15 +336,8 @@ static matrix_row_t read_cols(uint8_t row)
         if (mcp23018_status) { // if there was an error
             return 0;
         } else {
-            uint8_t data = 0;
-            mcp23018_status = i2c_start(I2C_ADDR_WRITE);    if (mcp23018_status) goto out;
-            mcp23018_status = i2c_write(GPIOB);             if (mcp23018_status) goto out;
-            mcp23018_status = i2c_start(I2C_ADDR_READ);     if (mcp23018_status) goto out;
-            data = i2c_readNak();
-            data = ~data;
-        out:
-            i2c_stop();
-            return data;
+            // read by the last completed batch
+            return left_cols[row];
         }
     } else {
         // read from teensy
@@ -304,18 +364,7 @@ static matrix_row_t read_cols(uint8_t row)
 static void unselect_rows(void)
 {
     // unselect on mcp23018
-    if (mcp23018_status) { // if there was an error
-        // do nothing
-    } else {
-        // set all rows hi-Z : 1
-        mcp23018_status = i2c_start(I2C_ADDR_WRITE);    if (mcp23018_status) goto out;
-        mcp23018_status = i2c_write(GPIOA);             if (mcp23018_status) goto out;
-        mcp23018_status = i2c_write( 0xFF
-                              & ~(0<<7)
-                          );                            if (mcp23018_status) goto out;
-    out:
-        i2c_stop();
-    }
+    // done by the last transaction of every batch
 
     // unselect on teensy
     // Hi-Z(DDR:0, PORT:0) to unselect
@@ -331,19 +380,7 @@ static void select_row(uint8_t row)
 {
     if (row < 7) {
         // select on mcp23018
-        if (mcp23018_status) { // if there was an error
-            // do nothing
-        } else {
-            // set active row low  : 0
-            // set other rows hi-Z : 1
-            mcp23018_status = i2c_start(I2C_ADDR_WRITE);        if (mcp23018_status) goto out;
-            mcp23018_status = i2c_write(GPIOA);                 if (mcp23018_status) goto out;
-            mcp23018_status = i2c_write( 0xFF & ~(1<<row)
-                                  & ~(0<<7)
-                              );                                if (mcp23018_status) goto out;
-        out:
-            i2c_stop();
-        }
+        // done by the batch, see mcp23018_init_transactions()
     } else {
         // select on teensy
         // Output low(DDR:1, PORT:0) to select
@@ -380,3 +417,84 @@ static void select_row(uint8_t row)
     }
 }
 
+
+static void mcp23018_init_transactions(void)
+{
+    uint8_t n = 0;
+    for (uint8_t row = 0; row < MCP23018_ROWS; row++) {
+        // set active row low  : 0
+        // set other rows hi-Z : 1
+        mcp23018_select[row][0] = GPIOA;
+        mcp23018_select[row][1] = 0xFF & ~(1<<row) & ~(0<<7);
+        mcp23018_batch[n++] = (i2c_async_transaction_t) {
+            .address = I2C_ADDR,
+            .write_data = mcp23018_select[row],
+            .write_length = 2,
+        };
+        mcp23018_batch[n++] = (i2c_async_transaction_t) {
+            .address = I2C_ADDR,
+            .write_data = &mcp23018_gpiob,
+            .write_length = 1,
+            .read_data = &mcp23018_cols[row],
+            .read_length = 1,
+        };
+    }
+    // set all rows hi-Z : 1
+    mcp23018_batch[n] = (i2c_async_transaction_t) {
+        .address = I2C_ADDR,
+        .write_data = mcp23018_unselect,
+        .write_length = 2,
+    };
+
+    mcp23018_reset[0] = (i2c_async_transaction_t) {
+        .address = I2C_ADDR,
+        .write_data = mcp23018_iodir,
+        .write_length = sizeof(mcp23018_iodir),
+    };
+    mcp23018_reset[1] = (i2c_async_transaction_t) {
+        .address = I2C_ADDR,
+        .write_data = mcp23018_gppu,
+        .write_length = sizeof(mcp23018_gppu),
+    };
+}
+
+static void mcp23018_start_batch(void)
+{
+    for (uint8_t i = 0; i < MCP23018_TRANSACTIONS; i++) {
+        i2c_async_submit(&mcp23018_batch[i]);
+    }
+    mcp23018_scanning = true;
+}
+
+static void mcp23018_collect_batch(void)
+{
+    mcp23018_scanning = false;
+    for (uint8_t i = 0; i < MCP23018_TRANSACTIONS; i++) {
+        if (mcp23018_batch[i].status != I2C_ASYNC_DONE) {
+            mcp23018_status = 1;
+            for (uint8_t row = 0; row < MCP23018_ROWS; row++) {
+                left_cols[row] = 0;
+            }
+            return;
+        }
+    }
+    for (uint8_t row = 0; row < MCP23018_ROWS; row++) {
+        left_cols[row] = (uint8_t)~mcp23018_cols[row];
+    }
+}
+
+static void mcp23018_start_reset(void)
+{
+    i2c_async_submit(&mcp23018_reset[0]);
+    i2c_async_submit(&mcp23018_reset[1]);
+    mcp23018_resetting = true;
+}
+
+static uint8_t mcp23018_reset_status(void)
+{
+    if (mcp23018_reset[0].status != I2C_ASYNC_DONE ||
+        mcp23018_reset[1].status != I2C_ASYNC_DONE) {
+        return 1;
+    }
+    return 0;
+}
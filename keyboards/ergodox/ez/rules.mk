@@ -16,6 +16,7 @@
 
 # # project specific files
 SRC = twimaster.c \
+	  $(QUANTUM_DIR)/i2c_async.c \
 	  matrix.c
 
 # MCU name
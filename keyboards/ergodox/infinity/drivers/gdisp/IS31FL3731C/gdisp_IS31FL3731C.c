@@ -94,6 +94,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define IS31_PWM_REG 0x24
 #define IS31_PWM_SIZE 0x90
+// A row of the LED matrix, the PWM registers are sent a row at a time
+#define IS31_PWM_ROW_SIZE 0x10
+#define IS31_PWM_ROWS (IS31_PWM_SIZE / IS31_PWM_ROW_SIZE)
 
 #define IS31_LED_MASK_SIZE 0x12
 #define IS31_SCREEN_WIDTH 16
@@ -140,6 +143,8 @@ typedef struct{
     uint8_t write_buffer[IS31_FRAME_SIZE];
     uint8_t frame_buffer[GDISP_SCREEN_HEIGHT * GDISP_SCREEN_WIDTH];
     uint8_t page;
+    // A bit for each PWM row that changed since it was sent to the page
+    uint16_t dirty_rows[2];
 }__attribute__((__packed__)) PrivData;
 
 // Some common routines and macros
@@ -170,6 +175,28 @@ static GFXINLINE void write_ram(GDisplay *g, uint8_t page, uint16_t offset, uint
     write_data(g, (uint8_t*)PRIV(g), length + 1);
 }
 
+static GFXINLINE void write_pwm_rows(GDisplay *g, uint8_t page, uint8_t first, uint8_t count) {
+    uint8_t tx[1 + IS31_PWM_SIZE];
+    tx[0] = IS31_PWM_REG + first * IS31_PWM_ROW_SIZE;
+    __builtin_memcpy(tx + 1, PRIV(g)->write_buffer + first * IS31_PWM_ROW_SIZE, count * IS31_PWM_ROW_SIZE);
+    write_page(g, page);
+    write_data(g, tx, count * IS31_PWM_ROW_SIZE + 1);
+}
+
+// Sets the PWM of a pixel, in screen coordinates, marking its row dirty
+static void set_pixel(GDisplay *g, coord_t x, coord_t y, uint8_t luma) {
+    uint8_t* pixel = &PRIV(g)->frame_buffer[y * GDISP_SCREEN_WIDTH + x];
+    if (*pixel == luma)
+        return;
+    *pixel = luma;
+    uint8_t address = get_led_address(g, x, y);
+    PRIV(g)->write_buffer[address] = cie[luma];
+    uint16_t row = 1 << (address / IS31_PWM_ROW_SIZE);
+    PRIV(g)->dirty_rows[0] |= row;
+    PRIV(g)->dirty_rows[1] |= row;
+    g->flags |= GDISP_FLG_NEEDFLUSH;
+}
+
 LLDSPEC bool_t gdisp_lld_init(GDisplay *g) {
 	// The private area is the display surface.
 	g->priv = gfxAlloc(sizeof(PrivData));
@@ -198,6 +225,8 @@ LLDSPEC bool_t gdisp_lld_init(GDisplay *g) {
         write_ram(g, i, 0, IS31_FRAME_SIZE);
         gfxSleepMilliseconds(1);
     }
+    // From now on the buffer holds the PWM registers, all zero like the frame buffer
+    __builtin_memset(PRIV(g)->write_buffer, 0, IS31_FRAME_SIZE);
 
     // software shutdown disable (i.e. turn stuff on)
     write_register(g, IS31_FUNCTIONREG, IS31_REG_SHUTDOWN, IS31_REG_SHUTDOWN_ON);
@@ -224,18 +253,21 @@ LLDSPEC bool_t gdisp_lld_init(GDisplay *g) {
 
 		PRIV(g)->page++;
 		PRIV(g)->page %= 2;
-		// TODO: some smarter algorithm for this
-		// We should run only one physical page at a time
-		// This way we don't need to send so much data, and
-		// we could use slightly less memory
-		uint8_t* src = PRIV(g)->frame_buffer;
-		for (int y=0;y<GDISP_SCREEN_HEIGHT;y++) {
-		    for (int x=0;x<GDISP_SCREEN_WIDTH;x++) {
-		        PRIV(g)->write_buffer[get_led_address(g, x, y)]=cie[*src];
-		        ++src;
-		    }
+		// The page shown last has to catch up with the changes since the
+		// flush before, send the runs of rows that changed
+		uint8_t page = PRIV(g)->page;
+		uint16_t dirty = PRIV(g)->dirty_rows[page];
+		for (uint8_t row = 0; row < IS31_PWM_ROWS;) {
+			if (!(dirty & (1 << row))) {
+				row++;
+				continue;
+			}
+			uint8_t first = row;
+			while (row < IS31_PWM_ROWS && (dirty & (1 << row)))
+				row++;
+			write_pwm_rows(g, page, first, row - first);
 		}
-        write_ram(g, PRIV(g)->page, IS31_PWM_REG, IS31_PWM_SIZE);
+		PRIV(g)->dirty_rows[page] = 0;
         gfxSleepMilliseconds(1);
         write_register(g, IS31_FUNCTIONREG, IS31_REG_PICTDISP, PRIV(g)->page);
 
@@ -258,8 +290,27 @@ LLDSPEC bool_t gdisp_lld_init(GDisplay *g) {
 			y = g->p.y;
 			break;
 		}
-		PRIV(g)->frame_buffer[y * GDISP_SCREEN_WIDTH + x] = gdispColor2Native(g->p.color);
-		g->flags |= GDISP_FLG_NEEDFLUSH;
+		set_pixel(g, x, y, gdispColor2Native(g->p.color));
+	}
+#endif
+
+#if GDISP_HARDWARE_BITFILLS
+	LLDSPEC void gdisp_lld_blit_area(GDisplay *g) {
+		const pixel_t* src = (const pixel_t*)g->p.ptr + g->p.y1 * g->p.x2 + g->p.x1;
+
+		for (coord_t y = 0; y < g->p.cy; y++, src += g->p.x2) {
+			for (coord_t x = 0; x < g->p.cx; x++) {
+				switch(g->g.Orientation) {
+				default:
+				case GDISP_ROTATE_0:
+					set_pixel(g, g->p.x + x, g->p.y + y, src[x]);
+					break;
+				case GDISP_ROTATE_180:
+					set_pixel(g, GDISP_SCREEN_WIDTH-1 - (g->p.x + x), g->p.y + y, src[x]);
+					break;
+				}
+			}
+		}
 	}
 #endif
 
@@ -14,6 +14,8 @@
 #include "src/gdisp/gdisp_driver.h"
 
 #include "board_ST7565.h"
+#include "display_shadow.h"
+#include <string.h>
 
 /*===========================================================================*/
 /* Driver local definitions.                                                 */
@@ -56,9 +58,13 @@
 /* Driver local functions.                                                   */
 /*===========================================================================*/
 
+#define PAGES							(GDISP_SCREEN_HEIGHT / 8)
+
 typedef struct{
     bool_t buffer2;
     uint8_t ram[GDISP_SCREEN_HEIGHT * GDISP_SCREEN_WIDTH / 8];
+    // What was last written to each of the two buffers of the display
+    uint8_t shadow[2][GDISP_SCREEN_HEIGHT * GDISP_SCREEN_WIDTH / 8];
 }PrivData;
 
 // Some common routines and macros
@@ -74,6 +80,16 @@ typedef struct{
 #define xyaddr(x, y)		((x) + ((y)>>3)*GDISP_SCREEN_WIDTH)
 #define xybit(y)			(1<<((y)&7))
 
+// What is sent is decided by the flush, against the shadows of the buffers
+static GFXINLINE void write_ram(GDisplay *g, coord_t x, unsigned page, uint8_t value) {
+	uint8_t		*ram = RAM(g) + x + page*GDISP_SCREEN_WIDTH;
+
+	if (*ram == value)
+		return;
+	*ram = value;
+	g->flags |= GDISP_FLG_NEEDFLUSH;
+}
+
 /*===========================================================================*/
 /* Driver exported functions.                                                */
 /*===========================================================================*/
@@ -89,6 +105,10 @@ LLDSPEC bool_t gdisp_lld_init(GDisplay *g) {
 	// The private area is the display surface.
 	g->priv = gfxAlloc(sizeof(PrivData));
 	PRIV(g)->buffer2 = false;
+	// Neither buffer of the display matches the memory yet
+	memset(RAM(g), 0, sizeof(PRIV(g)->ram));
+	memset(PRIV(g)->shadow, 0xFF, sizeof(PRIV(g)->shadow));
+	g->flags |= GDISP_FLG_NEEDFLUSH;
 
 	// Initialise the board interface
 	init_board(g);
@@ -150,26 +170,42 @@ LLDSPEC bool_t gdisp_lld_init(GDisplay *g) {
 #if GDISP_HARDWARE_FLUSH
 	LLDSPEC void gdisp_lld_flush(GDisplay *g) {
 		unsigned	p;
+		uint16_t	first, last;
+		bool_t		sent = FALSE;
 
 		// Don't flush if we don't need it.
 		if (!(g->flags & GDISP_FLG_NEEDFLUSH))
 			return;
+		g->flags &= ~GDISP_FLG_NEEDFLUSH;
 
-		acquire_bus(g);
-		unsigned dstOffset = (PRIV(g)->buffer2 ? 4 : 0);
-		for (p = 0; p < 4; p++) {
+		// The display shows one buffer while this writes the other, with
+		// only the columns of each page that differ from what it holds
+		unsigned buffer = (PRIV(g)->buffer2 ? 1 : 0);
+		unsigned dstOffset = buffer * PAGES;
+		for (p = 0; p < PAGES; p++) {
+			unsigned offset = p * GDISP_SCREEN_WIDTH;
+			if (!display_shadow_update(PRIV(g)->shadow[buffer] + offset, RAM(g) + offset,
+					GDISP_SCREEN_WIDTH, &first, &last))
+				continue;
+			if (!sent)
+				acquire_bus(g);
+			sent = TRUE;
 			write_cmd(g, ST7565_PAGE | (p + dstOffset));
-			write_cmd(g, ST7565_COLUMN_MSB | 0);
-			write_cmd(g, ST7565_COLUMN_LSB | 0);
+			write_cmd(g, ST7565_COLUMN_MSB | (first >> 4));
+			write_cmd(g, ST7565_COLUMN_LSB | (first & 0xF));
 			write_cmd(g, ST7565_RMW);
-			write_data(g, RAM(g) + (p*GDISP_SCREEN_WIDTH), GDISP_SCREEN_WIDTH);
+			write_data(g, RAM(g) + offset + first, last - first + 1);
 		}
+		// When the memory was drawn back to what the display shows, nothing
+		// is sent at all
+		if (!sent && memcmp(PRIV(g)->shadow[!buffer], RAM(g), sizeof(PRIV(g)->ram)) == 0)
+			return;
+		if (!sent)
+			acquire_bus(g);
 		unsigned line = (PRIV(g)->buffer2 ? 32 : 0);
         write_cmd(g, ST7565_START_LINE | line);
         PRIV(g)->buffer2 = !PRIV(g)->buffer2;
 		release_bus(g);
-
-		g->flags &= ~GDISP_FLG_NEEDFLUSH;
 	}
 #endif
 
@@ -196,11 +232,61 @@ LLDSPEC bool_t gdisp_lld_init(GDisplay *g) {
 			y = g->p.x;
 			break;
 		}
+		uint8_t value = RAM(g)[xyaddr(x, y)];
 		if (gdispColor2Native(g->p.color) != Black)
-			RAM(g)[xyaddr(x, y)] |= xybit(y);
+			value |= xybit(y);
 		else
-			RAM(g)[xyaddr(x, y)] &= ~xybit(y);
-		g->flags |= GDISP_FLG_NEEDFLUSH;
+			value &= ~xybit(y);
+		write_ram(g, x, y >> 3, value);
+	}
+#endif
+
+#if GDISP_HARDWARE_FILLS
+	// A byte at a time, rather than a pixel, clearing the screen is common
+	LLDSPEC void gdisp_lld_fill_area(GDisplay *g) {
+		coord_t		x, y, cx, cy, col;
+		unsigned	p;
+
+		switch(g->g.Orientation) {
+		default:
+		case GDISP_ROTATE_0:
+			x = g->p.x;
+			y = g->p.y;
+			cx = g->p.cx;
+			cy = g->p.cy;
+			break;
+		case GDISP_ROTATE_90:
+			x = g->p.y;
+			y = GDISP_SCREEN_HEIGHT - g->p.x - g->p.cx;
+			cx = g->p.cy;
+			cy = g->p.cx;
+			break;
+		case GDISP_ROTATE_180:
+			x = GDISP_SCREEN_WIDTH - g->p.x - g->p.cx;
+			y = GDISP_SCREEN_HEIGHT - g->p.y - g->p.cy;
+			cx = g->p.cx;
+			cy = g->p.cy;
+			break;
+		case GDISP_ROTATE_270:
+			x = GDISP_SCREEN_HEIGHT - g->p.y - g->p.cy;
+			y = g->p.x;
+			cx = g->p.cy;
+			cy = g->p.cx;
+			break;
+		}
+		bool_t set = gdispColor2Native(g->p.color) != Black;
+		for (p = y >> 3; p <= (unsigned)(y + cy - 1) >> 3; p++) {
+			// The rows of the area in this page
+			uint8_t mask = 0xFF;
+			if (p == (unsigned)y >> 3)
+				mask &= 0xFF << (y & 7);
+			if (p == (unsigned)(y + cy - 1) >> 3)
+				mask &= 0xFF >> (7 - ((y + cy - 1) & 7));
+			for (col = x; col < x + cx; col++) {
+				uint8_t value = RAM(g)[col + p*GDISP_SCREEN_WIDTH];
+				write_ram(g, col, p, set ? value | mask : value & ~mask);
+			}
+		}
 	}
 #endif
 
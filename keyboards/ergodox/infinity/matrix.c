@@ -24,6 +24,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "print.h"
 #include "debug.h"
 #include "matrix.h"
+#include "serial_link/system/serial_link.h"
 
 
 /*
@@ -128,6 +129,7 @@ uint8_t matrix_scan(void)
             matrix[offset + row] = matrix_debouncing[row];
         }
         debouncing = false;
+        serial_link_matrix_changed();
     }
     matrix_scan_quantum();
     return 1;
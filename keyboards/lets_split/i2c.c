@@ -5,6 +5,7 @@
 #include <util/twi.h>
 #include <stdbool.h>
 #include "i2c.h"
+#include "i2c_async.h"
 
 // Limits the amount of we wait for any one i2c transaction.
 // Since were running SCL line 100kHz (=> 10μs/bit), and each transactions is
@@ -111,9 +112,9 @@ void i2c_slave_init(uint8_t address) {
   TWCR = (1<<TWIE) | (1<<TWEA) | (1<<TWINT) | (1<<TWEN);
 }
 
-ISR(TWI_vect);
-
-ISR(TWI_vect) {
+// The TWI interrupt is owned by the asynchronous master, which hands the
+// events over to us when it's idle
+void i2c_async_slave_event(void) {
   uint8_t ack = 1;
   switch(TW_STATUS) {
     case TW_SR_SLA_ACK:
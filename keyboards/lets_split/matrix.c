@@ -29,6 +29,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "util.h"
 #include "matrix.h"
 #include "i2c.h"
+#include "i2c_async.h"
 #include "serial.h"
 #include "split_util.h"
 #include "pro_micro.h"
@@ -145,36 +146,47 @@ uint8_t _matrix_scan(void)
     return 1;
 }
 
+#ifdef USE_I2C
+// The start of the matrix is stored at 0x00
+static const uint8_t slave_register = 0x00;
+static uint8_t slave_rows[MATRIX_ROWS/2];
+static i2c_async_transaction_t slave_read = {
+    .address = SLAVE_I2C_ADDRESS >> 1,
+    .write_data = &slave_register,
+    .write_length = 1,
+    .read_data = slave_rows,
+    .read_length = sizeof(slave_rows),
+};
+
 // Get rows from other half over i2c
+// The read runs in the background while the local half is scanned, the
+// result is collected on the next call and the next read is queued
+// returns: 0 => success
+//          1 => error
+//         -1 => the previous read is still in flight
 int i2c_transaction(void) {
     int slaveOffset = (isLeftHand) ? (ROWS_PER_HAND) : 0;
+    int err = 0;
 
-    int err = i2c_master_start(SLAVE_I2C_ADDRESS + I2C_WRITE);
-    if (err) goto i2c_error;
-
-    // start of matrix stored at 0x00
-    err = i2c_master_write(0x00);
-    if (err) goto i2c_error;
-
-    // Start read
-    err = i2c_master_start(SLAVE_I2C_ADDRESS + I2C_READ);
-    if (err) goto i2c_error;
+    i2c_async_task();
 
-    if (!err) {
-        int i;
-        for (i = 0; i < ROWS_PER_HAND-1; ++i) {
-            matrix[slaveOffset+i] = i2c_master_read(I2C_ACK);
+    switch (slave_read.status) {
+    case I2C_ASYNC_PENDING:
+        return -1;
+    case I2C_ASYNC_DONE:
+        for (int i = 0; i < ROWS_PER_HAND; ++i) {
+            matrix[slaveOffset+i] = slave_rows[i];
         }
-        matrix[slaveOffset+i] = i2c_master_read(I2C_NACK);
-        i2c_master_stop();
-    } else {
-i2c_error: // the cable is disconnceted, or something else went wrong
-        i2c_reset_state();
-        return err;
+        break;
+    case I2C_ASYNC_ERROR: // the cable is disconnceted, or something else went wrong
+        err = 1;
+        break;
     }
 
-    return 0;
+    i2c_async_submit(&slave_read);
+    return err;
 }
+#endif
 
 #ifndef USE_I2C
 int serial_transaction(void) {
@@ -193,15 +205,16 @@ int serial_transaction(void) {
 
 uint8_t matrix_scan(void)
 {
-    int ret = _matrix_scan();
-
-
-
 #ifdef USE_I2C
-    if( i2c_transaction() ) {
+    // queues the next read of the other half before scanning this one
+    int err = i2c_transaction();
+    int ret = _matrix_scan();
 #else
-    if( serial_transaction() ) {
+    int ret = _matrix_scan();
+    int err = serial_transaction();
 #endif
+
+    if (err > 0) {
         // turn on the indicator led when halves are disconnected
         TXLED1;
 
@@ -214,7 +227,7 @@ uint8_t matrix_scan(void)
                 matrix[slaveOffset+i] = 0;
             }
         }
-    } else {
+    } else if (err == 0) {
         // turn off the indicator led on no error
         TXLED0;
         error_count = 0;
@@ -239,6 +252,9 @@ void matrix_slave_scan(void) {
     for (int i = 0; i < ROWS_PER_HAND; ++i) {
         serial_slave_buffer[i] = matrix[offset+i];
     }
+#ifdef SERIAL_USE_UART
+    serial_slave_update();
+#endif
 #endif
 }
 
@@ -0,0 +1,11 @@
+# Serial communication between the halves, when USE_I2C is not defined
+#   bitbang - single wire on PD0, the master waits for the slave on every scan
+#   uart - hardware USART1, TX (PD3) and RX (PD2) crossed between the halves
+SPLIT_SERIAL_DRIVER ?= bitbang
+
+ifeq ($(strip $(SPLIT_SERIAL_DRIVER)), uart)
+	SRC += serial_uart.c
+	OPT_DEFS += -DSERIAL_USE_UART
+else
+	SRC += serial.c
+endif
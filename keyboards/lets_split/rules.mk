@@ -1,7 +1,10 @@
 SRC += matrix.c \
 	   i2c.c \
-	   split_util.c \
-	   serial.c
+	   $(QUANTUM_DIR)/i2c_async.c \
+	   split_util.c
+
+# The serial driver between the halves is picked in post_rules.mk, after
+# the keymap Makefile had a chance to set SPLIT_SERIAL_DRIVER
 
 # MCU name
 #MCU = at90usb1287
@@ -23,4 +23,9 @@ void serial_slave_init(void);
 int serial_update_buffers(void);
 bool serial_slave_data_corrupt(void);
 
+#ifdef SERIAL_USE_UART
+// Sends the slave buffer to the master if needed, called after each slave scan
+void serial_slave_update(void);
+#endif
+
 #endif
@@ -0,0 +1,191 @@
+/*
+ * Interrupt driven serial communication between the halves, using the
+ * hardware USART1 of the ATmega32u4.
+ *
+ * Unlike the bit-banged implementation in serial.c, neither half ever waits
+ * for the other one. Each half sends its buffer as a small frame whenever
+ * it changes (or periodically as a keepalive), and the receive interrupt
+ * assembles and validates incoming frames in the background.
+ *
+ * Wiring: TX (PD3) of each half connects to RX (PD2) of the other half.
+ */
+
+#ifndef F_CPU
+#define F_CPU 16000000
+#endif
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "serial.h"
+#include "timer.h"
+
+#ifndef SERIAL_UART_BAUD
+#define SERIAL_UART_BAUD 1000000
+#endif
+
+// The master considers the slave disconnected when it hasn't received a
+// valid frame for this many milliseconds
+#ifndef SERIAL_UART_TIMEOUT
+#define SERIAL_UART_TIMEOUT 100
+#endif
+
+// The buffers are resent after this many updates even if they haven't changed
+#ifndef SERIAL_UART_KEEPALIVE
+#define SERIAL_UART_KEEPALIVE 64
+#endif
+
+#define SERIAL_UART_SYNC 0xA5
+
+#define UCSRB_IDLE ((1<<RXEN1) | (1<<TXEN1) | (1<<RXCIE1))
+
+uint8_t volatile serial_slave_buffer[SERIAL_SLAVE_BUFFER_LENGTH] = {0};
+uint8_t volatile serial_master_buffer[SERIAL_MASTER_BUFFER_LENGTH] = {0};
+
+#define SLAVE_DATA_CORRUPT (1<<0)
+volatile uint8_t status = 0;
+
+#define MAX_BUFFER_LENGTH \
+  (SERIAL_SLAVE_BUFFER_LENGTH > SERIAL_MASTER_BUFFER_LENGTH ? \
+   SERIAL_SLAVE_BUFFER_LENGTH : SERIAL_MASTER_BUFFER_LENGTH)
+
+// Frame layout: sync, data, checksum
+static uint8_t tx_frame[MAX_BUFFER_LENGTH + 2];
+static volatile uint8_t tx_pos;
+static volatile uint8_t tx_length;
+static uint8_t last_sent[MAX_BUFFER_LENGTH];
+static uint8_t keepalive_counter;
+
+static volatile uint8_t* rx_target;
+static uint8_t rx_length;
+static uint8_t rx_frame[MAX_BUFFER_LENGTH];
+static uint8_t rx_pos;
+static bool rx_in_frame;
+static volatile bool rx_frame_received;
+static uint16_t last_frame_time;
+
+static void serial_uart_init(volatile uint8_t* receive_buffer, uint8_t receive_length) {
+  rx_target = receive_buffer;
+  rx_length = receive_length;
+  rx_pos = 0;
+  rx_in_frame = false;
+  tx_pos = tx_length = 0;
+  keepalive_counter = 0;
+
+  // The receive pin gets a pull-up, so that a disconnected half reads idle
+  PORTD |= _BV(PD2);
+  UBRR1 = (F_CPU / 4 / SERIAL_UART_BAUD - 1) / 2;
+  UCSR1A = (1<<U2X1);
+  UCSR1C = (1<<UCSZ11) | (1<<UCSZ10);
+  UCSR1B = UCSRB_IDLE;
+}
+
+void serial_master_init(void) {
+  serial_uart_init(serial_slave_buffer, SERIAL_SLAVE_BUFFER_LENGTH);
+}
+
+void serial_slave_init(void) {
+  serial_uart_init(serial_master_buffer, SERIAL_MASTER_BUFFER_LENGTH);
+}
+
+// Starts the transmission of the buffer, if the previous frame has been sent
+// and the buffer has changed or the keepalive has expired
+static void send_buffer(volatile uint8_t* buffer, uint8_t length) {
+  if (tx_pos != tx_length) {
+    return;
+  }
+  bool changed = false;
+  uint8_t checksum = 0;
+  for (uint8_t i = 0; i < length; ++i) {
+    uint8_t data = buffer[i];
+    changed |= data != last_sent[i];
+    last_sent[i] = data;
+    tx_frame[i + 1] = data;
+    checksum += data;
+  }
+  if (!changed && ++keepalive_counter < SERIAL_UART_KEEPALIVE) {
+    return;
+  }
+  keepalive_counter = 0;
+  tx_frame[0] = SERIAL_UART_SYNC;
+  tx_frame[length + 1] = checksum;
+  tx_pos = 0;
+  tx_length = length + 2;
+  UCSR1B = UCSRB_IDLE | (1<<UDRIE1);
+}
+
+void serial_slave_update(void) {
+  send_buffer(serial_slave_buffer, SERIAL_SLAVE_BUFFER_LENGTH);
+}
+
+inline
+bool serial_slave_data_corrupt(void) {
+  return status & SLAVE_DATA_CORRUPT;
+}
+
+// Sends the serial_master_buffer to the slave, and checks that the
+// serial_slave_buffer has been received recently. Never waits.
+//
+// Returns:
+// 0 => no error
+// 1 => slave did not respond
+int serial_update_buffers(void) {
+  send_buffer(serial_master_buffer, SERIAL_MASTER_BUFFER_LENGTH);
+
+  if (rx_frame_received) {
+    rx_frame_received = false;
+    last_frame_time = timer_read();
+    return 0;
+  }
+  return timer_elapsed(last_frame_time) > SERIAL_UART_TIMEOUT ? 1 : 0;
+}
+
+ISR(USART1_UDRE_vect) {
+  if (tx_pos == tx_length) {
+    UCSR1B = UCSRB_IDLE;
+  } else {
+    UDR1 = tx_frame[tx_pos++];
+  }
+}
+
+ISR(USART1_RX_vect) {
+  bool error = UCSR1A & ((1<<FE1) | (1<<DOR1));
+  uint8_t data = UDR1;
+
+  if (error) {
+    rx_in_frame = false;
+    status |= SLAVE_DATA_CORRUPT;
+    return;
+  }
+
+  if (!rx_in_frame) {
+    // Wait for the start of the next frame
+    if (data == SERIAL_UART_SYNC) {
+      rx_in_frame = true;
+      rx_pos = 0;
+    }
+    return;
+  }
+
+  if (rx_pos < rx_length) {
+    rx_frame[rx_pos++] = data;
+    return;
+  }
+
+  rx_in_frame = false;
+  uint8_t checksum = 0;
+  for (uint8_t i = 0; i < rx_length; ++i) {
+    checksum += rx_frame[i];
+  }
+  if (checksum == data) {
+    for (uint8_t i = 0; i < rx_length; ++i) {
+      rx_target[i] = rx_frame[i];
+    }
+    rx_frame_received = true;
+    status &= ~SLAVE_DATA_CORRUPT;
+  } else {
+    status |= SLAVE_DATA_CORRUPT;
+  }
+}
@@ -3,11 +3,19 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#if defined(__AVR__)
 #include <avr/io.h>
 #include <util/delay.h>
+#endif
 #include "musical_notes.h"
 #include "song_list.h"
 #include "voices.h"
+#if defined(__AVR__)
+#include "audio_engine.h"
+#else
+// Mixed into the DAC by audio_arm.c
+#include "audio_mixer.h"
+#endif
 #include "quantum.h"
 
 // Largely untested PWM audio mode (doesn't sound as good)
@@ -15,9 +23,15 @@
 
 // #define VIBRATO_ENABLE
 
-// Enable vibrato strength/amplitude - slows down ISR too much
+// Enable vibrato strength/amplitude
 // #define VIBRATO_STRENGTH_ENABLE
 
+// Microseconds the interrupt that drives the speaker should take, see
+// scheduler_debug()
+#ifndef AUDIO_ISR_BUDGET
+#define AUDIO_ISR_BUDGET 40
+#endif
+
 typedef union {
     uint8_t raw;
     struct {
@@ -31,38 +45,6 @@ void audio_toggle(void);
 void audio_on(void);
 void audio_off(void);
 
-// Vibrato rate functions
-
-#ifdef VIBRATO_ENABLE
-
-void set_vibrato_rate(float rate);
-void increase_vibrato_rate(float change);
-void decrease_vibrato_rate(float change);
-
-#ifdef VIBRATO_STRENGTH_ENABLE
-
-void set_vibrato_strength(float strength);
-void increase_vibrato_strength(float change);
-void decrease_vibrato_strength(float change);
-
-#endif
-
-#endif
-
-// Polyphony functions
-
-void set_polyphony_rate(float rate);
-void enable_polyphony(void);
-void disable_polyphony(void);
-void increase_polyphony_rate(float change);
-void decrease_polyphony_rate(float change);
-
-void set_timbre(float timbre);
-void set_tempo(uint8_t tempo);
-
-void increase_tempo(uint8_t tempo_change);
-void decrease_tempo(uint8_t tempo_change);
-
 void audio_init(void);
 
 #ifdef PWM_AUDIO
@@ -72,6 +54,16 @@ void play_note(float freq, int vol);
 void stop_note(float freq);
 void stop_all_notes(void);
 void play_notes(float (*np)[][2], uint16_t n_count, bool n_repeat, float n_rest);
+// Plays a song of song_note_t in flash, like song_list.c has
+void play_song(const song_note_t *song, bool n_repeat, float n_rest);
+
+#if !defined(__AVR__)
+bool is_playing_notes(void);
+
+void set_tempo(uint8_t tempo);
+void increase_tempo(uint8_t tempo_change);
+void decrease_tempo(uint8_t tempo_change);
+#endif
 
 #define SCALE (int8_t []){ 0 + (12*0), 2 + (12*0), 4 + (12*0), 5 + (12*0), 7 + (12*0), 9 + (12*0), 11 + (12*0), \
                            0 + (12*1), 2 + (12*1), 4 + (12*1), 5 + (12*1), 7 + (12*1), 9 + (12*1), 11 + (12*1), \
@@ -86,6 +78,4 @@ void play_notes(float (*np)[][2], uint16_t n_count, bool n_repeat, float n_rest)
 #define PLAY_NOTE_ARRAY(note_array, note_repeat, note_rest_style) play_notes(&note_array, NOTE_ARRAY_SIZE((note_array)), (note_repeat), (note_rest_style));
 
 
-bool is_playing_notes(void);
-
 #endif
\ No newline at end of file
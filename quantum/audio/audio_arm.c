@@ -0,0 +1,421 @@
+/* Audio for ChibiOS, through the DAC
+ *
+ * A timer triggers the DAC at the sample rate, and DMA feeds it from a
+ * circular buffer of two blocks. When the DAC is done with a block, the
+ * callback wakes a thread, which mixes the next one with audio_mixer_render()
+ * while the other block plays. Notes are voices of the mixer, so they all
+ * sound at once, up to AUDIO_MIXER_VOICES, and the interrupts only swap
+ * blocks.
+ *
+ * The voices of voices.h pick the wavetable. Timbre, polyphony and vibrato
+ * shape the PWM output of audio.c, and aren't used here.
+ *
+ * The board sets the DAC pin, PA4 for the first channel, to analog mode,
+ * and enables the DAC and GPT drivers in halconf.h and mcuconf.h.
+ */
+
+#include "ch.h"
+#include "hal.h"
+#include "audio.h"
+#include "audio_mixer.h"
+#include "eeconfig.h"
+
+#ifndef AUDIO_DAC_DRIVER
+#define AUDIO_DAC_DRIVER DACD1
+#endif
+
+// The timer that triggers the DAC, TIM6 is DAC_TRG(0) on the STM32
+#ifndef AUDIO_GPT_DRIVER
+#define AUDIO_GPT_DRIVER GPTD6
+#endif
+#ifndef AUDIO_DAC_TRIGGER
+#define AUDIO_DAC_TRIGGER DAC_TRG(0)
+#endif
+
+// Has to divide the timer clock
+#ifndef AUDIO_GPT_FREQUENCY
+#define AUDIO_GPT_FREQUENCY 1000000
+#endif
+
+#ifndef AUDIO_SAMPLE_RATE
+#define AUDIO_SAMPLE_RATE 24000
+#endif
+
+// Samples of both blocks, a block is the latency of a new note
+#ifndef AUDIO_BUFFER_SAMPLES
+#define AUDIO_BUFFER_SAMPLES 256
+#endif
+
+#define SAMPLE_INTERVAL ((AUDIO_GPT_FREQUENCY + AUDIO_SAMPLE_RATE / 2) / AUDIO_SAMPLE_RATE)
+// The rate the timer actually runs at
+#define SAMPLE_RATE (AUDIO_GPT_FREQUENCY / SAMPLE_INTERVAL)
+#define BLOCK_SAMPLES (AUDIO_BUFFER_SAMPLES / 2)
+
+// Samples per unit of song_note_t duration and of tempo, in Q8, like song_samples()
+#define SONG_SAMPLE_SCALE ((uint32_t)(65535.0 / 400 / 2000000 * SAMPLE_RATE * 256 + 0.5))
+
+static dacsample_t buffer[AUDIO_BUFFER_SAMPLES];
+// The block the DAC is done with
+static dacsample_t * volatile free_block;
+static binary_semaphore_t block_free;
+// Held while the voices and the song change, or while they are mixed
+static MUTEX_DECL(audio_mutex);
+
+static audio_mixer_voice_t voices[AUDIO_MIXER_VOICES];
+static float voice_frequencies[AUDIO_MIXER_VOICES];
+static uint8_t voice_count = 0;
+
+static const int16_t * const waves[] = {
+  audio_wave_square,
+  audio_wave_triangle,
+  audio_wave_sine,
+  audio_wave_sawtooth,
+};
+#define WAVE_COUNT (sizeof(waves) / sizeof(waves[0]))
+static uint8_t wave = 0;
+
+static bool     playing_notes = false;
+static bool     playing_note = false;
+static float (* notes_pointer)[][2];
+// Or a song in flash, which ends on a duration of 0
+static const song_note_t *song_pointer;
+static uint16_t notes_count;
+static bool     notes_repeat;
+// In samples
+static uint32_t notes_rest;
+static bool     note_resting = false;
+static uint16_t current_note = 0;
+static uint32_t note_remaining = 0;
+static uint8_t  note_tempo = TEMPO_DEFAULT;
+
+static bool audio_initialized = false;
+
+audio_config_t audio_config;
+
+static void dac_block_end(DACDriver *dacp, const dacsample_t *block, size_t n) {
+  (void)dacp;
+  (void)n;
+
+  chSysLockFromISR();
+  free_block = (dacsample_t *)block;
+  chBSemSignalI(&block_free);
+  chSysUnlockFromISR();
+}
+
+static const DACConfig dac_config = {
+  .init     = AUDIO_MIXER_MIDPOINT,
+  .datamode = DAC_DHRM_12BIT_RIGHT
+};
+
+static const DACConversionGroup dac_group = {
+  .num_channels = 1U,
+  .end_cb       = dac_block_end,
+  .error_cb     = NULL,
+  .trigger      = AUDIO_DAC_TRIGGER
+};
+
+// The update event of the timer starts each conversion
+static const GPTConfig gpt_config = {
+  .frequency = AUDIO_GPT_FREQUENCY,
+  .callback  = NULL,
+  .cr2       = TIM_CR2_MMS_1,
+  .dier      = 0U
+};
+
+// The songs count in periods of the 2MHz timer of audio.c, 65535 of them per
+// quarter note at tempo 100
+static uint32_t song_samples(float duration) {
+  uint32_t samples = duration * (65535.0f / 2000000 * SAMPLE_RATE);
+  // Even an empty note moves the song along
+  return samples > 0 ? samples : 1;
+}
+
+static void set_voice_note(audio_mixer_voice_t *v, uint32_t step, int vol) {
+  v->wave = waves[wave];
+  v->phase = 0;
+  v->step = step;
+  v->volume = vol >= 0xF ? 255 : vol * 17;
+}
+
+static bool song_ended(uint16_t index) {
+  if (song_pointer) {
+    return song_pointer[index].duration == 0;
+  }
+  return index >= notes_count;
+}
+
+static void load_note(uint16_t index) {
+  voice_count = 0;
+
+  if (song_pointer) {
+    const song_note_t *note = &song_pointer[index];
+    uint32_t step = audio_mixer_note_step(note->note, SAMPLE_RATE);
+
+    if (step > 0) {
+      set_voice_note(&voices[0], step, 0xF);
+      voice_count = 1;
+    }
+    note_remaining = ((uint32_t)note->duration * note_tempo * SONG_SAMPLE_SCALE) >> 8;
+    if (note_remaining == 0) {
+      note_remaining = 1;
+    }
+    return;
+  }
+
+  float freq = (*notes_pointer)[index][0];
+  if (freq > 0) {
+    set_voice_note(&voices[0], audio_mixer_step(freq, SAMPLE_RATE), 0xF);
+    voice_count = 1;
+  }
+  note_remaining = song_samples((*notes_pointer)[index][1] / 4 * note_tempo / 100);
+}
+
+// Moves the song to its next note, or rest
+static void next_note(void) {
+  current_note++;
+  if (song_ended(current_note)) {
+    if (notes_repeat) {
+      current_note = 0;
+    } else {
+      playing_notes = false;
+      voice_count = 0;
+      return;
+    }
+  }
+  if (!note_resting && (notes_rest > 0)) {
+    note_resting = true;
+    voice_count = 0;
+    note_remaining = notes_rest;
+    current_note--;
+  } else {
+    note_resting = false;
+    load_note(current_note);
+  }
+}
+
+static void fill_block(dacsample_t *block) {
+  uint16_t done = 0;
+
+  chMtxLock(&audio_mutex);
+  while (done < BLOCK_SAMPLES) {
+    uint16_t length = BLOCK_SAMPLES - done;
+
+    // A song changes notes in the middle of a block
+    if (playing_notes && note_remaining < length) {
+      length = note_remaining;
+    }
+    audio_mixer_render(voices, voice_count, block + done, length);
+    done += length;
+
+    if (playing_notes) {
+      note_remaining -= length;
+      if (note_remaining == 0) {
+        next_note();
+      }
+    }
+  }
+  chMtxUnlock(&audio_mutex);
+}
+
+static THD_WORKING_AREA(waAudioThread, 256);
+// Above the main loop, which never sleeps, but the blocks are short
+static THD_FUNCTION(audioThread, arg) {
+  (void)arg;
+  chRegSetThreadName("audio");
+
+  while (true) {
+    chBSemWait(&block_free);
+    fill_block(free_block);
+  }
+}
+
+void audio_init() {
+  if (audio_initialized) {
+    return;
+  }
+
+  // Check EEPROM
+  if (!eeconfig_is_enabled()) {
+    eeconfig_init();
+  }
+  audio_config.raw = eeconfig_read_audio();
+
+  for (uint16_t i = 0; i < AUDIO_BUFFER_SAMPLES; i++) {
+    buffer[i] = AUDIO_MIXER_MIDPOINT;
+  }
+  chBSemObjectInit(&block_free, true);
+  chThdCreateStatic(waAudioThread, sizeof(waAudioThread), NORMALPRIO + 1, audioThread, NULL);
+
+  dacStart(&AUDIO_DAC_DRIVER, &dac_config);
+  dacStartConversion(&AUDIO_DAC_DRIVER, &dac_group, buffer, AUDIO_BUFFER_SAMPLES);
+  gptStart(&AUDIO_GPT_DRIVER, &gpt_config);
+  gptStartContinuous(&AUDIO_GPT_DRIVER, SAMPLE_INTERVAL);
+
+  audio_initialized = true;
+}
+
+void stop_all_notes() {
+  if (!audio_initialized) {
+    audio_init();
+  }
+
+  chMtxLock(&audio_mutex);
+  voice_count = 0;
+  playing_notes = false;
+  playing_note = false;
+  chMtxUnlock(&audio_mutex);
+}
+
+void stop_note(float freq) {
+  if (!playing_note) {
+    return;
+  }
+  if (!audio_initialized) {
+    audio_init();
+  }
+
+  chMtxLock(&audio_mutex);
+  for (int8_t i = voice_count - 1; i >= 0; i--) {
+    if (voice_frequencies[i] == freq) {
+      for (uint8_t j = i; j < voice_count - 1; j++) {
+        voices[j] = voices[j + 1];
+        voice_frequencies[j] = voice_frequencies[j + 1];
+      }
+      voice_count--;
+      break;
+    }
+  }
+  if (voice_count == 0) {
+    playing_note = false;
+  }
+  chMtxUnlock(&audio_mutex);
+}
+
+void play_note(float freq, int vol) {
+  if (!audio_initialized) {
+    audio_init();
+  }
+  if (!audio_config.enable || freq <= 0) {
+    return;
+  }
+
+  chMtxLock(&audio_mutex);
+  // Cancel notes if notes are playing
+  if (playing_notes) {
+    playing_notes = false;
+    voice_count = 0;
+  }
+  if (voice_count < AUDIO_MIXER_VOICES) {
+    set_voice_note(&voices[voice_count], audio_mixer_step(freq, SAMPLE_RATE), vol);
+    voice_frequencies[voice_count] = freq;
+    voice_count++;
+    playing_note = true;
+  }
+  chMtxUnlock(&audio_mutex);
+}
+
+// Called with the mutex held
+static void start_song(bool n_repeat, float n_rest) {
+  // Cancel note if a note is playing
+  playing_note = false;
+  playing_notes = true;
+
+  notes_repeat = n_repeat;
+  notes_rest = n_rest > 0 ? song_samples(n_rest) : 0;
+
+  current_note = 0;
+  note_resting = false;
+  load_note(current_note);
+}
+
+void play_notes(float (*np)[][2], uint16_t n_count, bool n_repeat, float n_rest) {
+  if (!audio_initialized) {
+    audio_init();
+  }
+  if (!audio_config.enable || n_count == 0) {
+    return;
+  }
+
+  chMtxLock(&audio_mutex);
+  notes_pointer = np;
+  song_pointer = NULL;
+  notes_count = n_count;
+  start_song(n_repeat, n_rest);
+  chMtxUnlock(&audio_mutex);
+}
+
+void play_song(const song_note_t *song, bool n_repeat, float n_rest) {
+  if (!audio_initialized) {
+    audio_init();
+  }
+  if (!audio_config.enable || song[0].duration == 0) {
+    return;
+  }
+
+  chMtxLock(&audio_mutex);
+  song_pointer = song;
+  start_song(n_repeat, n_rest);
+  chMtxUnlock(&audio_mutex);
+}
+
+bool is_playing_notes(void) {
+  return playing_notes;
+}
+
+bool is_audio_on(void) {
+  return (audio_config.enable != 0);
+}
+
+void audio_toggle(void) {
+  audio_config.enable ^= 1;
+  eeconfig_update_audio(audio_config.raw);
+  if (audio_config.enable) {
+    audio_on_user();
+  } else {
+    stop_all_notes();
+  }
+}
+
+void audio_on(void) {
+  audio_config.enable = 1;
+  eeconfig_update_audio(audio_config.raw);
+  audio_on_user();
+}
+
+void audio_off(void) {
+  audio_config.enable = 0;
+  eeconfig_update_audio(audio_config.raw);
+  stop_all_notes();
+}
+
+// Voices pick the wave of the notes that start after
+
+void set_voice(voice_type v) {
+  wave = v % WAVE_COUNT;
+}
+
+void voice_iterate() {
+  wave = (wave + 1) % WAVE_COUNT;
+}
+
+void voice_deiterate() {
+  wave = (wave + WAVE_COUNT - 1) % WAVE_COUNT;
+}
+
+// Tempo functions
+
+void set_tempo(uint8_t tempo) {
+  note_tempo = tempo;
+}
+
+void decrease_tempo(uint8_t tempo_change) {
+  note_tempo += tempo_change;
+}
+
+void increase_tempo(uint8_t tempo_change) {
+  if (note_tempo - tempo_change < 10) {
+    note_tempo = 10;
+  } else {
+    note_tempo -= tempo_change;
+  }
+}
@@ -0,0 +1,527 @@
+#include <stddef.h>
+#include "audio_engine.h"
+#include "musical_notes.h"
+#include "voices.h"
+#include "luts.h"
+#include "progmem.h"
+
+// Timer ticks a second
+#define AUDIO_TIMER_CLOCK (F_CPU / AUDIO_CPU_PRESCALER)
+// The lowest note, which still fits the 16-bit timer
+#define AUDIO_MAX_PERIOD ((uint16_t)(AUDIO_TIMER_CLOCK / 30.52))
+
+// log2(55) in Q16, the pitch of frequency_lut[0]
+#define LOG2_A1 378887
+// Glides move 220 / frequency semitones a period, that is period * 220 /
+// AUDIO_TIMER_CLOCK, as a Q16 multiplier of the period for Q8.8 semitones
+#define GLIDE_SCALE ((uint16_t)(56320.0 * 65536 / AUDIO_TIMER_CLOCK + 0.5))
+// 440 / frequency in Q16 is period * VIBRATO_SCALE >> 8
+#define VIBRATO_SCALE ((uint16_t)(440.0 * 16777216 / AUDIO_TIMER_CLOCK + 0.5))
+// The envelope runs at 880 steps a second, period * ENVELOPE_SCALE >> 8 in Q16
+#define ENVELOPE_SCALE ((uint16_t)(880.0 * 16777216 / AUDIO_TIMER_CLOCK + 0.5))
+
+/* log2(1 + i / 64) in Q16
+ * (0..63).each {|i| p (Math.log2(1 + i/64.0) * 65536).round }
+ */
+static const uint16_t log2_lut[64] PROGMEM = {
+        0,  1466,  2909,  4331,  5732,  7112,  8473,  9814,
+    11136, 12440, 13727, 14996, 16248, 17484, 18704, 19909,
+    21098, 22272, 23433, 24579, 25711, 26830, 27936, 29029,
+    30109, 31178, 32234, 33279, 34312, 35334, 36346, 37346,
+    38336, 39316, 40286, 41246, 42196, 43137, 44068, 44990,
+    45904, 46809, 47705, 48593, 49472, 50344, 51207, 52063,
+    52911, 53751, 54584, 55410, 56229, 57040, 57845, 58643,
+    59434, 60219, 60997, 61769, 62534, 63294, 64047, 64794,
+};
+
+typedef struct {
+    float    frequency;  // as played, to find the voice in stop_note()
+    int16_t  pitch;
+    uint16_t period;
+    int      volume;
+} audio_voice_t;
+
+static audio_voice_t voices[AUDIO_MAX_VOICES];
+static uint8_t voice_count = 0;
+static uint8_t voice_place = 0;
+// Timer ticks the current voice has played for, with polyphony
+static uint32_t place = 0;
+// Where the glide between play_note() voices is
+static int16_t glide_pitch = AUDIO_PITCH_REST;
+static uint16_t glide_period = 0;
+
+static bool     playing_notes = false;
+static bool     playing_note = false;
+static int16_t  note_pitch = AUDIO_PITCH_REST;
+static uint16_t note_period = 0;
+// In timer ticks
+static uint32_t note_duration = 0;
+static uint32_t note_elapsed = 0;
+static uint8_t  note_tempo = TEMPO_DEFAULT;
+static float (* notes_pointer)[][2];
+// Or a song in flash, which ends on a duration of 0
+static const song_note_t *song_pointer;
+static uint16_t notes_count;
+static bool     notes_repeat;
+static uint32_t notes_rest;
+static bool     note_resting = false;
+static uint16_t current_note = 0;
+
+static uint16_t output_period = 0;
+static uint16_t output_duty = 0;
+
+uint16_t envelope_index = 0;
+// envelope_index at 880 steps a second, whatever the note, in Q16
+static uint32_t envelope_position = 0;
+uint16_t note_timbre = AUDIO_TIMBRE(TIMBRE_DEFAULT);
+
+static float polyphony_rate = 0;
+// Timer ticks each voice plays for, 0 for no polyphony
+static uint32_t polyphony_interval = 0;
+
+#ifdef VIBRATO_ENABLE
+static float vibrato_rate = 0.125;
+static float vibrato_strength = .5;
+// Q8.8, the settings above converted
+static uint16_t vibrato_counter = 0;
+static uint16_t vibrato_step = 32;
+static uint16_t vibrato_amount = 128;
+#endif
+
+int16_t audio_frequency_to_pitch(float frequency)
+{
+    union {
+        float    f;
+        uint32_t bits;
+    } u = { .f = frequency };
+
+    // Zero, negative or too small to be a note
+    if ((int32_t)u.bits <= 0 || (u.bits >> 23) == 0) {
+        return AUDIO_PITCH_REST;
+    }
+
+    // log2 of the exponent and the mantissa, in Q16
+    int16_t exponent = (int16_t)(u.bits >> 23) - 127;
+    uint8_t index = (u.bits >> 17) & 0x3F;
+    uint32_t frac = u.bits & 0x1FFFF;
+    uint32_t low = pgm_read_word(&log2_lut[index]);
+    uint32_t high = index == 63 ? 65536 : pgm_read_word(&log2_lut[index + 1]);
+    int32_t log2 = ((int32_t)exponent << 16) + low + (((high - low) * frac) >> 17);
+
+    // 12 semitones of 256 an octave, 3 / 64 of the Q16 log2
+    int32_t pitch = ((log2 - LOG2_A1) * 3 + 32) >> 6;
+    if (pitch < -INT16_MAX) {
+        return -INT16_MAX;
+    }
+    return pitch > INT16_MAX ? INT16_MAX : pitch;
+}
+
+uint16_t audio_pitch_to_period(int16_t pitch)
+{
+    // Quarter semitones, and 64ths of them in between
+    int16_t index = pitch >> 6;
+    uint8_t frac = pitch & 0x3F;
+    int8_t octaves = 0;
+
+    while (index < 0) {
+        index += 48;
+        octaves--;
+    }
+    while (index >= FREQUENCY_LUT_LENGTH - 1) {
+        index -= 48;
+        octaves++;
+    }
+
+    uint16_t high = pgm_read_word(&frequency_lut[index]);
+    uint16_t low = pgm_read_word(&frequency_lut[index + 1]);
+    uint32_t period = high - (((uint32_t)(high - low) * frac) >> 6);
+
+#if F_CPU != 16000000
+    // The table is for 16MHz
+    period = (period * (uint32_t)(F_CPU / 16000000.0 * 65536)) >> 16;
+#endif
+
+    if (octaves > 0) {
+        period >>= octaves;
+    } else if (octaves < 0) {
+        if (-octaves > 15) {
+            return 0xFFFF;
+        }
+        period <<= -octaves;
+    }
+    return period > 0xFFFF ? 0xFFFF : period;
+}
+
+static uint16_t glide_step(uint16_t period)
+{
+    return ((uint32_t)period * GLIDE_SCALE + 0x8000) >> 16;
+}
+
+#ifdef VIBRATO_ENABLE
+
+static int16_t vibrato(int16_t pitch, uint16_t period)
+{
+    int16_t offset = (int8_t)pgm_read_byte(&vibrato_pitch_lut[vibrato_counter >> 8]);
+    #ifdef VIBRATO_STRENGTH_ENABLE
+        // A power of the factor is a multiple of the pitch
+        offset = (offset * (int16_t)vibrato_amount) >> 8;
+    #endif
+
+    // vibrato_rate * (1 + 440 / frequency)
+    uint32_t frequency_term = ((uint32_t)period * VIBRATO_SCALE) >> 8;
+    vibrato_counter += vibrato_step + ((frequency_term * vibrato_step) >> 16);
+    while (vibrato_counter >= (VIBRATO_LUT_LENGTH << 8)) {
+        vibrato_counter -= VIBRATO_LUT_LENGTH << 8;
+    }
+    return pitch + offset;
+}
+
+#endif
+
+static void reset_envelope(void)
+{
+    envelope_index = 0;
+    envelope_position = 0;
+}
+
+// Steps the envelope a period of the note, and returns it shaped by the voice
+static int16_t envelope(int16_t pitch, uint16_t period)
+{
+    if (envelope_index < 65535) {
+        uint32_t step = ((uint32_t)period * ENVELOPE_SCALE) >> 8;
+        envelope_index++;
+        envelope_position = envelope_position < 0xFFFF0000 - step ? envelope_position + step : 0xFFFF0000;
+    }
+    return voice_envelope(pitch, envelope_position >> 16);
+}
+
+static void output(int16_t pitch, uint16_t max_period)
+{
+    uint16_t period = audio_pitch_to_period(pitch);
+    if (period > max_period) {
+        period = max_period;
+    }
+    output_period = period;
+    output_duty = ((uint32_t)period * note_timbre) >> 16;
+}
+
+static bool song_ended(uint16_t index)
+{
+    if (song_pointer) {
+        return pgm_read_byte(&song_pointer[index].duration) == 0;
+    }
+    return index >= notes_count;
+}
+
+static void load_note(uint16_t index)
+{
+    uint16_t duration;
+
+    if (song_pointer) {
+        uint8_t note = pgm_read_byte(&song_pointer[index].note);
+        note_pitch = note == SONG_NOTE_REST ? AUDIO_PITCH_REST : (note - SONG_NOTE_A1) * 256;
+        duration = pgm_read_byte(&song_pointer[index].duration);
+    } else {
+        note_pitch = audio_frequency_to_pitch((*notes_pointer)[index][0]);
+        duration = (uint16_t)(*notes_pointer)[index][1];
+    }
+    note_period = note_pitch == AUDIO_PITCH_REST ? 0 : audio_pitch_to_period(note_pitch);
+    // duration / 4 * tempo / 100 times 65535 ticks
+    note_duration = ((uint32_t)duration * note_tempo * 10486) >> 6;
+}
+
+void audio_engine_stop_all(void)
+{
+    voice_count = 0;
+    playing_notes = false;
+    playing_note = false;
+    glide_pitch = AUDIO_PITCH_REST;
+}
+
+bool audio_engine_stop_note(float frequency)
+{
+    for (int8_t i = voice_count - 1; i >= 0; i--) {
+        if (voices[i].frequency == frequency) {
+            for (uint8_t j = i; j < voice_count - 1; j++) {
+                voices[j] = voices[j + 1];
+            }
+            break;
+        }
+    }
+    if (voice_count > 0) {
+        voice_count--;
+    }
+    if (voice_place >= voice_count) {
+        voice_place = 0;
+    }
+    if (voice_count == 0) {
+        glide_pitch = AUDIO_PITCH_REST;
+        playing_note = false;
+        return true;
+    }
+    return false;
+}
+
+bool audio_engine_play_note(float frequency, int volume)
+{
+    if (voice_count >= AUDIO_MAX_VOICES) {
+        return false;
+    }
+
+    if (playing_notes) {
+        audio_engine_stop_all();
+    }
+    playing_note = true;
+    reset_envelope();
+
+    if (frequency > 0) {
+        audio_voice_t *v = &voices[voice_count++];
+        v->frequency = frequency;
+        v->pitch = audio_frequency_to_pitch(frequency);
+        v->period = audio_pitch_to_period(v->pitch);
+        v->volume = volume;
+    }
+    return true;
+}
+
+static void start_song(bool n_repeat, float n_rest)
+{
+    if (playing_note) {
+        audio_engine_stop_all();
+    }
+    playing_notes = true;
+
+    notes_repeat = n_repeat;
+    notes_rest = n_rest * 65535;
+
+    place = 0;
+    current_note = 0;
+    note_resting = false;
+    reset_envelope();
+    load_note(current_note);
+    note_elapsed = 0;
+}
+
+void audio_engine_play_notes(float (*np)[][2], uint16_t n_count, bool n_repeat, float n_rest)
+{
+    notes_pointer = np;
+    song_pointer = NULL;
+    notes_count = n_count;
+    start_song(n_repeat, n_rest);
+}
+
+bool audio_engine_play_song(const song_note_t *song, bool n_repeat, float n_rest)
+{
+    if (pgm_read_byte(&song[0].duration) == 0) {
+        return false;
+    }
+    song_pointer = song;
+    start_song(n_repeat, n_rest);
+    return true;
+}
+
+bool audio_engine_playing_note(void)
+{
+    return playing_note;
+}
+
+bool is_playing_notes(void)
+{
+    return playing_notes;
+}
+
+bool audio_engine_tick(uint16_t *period, uint16_t *duty)
+{
+    int16_t pitch;
+    uint16_t base_period;
+
+    if (playing_note && voice_count > 0) {
+        if (polyphony_interval > 0) {
+            if (voice_count > 1) {
+                voice_place %= voice_count;
+                if (place > polyphony_interval) {
+                    voice_place = (voice_place + 1) % voice_count;
+                    place = 0;
+                }
+            }
+            pitch = voices[voice_place].pitch;
+            base_period = voices[voice_place].period;
+        } else {
+            audio_voice_t *target = &voices[voice_count - 1];
+            uint16_t threshold = glide_step(target->period);
+
+            if (glide_pitch != AUDIO_PITCH_REST && glide_pitch < target->pitch - threshold) {
+                glide_pitch += glide_step(glide_period);
+                glide_period = audio_pitch_to_period(glide_pitch);
+            } else if (glide_pitch != AUDIO_PITCH_REST && glide_pitch > target->pitch + threshold) {
+                glide_pitch -= glide_step(glide_period);
+                glide_period = audio_pitch_to_period(glide_pitch);
+            } else {
+                glide_pitch = target->pitch;
+                glide_period = target->period;
+            }
+            pitch = glide_pitch;
+            base_period = glide_period;
+        }
+
+        #ifdef VIBRATO_ENABLE
+            if (vibrato_amount > 0) {
+                pitch = vibrato(pitch, base_period);
+            }
+        #endif
+
+        output(envelope(pitch, base_period), AUDIO_MAX_PERIOD);
+        place += output_period;
+    }
+
+    if (playing_notes) {
+        if (note_pitch != AUDIO_PITCH_REST) {
+            pitch = note_pitch;
+            #ifdef VIBRATO_ENABLE
+                if (vibrato_amount > 0) {
+                    pitch = vibrato(pitch, note_period);
+                }
+            #endif
+
+            output(envelope(pitch, note_period), 0xFFFF);
+        } else {
+            output_period = AUDIO_REST_PERIOD;
+            output_duty = 0;
+        }
+
+        note_elapsed += output_period;
+        if (note_elapsed >= note_duration) {
+            current_note++;
+            if (song_ended(current_note)) {
+                if (notes_repeat) {
+                    current_note = 0;
+                } else {
+                    playing_notes = false;
+                    return false;
+                }
+            }
+            if (!note_resting && (notes_rest > 0)) {
+                note_resting = true;
+                note_pitch = AUDIO_PITCH_REST;
+                note_duration = notes_rest;
+                current_note--;
+            } else {
+                note_resting = false;
+                reset_envelope();
+                load_note(current_note);
+            }
+
+            note_elapsed = 0;
+        }
+    }
+
+    *period = output_period;
+    *duty = output_duty;
+    return true;
+}
+
+#ifdef VIBRATO_ENABLE
+
+static void update_vibrato(void)
+{
+    vibrato_step = vibrato_rate * 256;
+    vibrato_amount = vibrato_strength * 256;
+}
+
+// Vibrato rate functions
+
+void set_vibrato_rate(float rate) {
+    vibrato_rate = rate;
+    update_vibrato();
+}
+
+void increase_vibrato_rate(float change) {
+    vibrato_rate *= change;
+    update_vibrato();
+}
+
+void decrease_vibrato_rate(float change) {
+    vibrato_rate /= change;
+    update_vibrato();
+}
+
+#ifdef VIBRATO_STRENGTH_ENABLE
+
+void set_vibrato_strength(float strength) {
+    vibrato_strength = strength;
+    update_vibrato();
+}
+
+void increase_vibrato_strength(float change) {
+    vibrato_strength *= change;
+    update_vibrato();
+}
+
+void decrease_vibrato_strength(float change) {
+    vibrato_strength /= change;
+    update_vibrato();
+}
+
+#endif  /* VIBRATO_STRENGTH_ENABLE */
+
+#endif /* VIBRATO_ENABLE */
+
+// Polyphony functions
+
+static void update_polyphony(void) {
+    // The voices take turns every 1 / (8 * rate) seconds
+    if (polyphony_rate > 0) {
+        polyphony_interval = AUDIO_TIMER_CLOCK / (AUDIO_CPU_PRESCALER * polyphony_rate);
+    } else {
+        polyphony_interval = 0;
+    }
+}
+
+void set_polyphony_rate(float rate) {
+    polyphony_rate = rate;
+    update_polyphony();
+}
+
+void enable_polyphony() {
+    polyphony_rate = 5;
+    update_polyphony();
+}
+
+void disable_polyphony() {
+    polyphony_rate = 0;
+    polyphony_interval = 0;
+}
+
+void increase_polyphony_rate(float change) {
+    polyphony_rate *= change;
+    update_polyphony();
+}
+
+void decrease_polyphony_rate(float change) {
+    polyphony_rate /= change;
+    update_polyphony();
+}
+
+// Timbre function
+
+void set_timbre(float timbre) {
+    note_timbre = AUDIO_TIMBRE(timbre);
+}
+
+// Tempo functions
+
+void set_tempo(uint8_t tempo) {
+    note_tempo = tempo;
+}
+
+void decrease_tempo(uint8_t tempo_change) {
+    note_tempo += tempo_change;
+}
+
+void increase_tempo(uint8_t tempo_change) {
+    if (note_tempo - tempo_change < 10) {
+        note_tempo = 10;
+    } else {
+        note_tempo -= tempo_change;
+    }
+}
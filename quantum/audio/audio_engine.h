@@ -0,0 +1,81 @@
+#ifndef AUDIO_ENGINE_H
+#define AUDIO_ENGINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "musical_notes.h"
+
+/* Sound engine of audio.c
+ *
+ * Runs once per period of the output, from the timer interrupt, so it only
+ * uses integer math. Pitches are semitones above A1 (55Hz) in Q8.8, which
+ * index frequency_lut for the timer period, so glides, vibrato and the voice
+ * envelopes are additions to the pitch. The float notes and durations of
+ * songs are converted once per note, the float settings when they change.
+ */
+
+#define AUDIO_MAX_VOICES 8
+#define AUDIO_CPU_PRESCALER 8
+
+// Pitch of a rest, or of no note at all
+#define AUDIO_PITCH_REST INT16_MIN
+// Timer period while resting, the output is off
+#define AUDIO_REST_PERIOD 1000
+
+// Timbres are the part of the period the output is high, in Q0.16
+#define AUDIO_TIMBRE(timbre) ((uint16_t)((timbre) >= 1 ? 0xFFFF : (timbre) * 65536))
+
+// Shared with voice_envelope(), in voices.c
+extern uint16_t envelope_index;
+extern uint16_t note_timbre;
+
+int16_t audio_frequency_to_pitch(float frequency);
+uint16_t audio_pitch_to_period(int16_t pitch);
+
+void audio_engine_stop_all(void);
+// Returns true when that was the last voice
+bool audio_engine_stop_note(float frequency);
+// Returns false when all the voices are taken
+bool audio_engine_play_note(float frequency, int volume);
+void audio_engine_play_notes(float (*np)[][2], uint16_t n_count, bool n_repeat, float n_rest);
+// Returns false for an empty song
+bool audio_engine_play_song(const song_note_t *song, bool n_repeat, float n_rest);
+bool audio_engine_playing_note(void);
+// Computes the next period of the output, returns false when a song ended
+bool audio_engine_tick(uint16_t *period, uint16_t *duty);
+
+bool is_playing_notes(void);
+
+// Vibrato rate functions
+
+#ifdef VIBRATO_ENABLE
+
+void set_vibrato_rate(float rate);
+void increase_vibrato_rate(float change);
+void decrease_vibrato_rate(float change);
+
+#ifdef VIBRATO_STRENGTH_ENABLE
+
+void set_vibrato_strength(float strength);
+void increase_vibrato_strength(float change);
+void decrease_vibrato_strength(float change);
+
+#endif
+
+#endif
+
+// Polyphony functions
+
+void set_polyphony_rate(float rate);
+void enable_polyphony(void);
+void disable_polyphony(void);
+void increase_polyphony_rate(float change);
+void decrease_polyphony_rate(float change);
+
+void set_timbre(float timbre);
+void set_tempo(uint8_t tempo);
+
+void increase_tempo(uint8_t tempo_change);
+void decrease_tempo(uint8_t tempo_change);
+
+#endif
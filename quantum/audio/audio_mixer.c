@@ -0,0 +1,108 @@
+#include "audio_mixer.h"
+
+const int16_t audio_wave_square[AUDIO_WAVE_LENGTH + 1] = {
+     32767,  32767,  32767,  32767,  32767,  32767,  32767,  32767,
+     32767,  32767,  32767,  32767,  32767,  32767,  32767,  32767,
+     32767,  32767,  32767,  32767,  32767,  32767,  32767,  32767,
+     32767,  32767,  32767,  32767,  32767,  32767,  32767,  32767,
+    -32767, -32767, -32767, -32767, -32767, -32767, -32767, -32767,
+    -32767, -32767, -32767, -32767, -32767, -32767, -32767, -32767,
+    -32767, -32767, -32767, -32767, -32767, -32767, -32767, -32767,
+    -32767, -32767, -32767, -32767, -32767, -32767, -32767, -32767,
+     32767,
+};
+
+const int16_t audio_wave_triangle[AUDIO_WAVE_LENGTH + 1] = {
+         0,   2048,   4096,   6144,   8192,  10240,  12288,  14336,
+     16384,  18431,  20479,  22527,  24575,  26623,  28671,  30719,
+     32767,  30719,  28671,  26623,  24575,  22527,  20479,  18431,
+     16384,  14336,  12288,  10240,   8192,   6144,   4096,   2048,
+         0,  -2048,  -4096,  -6144,  -8192, -10240, -12288, -14336,
+    -16384, -18431, -20479, -22527, -24575, -26623, -28671, -30719,
+    -32767, -30719, -28671, -26623, -24575, -22527, -20479, -18431,
+    -16384, -14336, -12288, -10240,  -8192,  -6144,  -4096,  -2048,
+         0,
+};
+
+/* (0..64).each {|i| p (Math.sin(2 * Math::PI * i / 64) * 32767).round }
+ */
+const int16_t audio_wave_sine[AUDIO_WAVE_LENGTH + 1] = {
+         0,   3212,   6393,   9512,  12539,  15446,  18204,  20787,
+     23170,  25329,  27245,  28898,  30273,  31356,  32137,  32609,
+     32767,  32609,  32137,  31356,  30273,  28898,  27245,  25329,
+     23170,  20787,  18204,  15446,  12539,   9512,   6393,   3212,
+         0,  -3212,  -6393,  -9512, -12539, -15446, -18204, -20787,
+    -23170, -25329, -27245, -28898, -30273, -31356, -32137, -32609,
+    -32767, -32609, -32137, -31356, -30273, -28898, -27245, -25329,
+    -23170, -20787, -18204, -15446, -12539,  -9512,  -6393,  -3212,
+         0,
+};
+
+const int16_t audio_wave_sawtooth[AUDIO_WAVE_LENGTH + 1] = {
+         0,   1024,   2048,   3072,   4096,   5120,   6144,   7168,
+      8192,   9216,  10240,  11264,  12288,  13312,  14336,  15360,
+     16384,  17407,  18431,  19455,  20479,  21503,  22527,  23551,
+     24575,  25599,  26623,  27647,  28671,  29695,  30719,  31743,
+    -32767, -31743, -30719, -29695, -28671, -27647, -26623, -25599,
+    -24575, -23551, -22527, -21503, -20479, -19455, -18431, -17407,
+    -16384, -15360, -14336, -13312, -12288, -11264, -10240,  -9216,
+     -8192,  -7168,  -6144,  -5120,  -4096,  -3072,  -2048,  -1024,
+         0,
+};
+
+/* NOTE_C8 to NOTE_B8 in Q16, the lower octaves are shifts of these
+ * (0..11).each {|s| p (440 * 2**((s + 39) / 12.0) * 65536).round }
+ */
+static const uint32_t octave_8_frequencies[12] = {
+    274334289, 290647054, 307929828, 326240288, 345639545, 366192342,
+    387967272, 411037006, 435478539, 461373440, 488808132, 517874176,
+};
+
+uint32_t audio_mixer_step(float frequency, uint32_t sample_rate)
+{
+    if (frequency <= 0 || frequency >= sample_rate / 2) {
+        return 0;
+    }
+    return (uint32_t)(frequency / sample_rate * 4294967296.0f);
+}
+
+uint32_t audio_mixer_note_step(uint8_t note, uint32_t sample_rate)
+{
+    // Rests, and anything past NOTE_B8
+    if (note >= 9 * 12) {
+        return 0;
+    }
+    uint32_t frequency = octave_8_frequencies[note % 12] >> (8 - note / 12);
+    if ((frequency >> 16) >= sample_rate / 2) {
+        return 0;
+    }
+    return ((uint64_t)frequency << 16) / sample_rate;
+}
+
+void audio_mixer_render(audio_mixer_voice_t *voices, uint8_t count, uint16_t *buffer, uint16_t length)
+{
+    for (uint16_t i = 0; i < length; i++) {
+        int32_t mix = 0;
+
+        for (uint8_t v = 0; v < count; v++) {
+            audio_mixer_voice_t *voice = &voices[v];
+            // The top 6 bits pick the sample, the next 15 go between it and the next one
+            uint8_t index = voice->phase >> 26;
+            int32_t frac = (voice->phase >> 11) & 0x7FFF;
+            int32_t low = voice->wave[index];
+            int32_t high = voice->wave[index + 1];
+            int32_t sample = low + (((high - low) * frac) >> 15);
+
+            mix += sample * voice->volume;
+            voice->phase += voice->step;
+        }
+
+        mix = AUDIO_MIXER_MIDPOINT + (mix >> AUDIO_MIXER_SHIFT);
+        if (mix < 0) {
+            mix = 0;
+        } else if (mix > AUDIO_MIXER_MAX) {
+            mix = AUDIO_MIXER_MAX;
+        }
+        buffer[i] = mix;
+    }
+}
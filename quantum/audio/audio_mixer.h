@@ -0,0 +1,52 @@
+#ifndef AUDIO_MIXER_H
+#define AUDIO_MIXER_H
+
+#include <stdint.h>
+
+/* Wavetable mixer of audio_arm.c
+ *
+ * Mixes voices into a block of samples for a 12-bit DAC, centered on
+ * AUDIO_MIXER_MIDPOINT. Each voice steps through a wavetable at its own
+ * rate, so any number of notes sound at once, instead of taking turns on a
+ * single PWM pin. Only integer math, a block at a time.
+ */
+
+#ifndef AUDIO_MIXER_VOICES
+#define AUDIO_MIXER_VOICES 8
+#endif
+
+// Scales the mix to the DAC. At 12 a single voice at full volume fills its
+// range, each step more doubles the voices that fit before the mix clips
+#ifndef AUDIO_MIXER_SHIFT
+#define AUDIO_MIXER_SHIFT 13
+#endif
+
+#define AUDIO_MIXER_MIDPOINT 2048
+#define AUDIO_MIXER_MAX 4095
+
+// Samples a cycle, the tables have the first one again at the end
+#define AUDIO_WAVE_LENGTH 64
+
+extern const int16_t audio_wave_square[AUDIO_WAVE_LENGTH + 1];
+extern const int16_t audio_wave_triangle[AUDIO_WAVE_LENGTH + 1];
+extern const int16_t audio_wave_sine[AUDIO_WAVE_LENGTH + 1];
+extern const int16_t audio_wave_sawtooth[AUDIO_WAVE_LENGTH + 1];
+
+typedef struct {
+    const int16_t *wave;
+    // Position in the wave, a whole cycle is 2^32
+    uint32_t phase;
+    uint32_t step;
+    // 0 is silent, 255 full
+    uint8_t  volume;
+} audio_mixer_voice_t;
+
+// Phase step of a frequency, once per note
+uint32_t audio_mixer_step(float frequency, uint32_t sample_rate);
+// The same for a note of a song_note_t, without floats
+uint32_t audio_mixer_note_step(uint8_t note, uint32_t sample_rate);
+
+// Writes length samples of the voices to buffer, and moves them along
+void audio_mixer_render(audio_mixer_voice_t *voices, uint8_t count, uint16_t *buffer, uint16_t length);
+
+#endif
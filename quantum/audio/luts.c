@@ -1,6 +1,3 @@
-#include <avr/io.h>
-#include <avr/interrupt.h>
-#include <avr/pgmspace.h>
 #include "luts.h"
 
 const float vibrato_lut[VIBRATO_LUT_LENGTH] =
@@ -27,7 +24,15 @@ const float vibrato_lut[VIBRATO_LUT_LENGTH] =
 	1.0000000000000,
 };
 
-const uint16_t frequency_lut[FREQUENCY_LUT_LENGTH] =
+/* 12 * log2(vibrato_lut[i]) * 256
+ */
+const int8_t vibrato_pitch_lut[VIBRATO_LUT_LENGTH] PROGMEM =
+{
+	10, 19, 26, 30, 32, 30, 26, 19, 10, 0,
+	-10, -19, -26, -30, -32, -30, -26, -19, -10, 0,
+};
+
+const uint16_t frequency_lut[FREQUENCY_LUT_LENGTH] PROGMEM =
 {
 	0x8E0B,
 	0x8C02,
@@ -1,6 +1,5 @@
-#include <avr/io.h>
-#include <avr/interrupt.h>
-#include <avr/pgmspace.h>
+#include <stdint.h>
+#include "progmem.h"
 
 #ifndef LUTS_H
 #define LUTS_H
@@ -10,6 +9,9 @@
 #define FREQUENCY_LUT_LENGTH 349
 
 extern const float vibrato_lut[VIBRATO_LUT_LENGTH];
-extern const uint16_t frequency_lut[FREQUENCY_LUT_LENGTH];
+// vibrato_lut in Q8.8 semitones, what it adds to the pitch
+extern const int8_t vibrato_pitch_lut[VIBRATO_LUT_LENGTH] PROGMEM;
+// Timer periods at F_CPU / 8 = 2MHz, from 55Hz (A1) up in quarter semitones
+extern const uint16_t frequency_lut[FREQUENCY_LUT_LENGTH] PROGMEM;
 
 #endif /* LUTS_H */
\ No newline at end of file
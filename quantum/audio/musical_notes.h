@@ -1,12 +1,43 @@
 #ifndef MUSICAL_NOTES_H
 #define MUSICAL_NOTES_H
 
+#include <stdint.h>
+
 // Tempo Placeholder
 #define TEMPO_DEFAULT 100
 
 
 #define SONG(notes...) { notes }
 
+// Songs for play_song(), two bytes a note in flash rather than two floats
+typedef struct {
+    // Semitones above NOTE_C0, or SONG_NOTE_REST
+    uint8_t note;
+    // Like the durations of the note types below, 0 ends the song
+    uint8_t duration;
+} song_note_t;
+
+#define SONG_NOTE_REST 0xFF
+// NOTE_A1, the 55Hz of frequency_lut[0]
+#define SONG_NOTE_A1 21
+
+#define SONG_NOTE_P(note, duration)    { SONG_NOTE_INDEX(NOTE##note), duration }
+#define SONG_END                       { SONG_NOTE_REST, 0 }
+
+// The note a frequency is closest to, at compile time. Counts the octaves,
+// then the semitones of the frequency moved down to octave 0, against the
+// quarter tones below each C, and each note of octave 0.
+#define SONG_NOTE_OCTAVE(f) \
+    (((f) >= 31.77) + ((f) >= 63.54) + ((f) >= 127.09) + ((f) >= 254.18) + \
+     ((f) >= 508.36) + ((f) >= 1016.71) + ((f) >= 2033.42) + ((f) >= 4066.84))
+#define SONG_NOTE_SEMITONE(f) \
+    (((f) >= 16.831) + ((f) >= 17.832) + ((f) >= 18.892) + ((f) >= 20.015) + \
+     ((f) >= 21.205) + ((f) >= 22.466) + ((f) >= 23.802) + ((f) >= 25.218) + \
+     ((f) >= 26.717) + ((f) >= 28.306) + ((f) >= 29.989))
+#define SONG_NOTE_INDEX(f) \
+    ((f) <= 0 ? SONG_NOTE_REST : \
+     SONG_NOTE_OCTAVE(f) * 12 + SONG_NOTE_SEMITONE((f) / (1 << SONG_NOTE_OCTAVE(f))))
+
 
 // Note Types
 #define MUSICAL_NOTE(note, duration)   {(NOTE##note), duration}
@@ -0,0 +1,29 @@
+#include "song_list.h"
+#include "progmem.h"
+
+// The songs of song_list.h for play_song(). The linker drops the ones a
+// keymap doesn't play.
+#undef MUSICAL_NOTE
+#define MUSICAL_NOTE(note, duration) SONG_NOTE_P(note, duration)
+
+#define PROGMEM_SONG(name, notes) const song_note_t name[] PROGMEM = { notes SONG_END }
+
+PROGMEM_SONG(song_ode_to_joy, ODE_TO_JOY);
+PROGMEM_SONG(song_rock_a_bye_baby, ROCK_A_BYE_BABY);
+PROGMEM_SONG(song_close_encounters_5_note, CLOSE_ENCOUNTERS_5_NOTE);
+PROGMEM_SONG(song_doe_a_deer, DOE_A_DEER);
+PROGMEM_SONG(song_in_like_flint, IN_LIKE_FLINT);
+PROGMEM_SONG(song_goodbye_sound, GOODBYE_SOUND);
+PROGMEM_SONG(song_startup_sound, STARTUP_SOUND);
+PROGMEM_SONG(song_qwerty_sound, QWERTY_SOUND);
+PROGMEM_SONG(song_colemak_sound, COLEMAK_SOUND);
+PROGMEM_SONG(song_dvorak_sound, DVORAK_SOUND);
+PROGMEM_SONG(song_plover_sound, PLOVER_SOUND);
+PROGMEM_SONG(song_plover_goodbye_sound, PLOVER_GOODBYE_SOUND);
+PROGMEM_SONG(song_music_scale_sound, MUSIC_SCALE_SOUND);
+PROGMEM_SONG(song_caps_lock_on_sound, CAPS_LOCK_ON_SOUND);
+PROGMEM_SONG(song_caps_lock_off_sound, CAPS_LOCK_OFF_SOUND);
+PROGMEM_SONG(song_scroll_lock_on_sound, SCROLL_LOCK_ON_SOUND);
+PROGMEM_SONG(song_scroll_lock_off_sound, SCROLL_LOCK_OFF_SOUND);
+PROGMEM_SONG(song_num_lock_on_sound, NUM_LOCK_ON_SOUND);
+PROGMEM_SONG(song_num_lock_off_sound, NUM_LOCK_OFF_SOUND);
@@ -122,4 +122,25 @@
     E__NOTE(_E5),          \
     E__NOTE(_D5),
 
+// The same songs in flash, for play_song(), see song_list.c
+extern const song_note_t song_ode_to_joy[];
+extern const song_note_t song_rock_a_bye_baby[];
+extern const song_note_t song_close_encounters_5_note[];
+extern const song_note_t song_doe_a_deer[];
+extern const song_note_t song_in_like_flint[];
+extern const song_note_t song_goodbye_sound[];
+extern const song_note_t song_startup_sound[];
+extern const song_note_t song_qwerty_sound[];
+extern const song_note_t song_colemak_sound[];
+extern const song_note_t song_dvorak_sound[];
+extern const song_note_t song_plover_sound[];
+extern const song_note_t song_plover_goodbye_sound[];
+extern const song_note_t song_music_scale_sound[];
+extern const song_note_t song_caps_lock_on_sound[];
+extern const song_note_t song_caps_lock_off_sound[];
+extern const song_note_t song_scroll_lock_on_sound[];
+extern const song_note_t song_scroll_lock_off_sound[];
+extern const song_note_t song_num_lock_on_sound[];
+extern const song_note_t song_num_lock_off_sound[];
+
 #endif
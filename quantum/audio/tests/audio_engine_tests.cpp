@@ -0,0 +1,187 @@
+#include "gtest/gtest.h"
+#include <cmath>
+#include <vector>
+extern "C" {
+#include "audio_engine.h"
+#include "voices.h"
+#include "musical_notes.h"
+#include "song_list.h"
+}
+
+#define TIMER_CLOCK (16000000.0 / AUDIO_CPU_PRESCALER)
+
+struct Tone {
+    uint16_t period;
+    uint16_t duty;
+    uint32_t count;
+};
+
+// What the old float interrupt played: each note for note_length / period * 0xFFFF
+// periods of F_CPU / (frequency * CPU_PRESCALER)
+static std::vector<Tone> reference_song(float (*notes)[][2], uint16_t count, float timbre) {
+    std::vector<Tone> runs;
+    for (uint16_t i = 0; i < count; i++) {
+        float frequency = (*notes)[i][0];
+        if (frequency <= 0) {
+            continue;
+        }
+        float length = ((*notes)[i][1] / 4) * (TEMPO_DEFAULT / 100.0f);
+        uint16_t period = (uint16_t)(TIMER_CLOCK / frequency);
+        uint16_t duty = (uint16_t)(TIMER_CLOCK / frequency * timbre);
+        runs.push_back({period, duty, (uint32_t)std::ceil(length / period * 0xFFFF)});
+    }
+    return runs;
+}
+
+// The periods the engine plays, with the rests between notes left out
+static std::vector<Tone> engine_song(float (*notes)[][2], uint16_t count) {
+    std::vector<Tone> runs;
+    uint16_t period, duty;
+    bool resting = true;
+    audio_engine_play_notes(notes, count, false, 1);
+    while (audio_engine_tick(&period, &duty)) {
+        if (duty == 0) {
+            resting = true;
+            continue;
+        }
+        if (resting || runs.back().period != period) {
+            runs.push_back({period, duty, 0});
+        }
+        resting = false;
+        runs.back().count++;
+    }
+    return runs;
+}
+
+class AudioEngine : public testing::Test {
+protected:
+    void SetUp() override {
+        audio_engine_stop_all();
+        set_voice(default_voice);
+        set_tempo(TEMPO_DEFAULT);
+    }
+};
+
+TEST_F(AudioEngine, a4_plays_at_the_old_period) {
+    EXPECT_EQ(audio_pitch_to_period(audio_frequency_to_pitch(NOTE_A4)), 4545);
+}
+
+TEST_F(AudioEngine, notes_match_the_float_periods) {
+    for (float frequency = 30.6f; frequency < 8000; frequency *= 1.013f) {
+        double expected = TIMER_CLOCK / frequency;
+        uint16_t period = audio_pitch_to_period(audio_frequency_to_pitch(frequency));
+        ASSERT_NEAR(period, expected, expected * 0.0005 + 1) << frequency << "Hz";
+    }
+}
+
+TEST_F(AudioEngine, rests_and_silly_frequencies_have_no_pitch) {
+    EXPECT_EQ(audio_frequency_to_pitch(0), AUDIO_PITCH_REST);
+    EXPECT_EQ(audio_frequency_to_pitch(-440), AUDIO_PITCH_REST);
+    EXPECT_EQ(audio_pitch_to_period(audio_frequency_to_pitch(1)), 0xFFFF);
+}
+
+TEST_F(AudioEngine, songs_play_like_the_float_engine) {
+    float song[][2] = SONG(ODE_TO_JOY ROCK_A_BYE_BABY DOE_A_DEER);
+    uint16_t count = sizeof(song) / sizeof(song[0]);
+
+    std::vector<Tone> expected = reference_song(&song, count, TIMBRE_50);
+    std::vector<Tone> actual = engine_song(&song, count);
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        EXPECT_NEAR(actual[i].period, expected[i].period, expected[i].period * 0.0005 + 1) << "note " << i;
+        EXPECT_NEAR(actual[i].duty, expected[i].duty, expected[i].duty * 0.0005 + 1) << "note " << i;
+        EXPECT_NEAR(actual[i].count, expected[i].count, 1) << "note " << i;
+    }
+}
+
+TEST_F(AudioEngine, songs_stop_at_the_end_unless_they_repeat) {
+    float song[][2] = SONG(E__NOTE(_C4), E__NOTE(_REST), E__NOTE(_C5));
+    uint16_t period, duty;
+
+    audio_engine_play_notes(&song, 3, true, 0);
+    for (uint32_t i = 0; i < 100000; i++) {
+        ASSERT_TRUE(audio_engine_tick(&period, &duty));
+    }
+    EXPECT_TRUE(is_playing_notes());
+
+    audio_engine_play_notes(&song, 3, false, 0);
+    uint32_t ticks = 0;
+    while (audio_engine_tick(&period, &duty)) {
+        ticks++;
+        ASSERT_LT(ticks, 100000u);
+    }
+    EXPECT_FALSE(is_playing_notes());
+}
+
+TEST_F(AudioEngine, play_note_glides_to_the_new_note) {
+    uint16_t period, duty;
+
+    audio_engine_play_note(NOTE_A4, 0xF);
+    audio_engine_tick(&period, &duty);
+    EXPECT_EQ(period, 4545);
+
+    // An octave up, which the old engine took about 440 * 12 / 220 periods for
+    audio_engine_play_note(NOTE_A5, 0xF);
+    uint16_t previous = period;
+    int periods = 0;
+    do {
+        audio_engine_tick(&period, &duty);
+        ASSERT_LE(period, previous);
+        previous = period;
+        periods++;
+    } while (period > 2272 + 1 && periods < 1000);
+    EXPECT_NEAR(periods, 24, 12);
+
+    EXPECT_FALSE(audio_engine_stop_note(NOTE_A5));
+    EXPECT_TRUE(audio_engine_stop_note(NOTE_A4));
+    EXPECT_FALSE(audio_engine_playing_note());
+}
+
+TEST_F(AudioEngine, butts_fader_drops_two_octaves_then_fades_out) {
+    uint16_t period, duty;
+
+    set_voice(butts_fader);
+    audio_engine_play_note(NOTE_A4, 0xF);
+    audio_engine_tick(&period, &duty);
+    EXPECT_NEAR(period, 4545 * 4, 4);
+    EXPECT_NEAR(duty, period * TIMBRE_12, 2);
+
+    // 880 envelope steps a second, the fade is over after 200
+    for (int i = 0; i < 440 * 250 / 880; i++) {
+        audio_engine_tick(&period, &duty);
+    }
+    EXPECT_EQ(period, 4545);
+    EXPECT_LT(duty, period / 100);
+}
+
+TEST_F(AudioEngine, duty_osc_stays_within_its_amplitude) {
+    uint16_t period, duty;
+
+    set_voice(duty_osc);
+    audio_engine_play_note(NOTE_A4, 0xF);
+    for (int i = 0; i < 5000; i++) {
+        audio_engine_tick(&period, &duty);
+        ASSERT_GE(duty, period * .375 - 1);
+        ASSERT_LE(duty, period * .625 + 1);
+    }
+}
+
+TEST_F(AudioEngine, delayed_vibrato_waits_before_it_bends_the_note) {
+    uint16_t period, duty;
+    uint16_t low = 0xFFFF, high = 0;
+
+    set_voice(delayed_vibrato);
+    audio_engine_play_note(NOTE_A4, 0xF);
+    for (int i = 0; i < 440 * 150 / 880; i++) {
+        audio_engine_tick(&period, &duty);
+        ASSERT_EQ(period, 4545);
+    }
+    for (int i = 0; i < 440; i++) {
+        audio_engine_tick(&period, &duty);
+        low = period < low ? period : low;
+        high = period > high ? period : high;
+    }
+    // vibrato_lut bends the note by an eighth of a semitone each way
+    EXPECT_NEAR(low, 4545 / 1.00725, 2);
+    EXPECT_NEAR(high, 4545 * 1.00725, 2);
+}
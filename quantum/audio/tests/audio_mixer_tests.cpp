@@ -0,0 +1,103 @@
+#include "gtest/gtest.h"
+#include <cmath>
+extern "C" {
+#include "audio_mixer.h"
+}
+
+static void expect_samples(const uint16_t *actual, const uint16_t *expected, int length) {
+    for (int i = 0; i < length; i++) {
+        EXPECT_EQ(actual[i], expected[i]) << "sample " << i;
+    }
+}
+
+TEST(AudioMixer, no_voices_is_the_midpoint) {
+    uint16_t buffer[8];
+    audio_mixer_render(NULL, 0, buffer, 8);
+    for (int i = 0; i < 8; i++) {
+        EXPECT_EQ(buffer[i], AUDIO_MIXER_MIDPOINT);
+    }
+}
+
+TEST(AudioMixer, a_sine_voice) {
+    const uint16_t golden[16] = {
+        2048, 2438, 2769, 2990, 3067, 2990, 2769, 2438,
+        2048, 1657, 1326, 1105, 1028, 1105, 1326, 1657,
+    };
+    audio_mixer_voice_t voice = { audio_wave_sine, 0, 1UL << 28, 255 };
+    uint16_t buffer[16];
+
+    audio_mixer_render(&voice, 1, buffer, 16);
+    expect_samples(buffer, golden, 16);
+    EXPECT_EQ(voice.phase, 0u);
+}
+
+TEST(AudioMixer, steps_between_the_samples_of_the_table_are_interpolated) {
+    const uint16_t golden[24] = {
+        2048, 2133, 2218, 2303, 2389, 2474, 2559, 2474,
+        2389, 2304, 2218, 2133, 2048, 1962, 1877, 1792,
+        1706, 1621, 1536, 1621, 1706, 1791, 1877, 1962,
+    };
+    // 24 samples a cycle, at half volume
+    audio_mixer_voice_t voice = { audio_wave_triangle, 0, (uint32_t)(4294967296.0 / 24), 128 };
+    uint16_t buffer[24];
+
+    audio_mixer_render(&voice, 1, buffer, 24);
+    expect_samples(buffer, golden, 24);
+}
+
+TEST(AudioMixer, voices_add_up) {
+    const uint16_t golden[16] = {
+        3577, 3641, 3705, 3769, 3832, 3896, 3960, 4024,
+           8,   71,  135,  199,  263,  326,  390,  454,
+    };
+    audio_mixer_voice_t voices[2] = {
+        { audio_wave_square, 0, 1UL << 28, 255 },
+        // Half the frequency, a quarter cycle in
+        { audio_wave_sawtooth, 1UL << 30, 1UL << 27, 255 },
+    };
+    uint16_t buffer[16];
+
+    audio_mixer_render(voices, 2, buffer, 16);
+    expect_samples(buffer, golden, 16);
+}
+
+TEST(AudioMixer, a_loud_mix_clips_to_the_dac) {
+    const uint16_t golden[8] = { 4095, 4095, 4095, 4095, 0, 0, 0, 0 };
+    audio_mixer_voice_t voices[4];
+    uint16_t buffer[8];
+
+    for (int i = 0; i < 4; i++) {
+        voices[i] = { audio_wave_square, 0, 1UL << 29, 255 };
+    }
+    audio_mixer_render(voices, 4, buffer, 8);
+    expect_samples(buffer, golden, 8);
+}
+
+TEST(AudioMixer, blocks_carry_on_where_the_last_one_stopped) {
+    audio_mixer_voice_t whole = { audio_wave_sine, 0, audio_mixer_step(440, 24000), 255 };
+    audio_mixer_voice_t split = whole;
+    uint16_t expected[100], actual[100];
+
+    audio_mixer_render(&whole, 1, expected, 100);
+    audio_mixer_render(&split, 1, actual, 37);
+    audio_mixer_render(&split, 1, actual + 37, 63);
+    expect_samples(actual, expected, 100);
+}
+
+TEST(AudioMixer, a_sine_voice_follows_the_float_sine) {
+    audio_mixer_voice_t voice = { audio_wave_sine, 0, audio_mixer_step(440, 24000), 255 };
+    uint16_t buffer[1000];
+
+    audio_mixer_render(&voice, 1, buffer, 1000);
+    for (int i = 0; i < 1000; i++) {
+        double expected = AUDIO_MIXER_MIDPOINT + std::sin(2 * M_PI * 440 * i / 24000) * 32767 * 255 / (1 << AUDIO_MIXER_SHIFT);
+        // The straight lines between the 64 samples of the table, and the shift
+        ASSERT_NEAR(buffer[i], expected, 3) << "sample " << i;
+    }
+}
+
+TEST(AudioMixer, frequencies_past_the_nyquist_limit_are_silent) {
+    EXPECT_EQ(audio_mixer_step(0, 24000), 0u);
+    EXPECT_EQ(audio_mixer_step(12000, 24000), 0u);
+    EXPECT_EQ(audio_mixer_step(6000, 24000), 1UL << 30);
+}
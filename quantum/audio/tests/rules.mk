@@ -0,0 +1,19 @@
+audio_engine_DEFS := -DF_CPU=16000000
+audio_engine_SRC :=\
+	$(QUANTUM_PATH)/audio/tests/audio_engine_tests.cpp \
+	$(QUANTUM_PATH)/audio/audio_engine.c \
+	$(QUANTUM_PATH)/audio/voices.c \
+	$(QUANTUM_PATH)/audio/luts.c
+
+audio_mixer_SRC :=\
+	$(QUANTUM_PATH)/audio/tests/audio_mixer_tests.cpp \
+	$(QUANTUM_PATH)/audio/audio_mixer.c
+
+song_list_DEFS := -DF_CPU=16000000
+song_list_SRC :=\
+	$(QUANTUM_PATH)/audio/tests/song_list_tests.cpp \
+	$(QUANTUM_PATH)/audio/song_list.c \
+	$(QUANTUM_PATH)/audio/audio_engine.c \
+	$(QUANTUM_PATH)/audio/audio_mixer.c \
+	$(QUANTUM_PATH)/audio/voices.c \
+	$(QUANTUM_PATH)/audio/luts.c
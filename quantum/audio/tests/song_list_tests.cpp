@@ -0,0 +1,141 @@
+#include "gtest/gtest.h"
+#include <cmath>
+#include <vector>
+extern "C" {
+#include "audio_engine.h"
+#include "audio_mixer.h"
+#include "voices.h"
+#include "song_list.h"
+}
+
+#define SONGS(X) \
+    X(ODE_TO_JOY, song_ode_to_joy) \
+    X(ROCK_A_BYE_BABY, song_rock_a_bye_baby) \
+    X(CLOSE_ENCOUNTERS_5_NOTE, song_close_encounters_5_note) \
+    X(DOE_A_DEER, song_doe_a_deer) \
+    X(IN_LIKE_FLINT, song_in_like_flint) \
+    X(GOODBYE_SOUND, song_goodbye_sound) \
+    X(STARTUP_SOUND, song_startup_sound) \
+    X(QWERTY_SOUND, song_qwerty_sound) \
+    X(COLEMAK_SOUND, song_colemak_sound) \
+    X(DVORAK_SOUND, song_dvorak_sound) \
+    X(PLOVER_SOUND, song_plover_sound) \
+    X(PLOVER_GOODBYE_SOUND, song_plover_goodbye_sound) \
+    X(MUSIC_SCALE_SOUND, song_music_scale_sound) \
+    X(CAPS_LOCK_ON_SOUND, song_caps_lock_on_sound) \
+    X(CAPS_LOCK_OFF_SOUND, song_caps_lock_off_sound) \
+    X(SCROLL_LOCK_ON_SOUND, song_scroll_lock_on_sound) \
+    X(SCROLL_LOCK_OFF_SOUND, song_scroll_lock_off_sound) \
+    X(NUM_LOCK_ON_SOUND, song_num_lock_on_sound) \
+    X(NUM_LOCK_OFF_SOUND, song_num_lock_off_sound)
+
+// NOTE_C0, which musical_notes.h leaves out
+static double note_frequency(uint8_t note) {
+    return 16.3516 * std::pow(2, note / 12.0);
+}
+
+static void expect_same_song(const char *name, float (*notes)[2], int count, const song_note_t *song) {
+    int i = 0;
+    for (; song[i].duration != 0; i++) {
+        ASSERT_LT(i, count) << name;
+        EXPECT_EQ(song[i].duration, notes[i][1]) << name << " note " << i;
+        if (notes[i][0] == 0) {
+            EXPECT_EQ(song[i].note, SONG_NOTE_REST) << name << " note " << i;
+        } else {
+            // The notes of musical_notes.h are rounded to a hundredth of a Hz
+            EXPECT_NEAR(note_frequency(song[i].note), notes[i][0], notes[i][0] * 0.001) << name << " note " << i;
+        }
+    }
+    EXPECT_EQ(i, count) << name;
+}
+
+TEST(SongList, every_song_is_the_same_in_flash) {
+    #define EXPECT_SAME_SONG(notes, song) { \
+        float floats[][2] = SONG(notes); \
+        expect_same_song(#notes, floats, sizeof(floats) / sizeof(floats[0]), song); \
+    }
+    SONGS(EXPECT_SAME_SONG)
+}
+
+TEST(SongList, notes_are_a_quarter_of_the_size) {
+    float floats[][2] = SONG(ODE_TO_JOY);
+    EXPECT_EQ(sizeof(song_note_t) * 4, sizeof(floats[0]));
+}
+
+TEST(SongList, note_indexes_count_semitones_from_c0) {
+    EXPECT_EQ(SONG_NOTE_INDEX(16.35), 0);
+    EXPECT_EQ(SONG_NOTE_INDEX(30.87), 11);
+    EXPECT_EQ(SONG_NOTE_INDEX(32.70), 12);
+    EXPECT_EQ(SONG_NOTE_INDEX(55.00), SONG_NOTE_A1);
+    EXPECT_EQ(SONG_NOTE_INDEX(NOTE_C3), 36);
+    EXPECT_EQ(SONG_NOTE_INDEX(NOTE_A4), 57);
+    EXPECT_EQ(SONG_NOTE_INDEX(NOTE_BF4), 58);
+    EXPECT_EQ(SONG_NOTE_INDEX(NOTE_B8), 107);
+    EXPECT_EQ(SONG_NOTE_INDEX(NOTE_REST), SONG_NOTE_REST);
+}
+
+TEST(SongList, mixer_steps_of_notes_match_the_float_ones) {
+    for (uint8_t note = 0; note < 108; note++) {
+        double expected = audio_mixer_step(note_frequency(note), 24000);
+        ASSERT_NEAR(audio_mixer_note_step(note, 24000), expected, expected * 0.0001 + 1) << "note " << (int)note;
+    }
+    EXPECT_EQ(audio_mixer_note_step(SONG_NOTE_REST, 24000), 0u);
+    // Past the Nyquist limit
+    EXPECT_EQ(audio_mixer_note_step(107, 8000), 0u);
+}
+
+struct Tone {
+    uint16_t period;
+    uint16_t duty;
+    uint32_t count;
+};
+
+static std::vector<Tone> render() {
+    std::vector<Tone> tones;
+    uint16_t period, duty;
+    while (audio_engine_tick(&period, &duty)) {
+        if (tones.empty() || tones.back().period != period || tones.back().duty != duty) {
+            tones.push_back({period, duty, 0});
+        }
+        tones.back().count++;
+    }
+    return tones;
+}
+
+static void expect_same_tones(const char *name, const std::vector<Tone> &actual, const std::vector<Tone> &expected) {
+    ASSERT_EQ(actual.size(), expected.size()) << name;
+    for (size_t i = 0; i < expected.size(); i++) {
+        EXPECT_NEAR(actual[i].period, expected[i].period, expected[i].period * 0.0005 + 1) << name << " tone " << i;
+        EXPECT_NEAR(actual[i].count, expected[i].count, 1) << name << " tone " << i;
+    }
+}
+
+TEST(SongList, songs_in_flash_play_like_float_songs) {
+    set_voice(default_voice);
+    #define EXPECT_SAME_TONES(notes, song) { \
+        float floats[][2] = SONG(notes); \
+        audio_engine_play_notes(&floats, sizeof(floats) / sizeof(floats[0]), false, STACCATO); \
+        std::vector<Tone> expected = render(); \
+        ASSERT_TRUE(audio_engine_play_song(song, false, STACCATO)); \
+        expect_same_tones(#notes, render(), expected); \
+    }
+    SONGS(EXPECT_SAME_TONES)
+}
+
+TEST(SongList, songs_in_flash_repeat) {
+    const song_note_t song[] = { SONG_NOTE_P(_A4, 16), SONG_NOTE_P(_REST, 16), SONG_END };
+    uint16_t period, duty;
+
+    audio_engine_play_song(song, true, 0);
+    for (uint32_t i = 0; i < 100000; i++) {
+        ASSERT_TRUE(audio_engine_tick(&period, &duty));
+    }
+    EXPECT_TRUE(is_playing_notes());
+    audio_engine_stop_all();
+}
+
+TEST(SongList, an_empty_song_does_not_play) {
+    const song_note_t song[] = { SONG_END };
+    EXPECT_FALSE(audio_engine_play_song(song, true, 0));
+    EXPECT_FALSE(is_playing_notes());
+}
@@ -1,11 +1,10 @@
 #include "voices.h"
-#include "audio.h"
+#include "audio_engine.h"
+#include "musical_notes.h"
 #include "stdlib.h"
 
-// these are imported from audio.c
-extern uint16_t envelope_index;
-extern float note_timbre;
-extern float polyphony_rate;
+// A semitone of pitch
+#define SEMITONE 256
 
 voice_type voice = default_voice;
 
@@ -21,31 +20,30 @@ void voice_deiterate() {
     voice = (voice - 1) % number_of_voices;
 }
 
-float voice_envelope(float frequency) {
-    // envelope_index ranges from 0 to 0xFFFF, which is preserved at 880.0 Hz
-    uint16_t compensated_index = (uint16_t)((float)envelope_index * (880.0 / frequency));
-
+int16_t voice_envelope(int16_t pitch, uint16_t compensated_index) {
     switch (voice) {
         case default_voice:
-            note_timbre = TIMBRE_50;
-            polyphony_rate = 0;
+            note_timbre = AUDIO_TIMBRE(TIMBRE_50);
+            disable_polyphony();
 	        break;
 
         case butts_fader:
-            polyphony_rate = 0;
+            disable_polyphony();
             switch (compensated_index) {
                 case 0 ... 9:
-                    frequency = frequency / 4;
-                    note_timbre = TIMBRE_12;
+                    // Two octaves down
+                    pitch -= 24 * SEMITONE;
+                    note_timbre = AUDIO_TIMBRE(TIMBRE_12);
 	                break;
 
                 case 10 ... 19:
-                    frequency = frequency / 2;
-                    note_timbre = TIMBRE_12;
+                    pitch -= 12 * SEMITONE;
+                    note_timbre = AUDIO_TIMBRE(TIMBRE_12);
 	                break;
 
                 case 20 ... 200:
-                    note_timbre = .125 - pow(((float)compensated_index - 20) / (200 - 20), 2)*.125;
+                    // .125 - ((index - 20) / 180)^2 * .125, 16570 is 65536 * .125 * 65536 / 180^2
+                    note_timbre = AUDIO_TIMBRE(.125) - (((uint32_t)(compensated_index - 20) * (compensated_index - 20) * 16570) >> 16);
 	                break;
 
                 default:
@@ -78,38 +76,40 @@ float voice_envelope(float frequency) {
 	       //  break;
 
         case duty_osc:
-            // This slows the loop down a substantial amount, so higher notes may freeze
-            polyphony_rate = 0;
+            disable_polyphony();
             switch (compensated_index) {
-                default:
+                default: {
                     #define OCS_SPEED 10
                     #define OCS_AMP   .25
-                    // sine wave is slow
-                    // note_timbre = (sin((float)compensated_index/10000*OCS_SPEED) * OCS_AMP / 2) + .5;
-                    // triangle wave is a bit faster
-                    note_timbre = (float)abs((compensated_index*OCS_SPEED % 3000) - 1500) * ( OCS_AMP / 1500 ) + (1 - OCS_AMP) / 2;
+                    // OCS_AMP / 1500 in Q0.16, times 64
+                    #define OCS_SCALE ((uint16_t)(OCS_AMP * 65536 * 64 / 1500))
+                    // triangle wave, index * OCS_SPEED wraps at 16 bits like it does on the AVR
+                    uint16_t triangle = abs((int16_t)((uint16_t)(compensated_index * OCS_SPEED) % 3000) - 1500);
+                    note_timbre = (((uint32_t)triangle * OCS_SCALE) >> 6) + AUDIO_TIMBRE((1 - OCS_AMP) / 2);
                 	break;
+                }
             }
 	        break;
 
         case duty_octave_down:
-            polyphony_rate = 0;
-            note_timbre = (envelope_index % 2) * .125 + .375 * 2;
+            disable_polyphony();
+            note_timbre = (envelope_index % 2) * AUDIO_TIMBRE(.125) + AUDIO_TIMBRE(.375 * 2);
             if ((envelope_index % 4) == 0)
-                note_timbre = 0.5;
+                note_timbre = AUDIO_TIMBRE(0.5);
             if ((envelope_index % 8) == 0)
                 note_timbre = 0;
             break;
         case delayed_vibrato:
-            polyphony_rate = 0;
-            note_timbre = TIMBRE_50;
+            disable_polyphony();
+            note_timbre = AUDIO_TIMBRE(TIMBRE_50);
             #define VOICE_VIBRATO_DELAY 150
             #define VOICE_VIBRATO_SPEED 50
             switch (compensated_index) {
                 case 0 ... VOICE_VIBRATO_DELAY:
                     break;
                 default:
-                    frequency = frequency * vibrato_lut[(int)fmod((((float)compensated_index - (VOICE_VIBRATO_DELAY + 1))/1000*VOICE_VIBRATO_SPEED), VIBRATO_LUT_LENGTH)];
+                    // A step of the table every 1000 / VOICE_VIBRATO_SPEED
+                    pitch += (int8_t)pgm_read_byte(&vibrato_pitch_lut[((compensated_index - (VOICE_VIBRATO_DELAY + 1)) / (1000 / VOICE_VIBRATO_SPEED)) % VIBRATO_LUT_LENGTH]);
                     break;
             }
             break;
@@ -159,7 +159,7 @@ float voice_envelope(float frequency) {
    			break;
     }
 
-    return frequency;
+    return pitch;
 }
 
 
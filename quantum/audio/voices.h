@@ -1,13 +1,13 @@
 #include <stdint.h>
 #include <stdbool.h>
-#include <avr/io.h>
-#include <util/delay.h>
 #include "luts.h"
 
 #ifndef VOICES_H
 #define VOICES_H
 
-float voice_envelope(float frequency);
+// Shapes the pitch of a note and sets note_timbre, compensated_index counts
+// 880 steps a second from the start of the note
+int16_t voice_envelope(int16_t pitch, uint16_t compensated_index);
 
 typedef enum {
     default_voice,
@@ -0,0 +1,78 @@
+#include "color.h"
+#include "progmem.h"
+
+const uint8_t DIM_CURVE[] PROGMEM = {
+  0, 1, 1, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3,
+  3, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+  4, 4, 4, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 6, 6, 6,
+  6, 6, 6, 6, 6, 7, 7, 7, 7, 7, 7, 7, 8, 8, 8, 8,
+  8, 8, 9, 9, 9, 9, 9, 9, 10, 10, 10, 10, 10, 11, 11, 11,
+  11, 11, 12, 12, 12, 12, 12, 13, 13, 13, 13, 14, 14, 14, 14, 15,
+  15, 15, 16, 16, 16, 16, 17, 17, 17, 18, 18, 18, 19, 19, 19, 20,
+  20, 20, 21, 21, 22, 22, 22, 23, 23, 24, 24, 25, 25, 25, 26, 26,
+  27, 27, 28, 28, 29, 29, 30, 30, 31, 32, 32, 33, 33, 34, 35, 35,
+  36, 36, 37, 38, 38, 39, 40, 40, 41, 42, 43, 43, 44, 45, 46, 47,
+  48, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62,
+  63, 64, 65, 66, 68, 69, 70, 71, 73, 74, 75, 76, 78, 79, 81, 82,
+  83, 85, 86, 88, 90, 91, 93, 94, 96, 98, 99, 101, 103, 105, 107, 109,
+  110, 112, 114, 116, 118, 121, 123, 125, 127, 129, 132, 134, 136, 139, 141, 144,
+  146, 149, 151, 154, 157, 159, 162, 165, 168, 171, 174, 177, 180, 183, 186, 190,
+  193, 196, 200, 203, 207, 211, 214, 218, 222, 226, 230, 234, 238, 242, 248, 255
+};
+
+hsv_level_t hsv_level(uint8_t sat, uint8_t val) {
+  hsv_level_t level;
+
+  level.val = pgm_read_byte(&DIM_CURVE[val]);
+  sat = 255 - pgm_read_byte(&DIM_CURVE[255 - sat]);
+  if (sat == 0) { // Acromatic color (gray). Hue doesn't mind.
+    level.base = level.val;
+  } else {
+    level.base = ((255 - sat) * level.val) >> 8;
+  }
+  return level;
+}
+
+void hsv_wheel_to_rgb(uint16_t wheel, hsv_level_t level, uint8_t *r, uint8_t *g, uint8_t *b) {
+  uint8_t val = level.val;
+  uint8_t base = level.base;
+  // An 8x8 bit multiply
+  uint8_t color = ((uint8_t)(val - base) * (wheel & 0xFF)) >> 8;
+
+  switch (wheel >> 8) {
+    case 0:
+      *r = val;
+      *g = base + color;
+      *b = base;
+      break;
+    case 1:
+      *r = val - color;
+      *g = val;
+      *b = base;
+      break;
+    case 2:
+      *r = base;
+      *g = val;
+      *b = base + color;
+      break;
+    case 3:
+      *r = base;
+      *g = val - color;
+      *b = val;
+      break;
+    case 4:
+      *r = base + color;
+      *g = base;
+      *b = val;
+      break;
+    default:
+      *r = val;
+      *g = base;
+      *b = val - color;
+      break;
+  }
+}
+
+void hsv_to_rgb(uint16_t hue, uint8_t sat, uint8_t val, uint8_t *r, uint8_t *g, uint8_t *b) {
+  hsv_wheel_to_rgb(hsv_hue_to_wheel(hue), hsv_level(sat, val), r, g, b);
+}
@@ -0,0 +1,34 @@
+#ifndef COLOR_H
+#define COLOR_H
+
+#include <stdint.h>
+
+/* HSV to RGB conversion without divisions
+ *
+ * Hues from 0 to 359 are mapped onto a wheel of six sextants of 256 steps,
+ * so the sextant is the high byte and the position in it the low byte.
+ * Saturation and value go through a dim curve, which looks the most
+ * natural, and only depend on the color, not the hue. A strip that shares
+ * them only computes the level once, see hsv_level().
+ */
+
+#define HSV_WHEEL_SIZE (6 * 256)
+
+extern const uint8_t DIM_CURVE[];
+
+typedef struct {
+  uint8_t val;   // the highest channel
+  uint8_t base;  // the lowest channel
+} hsv_level_t;
+
+/* Hue in degrees, 0 to 359, to a position on the wheel */
+static inline uint16_t hsv_hue_to_wheel(uint16_t hue) {
+  // hue * 1536 / 360, rounded, so that whole sextants are exact
+  return ((uint32_t)hue * 4369 + 512) >> 10;
+}
+
+hsv_level_t hsv_level(uint8_t sat, uint8_t val);
+void hsv_wheel_to_rgb(uint16_t wheel, hsv_level_t level, uint8_t *r, uint8_t *g, uint8_t *b);
+void hsv_to_rgb(uint16_t hue, uint8_t sat, uint8_t val, uint8_t *r, uint8_t *g, uint8_t *b);
+
+#endif
@@ -0,0 +1,211 @@
+#include "dynamic_keymap.h"
+#include "matrix.h"
+#include "eeprom.h"
+#include "print.h"
+
+#if MATRIX_ROWS > 32 || MATRIX_COLS > 32
+#error "dynamic keymap entries only have room for 32 rows and 32 columns"
+#endif
+
+#if DYNAMIC_KEYMAP_MAX_ENTRIES > 254
+#error "DYNAMIC_KEYMAP_MAX_ENTRIES has to fit the count byte"
+#endif
+
+// Twice the entries, so that probe sequences stay short
+#define TABLE_SIZE (DYNAMIC_KEYMAP_MAX_ENTRIES * 2)
+#define EMPTY_SLOT 0xFFFF
+
+#define EEPROM_COUNT ((uint8_t*)(uintptr_t)DYNAMIC_KEYMAP_EEPROM_ADDR)
+#define EEPROM_ENTRY(i) ((uint8_t*)(uintptr_t)(DYNAMIC_KEYMAP_EEPROM_ADDR + 1 + (i) * DYNAMIC_KEYMAP_ENTRY_SIZE))
+
+typedef struct {
+    uint16_t key;
+    uint16_t keycode;
+} slot_t;
+
+static slot_t table[TABLE_SIZE];
+// Columns of each row that have an entry on some layer
+static matrix_row_t overlay_rows[MATRIX_ROWS];
+static uint8_t count;
+
+// 5 bits each for layer, row and column, so a key never equals EMPTY_SLOT
+static uint16_t make_key(uint8_t layer, keypos_t key) {
+    return ((uint16_t)layer << 10) | ((uint16_t)key.row << 5) | key.col;
+}
+
+// The table has up to 508 slots, so the indexes need 16 bits
+static uint16_t hash(uint16_t key) {
+    return (uint16_t)((key ^ (key >> 7)) * 31) % TABLE_SIZE;
+}
+
+static slot_t *find_slot(uint16_t key) {
+    uint16_t i = hash(key);
+    while (table[i].key != EMPTY_SLOT && table[i].key != key) {
+        i = (i + 1) % TABLE_SIZE;
+    }
+    return &table[i];
+}
+
+static void read_entry(uint8_t index, uint8_t *layer, keypos_t *key, uint16_t *keycode) {
+    uint8_t *p = EEPROM_ENTRY(index);
+    *layer = eeprom_read_byte(p);
+    key->row = eeprom_read_byte(p + 1);
+    key->col = eeprom_read_byte(p + 2);
+    *keycode = eeprom_read_byte(p + 3) | (eeprom_read_byte(p + 4) << 8);
+}
+
+static void write_entry(uint8_t index, uint8_t layer, keypos_t key, uint16_t keycode) {
+    uint8_t *p = EEPROM_ENTRY(index);
+    eeprom_update_byte(p, layer);
+    eeprom_update_byte(p + 1, key.row);
+    eeprom_update_byte(p + 2, key.col);
+    eeprom_update_byte(p + 3, keycode & 0xFF);
+    eeprom_update_byte(p + 4, keycode >> 8);
+}
+
+static bool valid_key(uint8_t layer, keypos_t key) {
+    return layer < 32 && key.row < MATRIX_ROWS && key.col < MATRIX_COLS;
+}
+
+// Finds the eeprom index of an entry, or returns count
+static uint8_t find_entry(uint8_t layer, keypos_t key) {
+    uint8_t i;
+    for (i = 0; i < count; i++) {
+        uint8_t l;
+        keypos_t k;
+        uint16_t kc;
+        read_entry(i, &l, &k, &kc);
+        if (l == layer && KEYEQ(k, key)) {
+            break;
+        }
+    }
+    return i;
+}
+
+void dynamic_keymap_init(void) {
+    uint8_t i;
+
+    for (uint16_t slot = 0; slot < TABLE_SIZE; slot++) {
+        table[slot].key = EMPTY_SLOT;
+    }
+    for (i = 0; i < MATRIX_ROWS; i++) {
+        overlay_rows[i] = 0;
+    }
+
+    // An erased eeprom reads as 0xFF
+    count = eeprom_read_byte(EEPROM_COUNT);
+    if (count > DYNAMIC_KEYMAP_MAX_ENTRIES) {
+        count = 0;
+    }
+
+    for (i = 0; i < count; i++) {
+        uint8_t layer;
+        keypos_t key;
+        uint16_t keycode;
+        read_entry(i, &layer, &key, &keycode);
+        if (!valid_key(layer, key)) {
+            continue;
+        }
+        slot_t *slot = find_slot(make_key(layer, key));
+        slot->key = make_key(layer, key);
+        slot->keycode = keycode;
+        overlay_rows[key.row] |= ((matrix_row_t)1 << key.col);
+    }
+}
+
+bool dynamic_keymap_lookup(uint8_t layer, keypos_t key, uint16_t *keycode) {
+    if (key.row >= MATRIX_ROWS || !(overlay_rows[key.row] & ((matrix_row_t)1 << key.col))) {
+        return false;
+    }
+    slot_t *slot = find_slot(make_key(layer, key));
+    if (slot->key == EMPTY_SLOT) {
+        return false;
+    }
+    *keycode = slot->keycode;
+    return true;
+}
+
+bool dynamic_keymap_set(uint8_t layer, keypos_t key, uint16_t keycode) {
+    if (!valid_key(layer, key)) {
+        return false;
+    }
+    uint8_t index = find_entry(layer, key);
+    if (index == DYNAMIC_KEYMAP_MAX_ENTRIES) {
+        return false;
+    }
+    write_entry(index, layer, key, keycode);
+    // The count is written last, so a reset in between loses only the new entry
+    if (index == count) {
+        eeprom_update_byte(EEPROM_COUNT, count + 1);
+    }
+    dynamic_keymap_init();
+    return true;
+}
+
+void dynamic_keymap_clear(uint8_t layer, keypos_t key) {
+    uint8_t index = find_entry(layer, key);
+    if (index == count) {
+        return;
+    }
+    // Move the last entry into the gap
+    if (index != count - 1) {
+        uint8_t l;
+        keypos_t k;
+        uint16_t kc;
+        read_entry(count - 1, &l, &k, &kc);
+        write_entry(index, l, k, kc);
+    }
+    eeprom_update_byte(EEPROM_COUNT, count - 1);
+    dynamic_keymap_init();
+}
+
+void dynamic_keymap_reset(void) {
+    eeprom_update_byte(EEPROM_COUNT, 0);
+    dynamic_keymap_init();
+}
+
+uint8_t dynamic_keymap_count(void) {
+    return count;
+}
+
+bool dynamic_keymap_process_report(const uint8_t *data, uint8_t length) {
+    if (length < 1) {
+        return false;
+    }
+    if (data[0] == DYNAMIC_KEYMAP_RESET) {
+        dynamic_keymap_reset();
+        return true;
+    }
+    if (length < 4) {
+        return false;
+    }
+
+    uint8_t layer = data[1];
+    keypos_t key = { .row = data[2], .col = data[3] };
+    uint16_t keycode;
+    switch (data[0]) {
+        case DYNAMIC_KEYMAP_SET:
+            if (length < 6) {
+                return false;
+            }
+            return dynamic_keymap_set(layer, key, (data[4] << 8) | data[5]);
+        case DYNAMIC_KEYMAP_CLEAR:
+            if (!valid_key(layer, key)) {
+                return false;
+            }
+            dynamic_keymap_clear(layer, key);
+            return true;
+        case DYNAMIC_KEYMAP_GET:
+            if (!valid_key(layer, key)) {
+                return false;
+            }
+            if (dynamic_keymap_lookup(layer, key, &keycode)) {
+                xprintf("dynamic keymap %u %u %u: %04X\n", layer, key.row, key.col, keycode);
+            } else {
+                xprintf("dynamic keymap %u %u %u: none\n", layer, key.row, key.col);
+            }
+            return true;
+        default:
+            return false;
+    }
+}
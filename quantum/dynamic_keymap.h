@@ -0,0 +1,49 @@
+#ifndef DYNAMIC_KEYMAP_H
+#define DYNAMIC_KEYMAP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "keyboard.h"
+
+/* Keymap overlay stored in EEPROM
+ *
+ * A sparse list of (layer, row, col, keycode) entries that take precedence
+ * over the compiled keymaps, so keys can be remapped without reflashing.
+ * The list is loaded into a RAM hash table at boot, and lookups of keys
+ * without an entry on any layer only test a bit.
+ *
+ * EEPROM layout, starting at DYNAMIC_KEYMAP_EEPROM_ADDR:
+ * count, then count entries of layer, row, col, keycode (low byte first)
+ */
+
+#ifndef DYNAMIC_KEYMAP_EEPROM_ADDR
+#define DYNAMIC_KEYMAP_EEPROM_ADDR 32
+#endif
+
+#ifndef DYNAMIC_KEYMAP_MAX_ENTRIES
+#define DYNAMIC_KEYMAP_MAX_ENTRIES 16
+#endif
+
+#define DYNAMIC_KEYMAP_ENTRY_SIZE 5
+
+/* Commands of the console protocol, in the first byte of a report */
+enum dynamic_keymap_command {
+    DYNAMIC_KEYMAP_SET = 1,   // layer, row, col, keycode high, keycode low
+    DYNAMIC_KEYMAP_CLEAR,     // layer, row, col
+    DYNAMIC_KEYMAP_RESET,     // removes all entries
+    DYNAMIC_KEYMAP_GET,       // layer, row, col, prints the overlay keycode
+};
+
+/* Loads the entries from the eeprom, entries outside the matrix are skipped */
+void dynamic_keymap_init(void);
+/* Returns true and the keycode if the key has an entry */
+bool dynamic_keymap_lookup(uint8_t layer, keypos_t key, uint16_t *keycode);
+/* Returns false if the overlay is full */
+bool dynamic_keymap_set(uint8_t layer, keypos_t key, uint16_t keycode);
+void dynamic_keymap_clear(uint8_t layer, keypos_t key);
+void dynamic_keymap_reset(void);
+uint8_t dynamic_keymap_count(void);
+/* Handles a report received on the console, returns false if it's invalid */
+bool dynamic_keymap_process_report(const uint8_t *data, uint8_t length);
+
+#endif
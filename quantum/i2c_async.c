@@ -0,0 +1,168 @@
+// Interrupt driven TWI master, see i2c_async.h
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/twi.h>
+#include "i2c_async.h"
+#include "timer.h"
+
+#define QUEUE_MASK (I2C_ASYNC_QUEUE_SIZE - 1)
+
+#define TWCR_GO       ((1<<TWINT) | (1<<TWEN) | (1<<TWIE))
+#define TWCR_START    (TWCR_GO | (1<<TWSTA))
+#define TWCR_ACK      (TWCR_GO | (1<<TWEA))
+// The stop is sent first and the start right after it
+#define TWCR_RESTART  (TWCR_GO | (1<<TWSTO) | (1<<TWSTA))
+// Leaves the interrupt disabled, so that the blocking driver can poll
+#define TWCR_STOP     ((1<<TWINT) | (1<<TWEN) | (1<<TWSTO))
+
+static i2c_async_transaction_t* volatile queue[I2C_ASYNC_QUEUE_SIZE];
+static volatile uint8_t queue_head;
+static volatile uint8_t queue_tail;
+static volatile bool busy;
+
+static uint8_t position;
+static bool reading;
+
+// Incremented by the interrupt, used by i2c_async_task to detect a stall
+static volatile uint8_t progress;
+static uint8_t last_progress;
+static uint16_t progress_timer;
+
+__attribute__ ((weak))
+void i2c_async_slave_event(void) {
+    TWCR &= ~(1<<TWIE);
+}
+
+static void begin_transaction(void) {
+    i2c_async_transaction_t* t = queue[queue_tail];
+    position = 0;
+    reading = t->write_length == 0;
+}
+
+// Called with interrupts disabled
+static void finish_transaction(uint8_t status) {
+    queue[queue_tail]->status = status;
+    queue_tail = (queue_tail + 1) & QUEUE_MASK;
+    progress++;
+    if (queue_tail != queue_head) {
+        begin_transaction();
+        TWCR = TWCR_RESTART;
+    } else {
+        busy = false;
+        TWCR = TWCR_STOP;
+    }
+}
+
+bool i2c_async_submit(i2c_async_transaction_t* transaction) {
+    bool ret = false;
+    uint8_t sreg = SREG;
+    cli();
+    uint8_t next = (queue_head + 1) & QUEUE_MASK;
+    if (next != queue_tail) {
+        transaction->status = I2C_ASYNC_PENDING;
+        queue[queue_head] = transaction;
+        queue_head = next;
+        if (!busy) {
+            busy = true;
+            last_progress = progress;
+            progress_timer = timer_read();
+            begin_transaction();
+            TWCR = TWCR_START;
+        }
+        ret = true;
+    }
+    SREG = sreg;
+    return ret;
+}
+
+bool i2c_async_busy(void) {
+    return busy;
+}
+
+void i2c_async_task(void) {
+    if (!busy) {
+        return;
+    }
+    if (progress != last_progress) {
+        last_progress = progress;
+        progress_timer = timer_read();
+        return;
+    }
+    if (timer_elapsed(progress_timer) < I2C_ASYNC_TIMEOUT) {
+        return;
+    }
+    uint8_t sreg = SREG;
+    cli();
+    // Release the bus and fail everything, the callers retry on their own
+    TWCR = 0;
+    while (queue_tail != queue_head) {
+        queue[queue_tail]->status = I2C_ASYNC_ERROR;
+        queue_tail = (queue_tail + 1) & QUEUE_MASK;
+    }
+    busy = false;
+    progress++;
+    TWCR = (1<<TWEN);
+    SREG = sreg;
+}
+
+ISR(TWI_vect) {
+    if (!busy) {
+        i2c_async_slave_event();
+        return;
+    }
+
+    i2c_async_transaction_t* t = queue[queue_tail];
+    switch (TW_STATUS) {
+        case TW_START:
+        case TW_REP_START:
+            TWDR = (t->address << 1) | (reading ? TW_READ : TW_WRITE);
+            TWCR = TWCR_GO;
+            break;
+
+        case TW_MT_SLA_ACK:
+        case TW_MT_DATA_ACK:
+            if (position < t->write_length) {
+                TWDR = t->write_data[position++];
+                TWCR = TWCR_GO;
+            } else if (t->read_length > 0) {
+                reading = true;
+                position = 0;
+                TWCR = TWCR_START;
+            } else {
+                finish_transaction(I2C_ASYNC_DONE);
+            }
+            break;
+
+        case TW_MR_SLA_ACK:
+            if (t->read_length > 1) {
+                TWCR = TWCR_ACK;
+            } else if (t->read_length == 1) {
+                TWCR = TWCR_GO;
+            } else {
+                finish_transaction(I2C_ASYNC_DONE);
+            }
+            break;
+
+        case TW_MR_DATA_ACK:
+            t->read_data[position++] = TWDR;
+            // Don't acknowledge the last byte
+            TWCR = (position + 1 < t->read_length) ? TWCR_ACK : TWCR_GO;
+            break;
+
+        case TW_MR_DATA_NACK:
+            t->read_data[position++] = TWDR;
+            finish_transaction(I2C_ASYNC_DONE);
+            break;
+
+        case TW_BUS_ERROR:
+            // Resets the hardware, and the stop is only sent internally
+            TWCR = 0;
+            TWCR = (1<<TWEN);
+            // fall through
+        default:
+            // Not acknowledged, or arbitration lost
+            finish_transaction(I2C_ASYNC_ERROR);
+            break;
+    }
+}
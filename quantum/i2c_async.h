@@ -0,0 +1,56 @@
+#ifndef I2C_ASYNC_H
+#define I2C_ASYNC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Interrupt driven TWI master with a transaction queue.
+//
+// A transaction writes write_length bytes to the slave and then, after a
+// repeated start, reads read_length bytes back. Either part can be empty.
+// The transaction is owned by the caller and must stay alive until its
+// status is no longer I2C_ASYNC_PENDING. The bus clock is not touched, so
+// initialize the TWI bit rate with the blocking driver first.
+
+// Must be a power of two
+#ifndef I2C_ASYNC_QUEUE_SIZE
+#define I2C_ASYNC_QUEUE_SIZE 16
+#endif
+
+// A transaction that makes no progress for this many milliseconds is
+// considered lost, the bus is reset and everything queued is failed
+#ifndef I2C_ASYNC_TIMEOUT
+#define I2C_ASYNC_TIMEOUT 5
+#endif
+
+enum {
+    I2C_ASYNC_IDLE = 0,
+    I2C_ASYNC_PENDING,
+    I2C_ASYNC_DONE,
+    I2C_ASYNC_ERROR,
+};
+
+typedef struct {
+    uint8_t address; // 7-bit slave address
+    const uint8_t* write_data;
+    uint8_t write_length;
+    uint8_t* read_data;
+    uint8_t read_length;
+    volatile uint8_t status;
+} i2c_async_transaction_t;
+
+// Queues the transaction and returns immediately, returns false if the
+// queue is full
+bool i2c_async_submit(i2c_async_transaction_t* transaction);
+// True while there are transactions queued or in flight, the blocking
+// driver must not be used then
+bool i2c_async_busy(void);
+// Call regularly, for example once per matrix scan, to recover the bus
+// when the slave disappears in the middle of a transaction
+void i2c_async_task(void);
+
+// Called from the TWI interrupt when the master is idle, so that slave
+// mode can share the interrupt vector
+void i2c_async_slave_event(void);
+
+#endif
@@ -166,6 +166,12 @@ void action_function(keyrecord_t *record, uint8_t id, uint8_t opt)
 /* translates key to keycode */
 uint16_t keymap_key_to_keycode(uint8_t layer, keypos_t key)
 {
+#ifdef DYNAMIC_KEYMAP_ENABLE
+    uint16_t keycode;
+    if (dynamic_keymap_lookup(layer, key, &keycode)) {
+        return keycode;
+    }
+#endif
     // Read entire word (16bits)
     return pgm_read_word(&keymaps[(layer)][(key.row)][(key.col)]);
 }
@@ -13,8 +13,11 @@
 #ifndef LIGHT_WS2812_H_
 #define LIGHT_WS2812_H_
 
+#include <stdint.h>
+#if defined(__AVR__)
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#endif
 //#include "ws2812_config.h"
 
 /*
@@ -2,7 +2,13 @@
 #include "action_tapping.h"
 
 static uint16_t last_td;
-static int8_t highest_td = -1;
+
+// The dances with a count, only these can time out or be interrupted
+static qk_tap_dance_action_t *active_tds = NULL;
+// None of them times out until expiry_wait ms after expiry_timer, so the
+// scans until then have nothing to do
+static uint16_t expiry_timer;
+static uint16_t expiry_wait;
 
 void qk_tap_dance_pair_finished (qk_tap_dance_state_t *state, void *user_data) {
   qk_tap_dance_pair_t *pair = (qk_tap_dance_pair_t *)user_data;
@@ -51,6 +57,35 @@ static inline void process_tap_dance_action_on_reset (qk_tap_dance_action_t *act
   _process_tap_dance_action_fn (&action->state, action->user_data, action->fn.on_reset);
 }
 
+static inline uint16_t tap_dance_term (qk_tap_dance_action_t *action)
+{
+  return action->custom_tapping_term ? action->custom_tapping_term : TAPPING_TERM;
+}
+
+// The ms before the earliest active dance can time out, 0 if one can already
+static uint16_t tap_dance_expiry_left (void)
+{
+  uint16_t elapsed = timer_elapsed (expiry_timer);
+  return elapsed < expiry_wait ? expiry_wait - elapsed : 0;
+}
+
+static void schedule_tap_dance_expiry (uint16_t wait)
+{
+  expiry_timer = timer_read ();
+  expiry_wait = wait;
+}
+
+static void deactivate_tap_dance (qk_tap_dance_action_t *action)
+{
+  for (qk_tap_dance_action_t **place = &active_tds; *place; place = &(*place)->next_active) {
+    if (*place == action) {
+      *place = action->next_active;
+      action->next_active = NULL;
+      return;
+    }
+  }
+}
+
 bool process_tap_dance(uint16_t keycode, keyrecord_t *record) {
   uint16_t idx = keycode - QK_TAP_DANCE;
   qk_tap_dance_action_t *action;
@@ -61,13 +96,19 @@ bool process_tap_dance(uint16_t keycode, keyrecord_t *record) {
 
   switch(keycode) {
   case QK_TAP_DANCE ... QK_TAP_DANCE_MAX:
-    if ((int16_t)idx > highest_td)
-      highest_td = idx;
     action = &tap_dance_actions[idx];
 
     action->state.keycode = keycode;
     action->state.pressed = record->event.pressed;
     if (record->event.pressed) {
+      uint16_t term = tap_dance_term (action);
+
+      if (!active_tds || term < tap_dance_expiry_left ())
+        schedule_tap_dance_expiry (term);
+      if (!action->state.count) {
+        action->next_active = active_tds;
+        active_tds = action;
+      }
       action->state.count++;
       action->state.timer = timer_read();
 
@@ -86,16 +127,13 @@ bool process_tap_dance(uint16_t keycode, keyrecord_t *record) {
     if (!record->event.pressed)
       return true;
 
-    if (highest_td == -1)
-      return true;
-
-    for (int i = 0; i <= highest_td; i++) {
-      action = &tap_dance_actions[i];
-      if (action->state.count == 0)
-        continue;
+    for (action = active_tds; action;) {
+      // Resetting takes it off the list
+      qk_tap_dance_action_t *next = action->next_active;
       action->state.interrupted = true;
       process_tap_dance_action_on_dance_finished (action);
       reset_tap_dance (&action->state);
+      action = next;
     }
     break;
   }
@@ -104,17 +142,27 @@ bool process_tap_dance(uint16_t keycode, keyrecord_t *record) {
 }
 
 void matrix_scan_tap_dance () {
-  if (highest_td == -1)
+  if (!active_tds || timer_elapsed (expiry_timer) <= expiry_wait)
     return;
 
-  for (int i = 0; i <= highest_td; i++) {
-    qk_tap_dance_action_t *action = &tap_dance_actions[i];
+  uint16_t wait = UINT16_MAX;
+  for (qk_tap_dance_action_t *action = active_tds; action;) {
+    qk_tap_dance_action_t *next = action->next_active;
+    uint16_t elapsed = timer_elapsed (action->state.timer);
+    uint16_t term = tap_dance_term (action);
 
-    if (action->state.count && timer_elapsed (action->state.timer) > TAPPING_TERM) {
+    if (elapsed > term) {
       process_tap_dance_action_on_dance_finished (action);
       reset_tap_dance (&action->state);
+      // Still held, it's reset on a scan after the release
+      if (action->state.count)
+        wait = 0;
+    } else if (term - elapsed < wait) {
+      wait = term - elapsed;
     }
+    action = next;
   }
+  schedule_tap_dance_expiry (wait);
 }
 
 void reset_tap_dance (qk_tap_dance_state_t *state) {
@@ -131,4 +179,5 @@ void reset_tap_dance (qk_tap_dance_state_t *state) {
   state->interrupted = false;
   state->finished = false;
   last_td = 0;
+  deactivate_tap_dance (action);
 }
@@ -20,7 +20,7 @@ typedef struct
 
 typedef void (*qk_tap_dance_user_fn_t) (qk_tap_dance_state_t *state, void *user_data);
 
-typedef struct
+typedef struct qk_tap_dance_action_t
 {
   struct {
     qk_tap_dance_user_fn_t on_each_tap;
@@ -29,6 +29,10 @@ typedef struct
   } fn;
   qk_tap_dance_state_t state;
   void *user_data;
+  // The time to tap again, 0 for TAPPING_TERM
+  uint16_t custom_tapping_term;
+  // Links the dances in progress, the ones with a count
+  struct qk_tap_dance_action_t *next_active;
 } qk_tap_dance_action_t;
 
 typedef struct
@@ -50,6 +54,11 @@ typedef struct
     .fn = { user_fn_on_each_tap, user_fn_on_dance_finished, user_fn_on_reset } \
   }
 
+#define ACTION_TAP_DANCE_FN_ADVANCED_TIME(user_fn_on_each_tap, user_fn_on_dance_finished, user_fn_on_reset, tap_specific_tapping_term) { \
+    .fn = { user_fn_on_each_tap, user_fn_on_dance_finished, user_fn_on_reset }, \
+    .custom_tapping_term = tap_specific_tapping_term \
+  }
+
 extern qk_tap_dance_action_t tap_dance_actions[];
 
 /* To be used internally */
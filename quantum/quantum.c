@@ -59,6 +59,7 @@ void reset_keyboard(void) {
   shutdown_user();
 #endif
   wait_ms(250);
+  eeconfig_flush();
 #ifdef CATERINA_BOOTLOADER
   *(uint16_t *)0x0800 = 0x7777; // these two are a-star-specific
 #endif
@@ -98,6 +99,12 @@ bool process_record_quantum(keyrecord_t *record) {
   #endif
     keycode = keymap_key_to_keycode(layer_switch_get_layer(key), key);
 
+  #if defined(RGBLIGHT_ENABLE) && defined(RGBLIGHT_TIMER)
+    if (record->event.pressed) {
+      rgblight_reactive_record(key, record->event.time);
+    }
+  #endif
+
     // This is how you use actions here
     // if (keycode == KC_LEAD) {
     //   action_t action;
@@ -457,6 +464,9 @@ void matrix_init_quantum() {
   #ifdef BACKLIGHT_ENABLE
     backlight_init_ports();
   #endif
+  #ifdef DYNAMIC_KEYMAP_ENABLE
+    dynamic_keymap_init();
+  #endif
   matrix_init_kb();
 }
 
@@ -468,6 +478,7 @@ void matrix_scan_quantum() {
   #ifdef TAP_DANCE_ENABLE
     matrix_scan_tap_dance();
   #endif
+
   matrix_scan_kb();
 }
 
@@ -488,6 +499,11 @@ static const uint8_t backlight_pin = BACKLIGHT_PIN;
 #  error "Backlight pin not supported - use B5, B6, or B7"
 #endif
 
+// Fades and breathing run every BACKLIGHT_FRAME_INTERVAL, the PWM interrupt
+// only reports its time
+static scheduler_job_t backlight_job = SCHEDULER_JOB("backlight", backlight_task, SCHEDULER_PRIORITY_BACKLIGHT, BACKLIGHT_FRAME_INTERVAL, BACKLIGHT_TASK_BUDGET);
+static scheduler_job_t backlight_isr_job = SCHEDULER_JOB("backlight isr", NULL, SCHEDULER_PRIORITY_BACKLIGHT, 0, BACKLIGHT_ISR_BUDGET);
+
 __attribute__ ((weak))
 void backlight_init_ports(void)
 {
@@ -514,38 +530,82 @@ void backlight_init_ports(void)
   TCCR1A = _BV(COM1x1) | _BV(WGM11); // = 0b00001010;
   TCCR1B = _BV(WGM13) | _BV(WGM12) | _BV(CS10); // = 0b00011001;
 
+  scheduler_add(&backlight_job);
+  scheduler_add(&backlight_isr_job);
   backlight_init();
   #ifdef BACKLIGHT_BREATHING
     breathing_defaults();
   #endif
 }
 
+// Levels fade in the main loop, a frame at a time, see backlight_task(). The
+// overflow interrupt only copies the duty cycle of a new frame into OCR1x, at
+// the start of a PWM period, and then turns itself off.
+static led_fade_t backlight_fade;
+static uint16_t backlight_duty;
+static volatile uint16_t backlight_next_duty;
+
+#ifdef BACKLIGHT_BREATHING
+static bool breathing;
+static uint16_t breathing_next(void);
+#endif
+
 __attribute__ ((weak))
 void backlight_set(uint8_t level)
 {
-  // Prevent backlight blink on lowest level
-  // PORTx &= ~n
-  _SFR_IO8((backlight_pin >> 4) + 2) &= ~_BV(backlight_pin & 0xF);
+  led_fade_start(&backlight_fade, (uint32_t)level * 0xFFFF / BACKLIGHT_LEVELS, BACKLIGHT_FADE_FRAMES);
+
+  #ifdef BACKLIGHT_BREATHING
+    breathing_intensity_default();
+  #endif
+}
+
+void backlight_task(void)
+{
+  led_fade_next(&backlight_fade);
+  uint16_t level = backlight_fade.level;
+  #ifdef BACKLIGHT_BREATHING
+    if (breathing) {
+      level = breathing_next();
+    }
+  #endif
+
+  uint16_t duty = led_gamma(level);
+  if (duty == backlight_duty) {
+    return;
+  }
+  backlight_duty = duty;
 
-  if ( level == 0 ) {
-    // Turn off PWM control on backlight pin, revert to output low.
+  TIMSK1 &= ~_BV(TOIE1);
+  backlight_next_duty = duty;
+  // The overflow flag is set every period, clear it so the new duty cycle
+  // waits for the next one
+  TIFR1 = _BV(TOV1);
+  TIMSK1 |= _BV(TOIE1);
+}
+
+void backlight_debug_frames(void)
+{
+  xprintf("backlight duty: %u\n", backlight_duty);
+}
+
+ISR(TIMER1_OVF_vect)
+{
+  // Timer1 counts clock cycles, so it times this interrupt as well
+  uint16_t start = TCNT1;
+
+  if (backlight_next_duty == 0) {
+    // Turn off PWM control on backlight pin, revert to output low, as even
+    // a duty cycle of 0 gives a one clock pulse every period
     TCCR1A &= ~(_BV(COM1x1));
-    OCR1x = 0x0;
-  } else if ( level == BACKLIGHT_LEVELS ) {
-    // Turn on PWM control of backlight pin
-    TCCR1A |= _BV(COM1x1);
-    // Set the brightness
-    OCR1x = 0xFFFF;
   } else {
-    // Turn on PWM control of backlight pin
     TCCR1A |= _BV(COM1x1);
-    // Set the brightness
-    OCR1x = 0xFFFF >> ((BACKLIGHT_LEVELS - level) * ((BACKLIGHT_LEVELS + 1) / 2));
   }
+  // Double buffered, so it takes effect at the start of the next period
+  OCR1x = backlight_next_duty;
+  TIMSK1 &= ~_BV(TOIE1);
 
-  #ifdef BACKLIGHT_BREATHING
-    breathing_intensity_default();
-  #endif
+  scheduler_account(&backlight_isr_job, (uint16_t)(TCNT1 - start) / (F_CPU / 1000000));
 }
 
 
@@ -557,49 +617,44 @@ void backlight_set(uint8_t level)
 
 static uint8_t breath_intensity;
 static uint8_t breath_speed;
-static uint16_t breathing_index;
+static uint16_t breathing_phase;
 static uint8_t breathing_halt;
 
 void breathing_enable(void)
 {
     if (get_backlight_level() == 0)
     {
-        breathing_index = 0;
+        breathing_phase = 0;
     }
     else
     {
-        // Set breathing_index to be at the midpoint (brightest point)
-        breathing_index = 0x20 << breath_speed;
+        // Set breathing_phase to be at the midpoint (brightest point)
+        breathing_phase = 0x8000;
     }
 
     breathing_halt = BREATHING_NO_HALT;
-
-    // Enable breathing interrupt
-    TIMSK1 |= _BV(OCIE1A);
+    breathing = true;
 }
 
 void breathing_pulse(void)
 {
     if (get_backlight_level() == 0)
     {
-        breathing_index = 0;
+        breathing_phase = 0;
     }
     else
     {
-        // Set breathing_index to be at the midpoint + 1 (brightest point)
-        breathing_index = 0x21 << breath_speed;
+        // Set breathing_phase to be just past the midpoint (brightest point)
+        breathing_phase = 0x8001;
     }
 
     breathing_halt = BREATHING_HALT_ON;
-
-    // Enable breathing interrupt
-    TIMSK1 |= _BV(OCIE1A);
+    breathing = true;
 }
 
 void breathing_disable(void)
 {
-    // Disable breathing interrupt
-    TIMSK1 &= ~_BV(OCIE1A);
+    breathing = false;
     backlight_set(get_backlight_level());
 }
 
@@ -613,32 +668,29 @@ void breathing_self_disable(void)
     {
         breathing_halt = BREATHING_HALT_ON;
     }
-
-    //backlight_set(get_backlight_level());
 }
 
 void breathing_toggle(void)
 {
-    if (!is_breathing())
+    if (!breathing)
     {
         if (get_backlight_level() == 0)
         {
-            breathing_index = 0;
+            breathing_phase = 0;
         }
         else
         {
-            // Set breathing_index to be at the midpoint + 1 (brightest point)
-            breathing_index = 0x21 << breath_speed;
+            // Set breathing_phase to be just past the midpoint (brightest point)
+            breathing_phase = 0x8001;
         }
 
         breathing_halt = BREATHING_NO_HALT;
     }
 
-    // Toggle breathing interrupt
-    TIMSK1 ^= _BV(OCIE1A);
+    breathing = !breathing;
 
     // Restore backlight level
-    if (!is_breathing())
+    if (!breathing)
     {
         backlight_set(get_backlight_level());
     }
@@ -646,13 +698,13 @@ void breathing_toggle(void)
 
 bool is_breathing(void)
 {
-    return (TIMSK1 && _BV(OCIE1A));
+    return breathing;
 }
 
 void breathing_intensity_default(void)
 {
-    //breath_intensity = (uint8_t)((uint16_t)100 * (uint16_t)get_backlight_level() / (uint16_t)BACKLIGHT_LEVELS);
-    breath_intensity = ((BACKLIGHT_LEVELS - get_backlight_level()) * ((BACKLIGHT_LEVELS + 1) / 2));
+    // Breathe up to the backlight level
+    breath_intensity = 0;
 }
 
 void breathing_intensity_set(uint8_t value)
@@ -667,26 +719,8 @@ void breathing_speed_default(void)
 
 void breathing_speed_set(uint8_t value)
 {
-    bool is_breathing_now = is_breathing();
-    uint8_t old_breath_speed = breath_speed;
-
-    if (is_breathing_now)
-    {
-        // Disable breathing interrupt
-        TIMSK1 &= ~_BV(OCIE1A);
-    }
-
+    // The phase does not depend on the speed, so it carries on from where it is
     breath_speed = value;
-
-    if (is_breathing_now)
-    {
-        // Adjust index to account for new speed
-        breathing_index = (( (uint8_t)( (breathing_index) >> old_breath_speed ) ) & 0x3F) << breath_speed;
-
-        // Enable breathing interrupt
-        TIMSK1 |= _BV(OCIE1A);
-    }
-
 }
 
 void breathing_speed_inc(uint8_t value)
@@ -720,38 +754,27 @@ void breathing_defaults(void)
     breathing_halt = BREATHING_NO_HALT;
 }
 
-/* Breathing Sleep LED brighness(PWM On period) table
- * (64[steps] * 4[duration]) / 64[PWM periods/s] = 4 second breath cycle
- *
- * http://www.wolframalpha.com/input/?i=%28sin%28+x%2F64*pi%29**8+*+255%2C+x%3D0+to+63
- * (0..63).each {|x| p ((sin(x/64.0*PI)**8)*255).to_i }
+/* Advances the breath by a frame and returns its level, scaled to the
+ * backlight level and intensity
+ * (16 << breath_speed) frames = 4 second breath cycle at the default speed and interval
  */
-static const uint8_t breathing_table[64] PROGMEM = {
-  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   1,   2,   4,   6,  10,
- 15,  23,  32,  44,  58,  74,  93, 113, 135, 157, 179, 199, 218, 233, 245, 252,
-255, 252, 245, 233, 218, 199, 179, 157, 135, 113,  93,  74,  58,  44,  32,  23,
- 15,  10,   6,   4,   2,   1,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
-};
-
-ISR(TIMER1_COMPA_vect)
+static uint16_t breathing_next(void)
 {
-    // OCR1x = (pgm_read_byte(&breathing_table[ ( (uint8_t)( (breathing_index++) >> breath_speed ) ) & 0x3F ] )) * breath_intensity;
-
-
-    uint8_t local_index = ( (uint8_t)( (breathing_index++) >> breath_speed ) ) & 0x3F;
+    uint16_t phase = breathing_phase + (0x1000 >> breath_speed);
 
-    if (((breathing_halt == BREATHING_HALT_ON) && (local_index == 0x20)) || ((breathing_halt == BREATHING_HALT_OFF) && (local_index == 0x3F)))
+    if (((breathing_halt == BREATHING_HALT_ON) && (breathing_phase < 0x8000) && (phase >= 0x8000)) ||
+        ((breathing_halt == BREATHING_HALT_OFF) && (phase < breathing_phase)))
     {
-        // Disable breathing interrupt
-        TIMSK1 &= ~_BV(OCIE1A);
+        // Stopped at the brightest point or off, which the backlight level shows
+        breathing = false;
+        return backlight_fade.level;
     }
+    breathing_phase = phase;
 
-    OCR1x = (uint16_t)(((uint16_t)pgm_read_byte(&breathing_table[local_index]) * 257)) >> breath_intensity;
-
+    uint16_t peak = backlight_fade.level >> breath_intensity;
+    return ((uint32_t)led_breathing_level(phase) * peak) >> 16;
 }
 
-
-
 #endif // breathing
 
 #else // backlight
@@ -11,16 +11,21 @@
 #include "keymap.h"
 #ifdef BACKLIGHT_ENABLE
     #include "backlight.h"
+    #include "led_fade.h"
 #endif
 #ifdef RGBLIGHT_ENABLE
   #include "rgblight.h"
 #endif
+#ifdef DYNAMIC_KEYMAP_ENABLE
+  #include "dynamic_keymap.h"
+#endif
 
 #include "action_layer.h"
 #include "eeconfig.h"
 #include <stddef.h>
 #include "bootloader.h"
 #include "timer.h"
+#include "scheduler.h"
 #include "config_common.h"
 #include "led.h"
 #include "action_util.h"
@@ -87,7 +92,27 @@ void register_code16 (uint16_t code);
 void unregister_code16 (uint16_t code);
 
 #ifdef BACKLIGHT_ENABLE
+// Milliseconds between backlight frames, see backlight_task()
+#ifndef BACKLIGHT_FRAME_INTERVAL
+#define BACKLIGHT_FRAME_INTERVAL 16
+#endif
+// Frames a change of backlight level fades over, 0 changes it at once
+#ifndef BACKLIGHT_FADE_FRAMES
+#define BACKLIGHT_FADE_FRAMES 8
+#endif
+// Microseconds backlight_task(), and the PWM interrupt, should take
+#ifndef BACKLIGHT_TASK_BUDGET
+#define BACKLIGHT_TASK_BUDGET 200
+#endif
+#ifndef BACKLIGHT_ISR_BUDGET
+#define BACKLIGHT_ISR_BUDGET 10
+#endif
+
 void backlight_init_ports(void);
+// Computes the next fade or breathing frame, called from the main loop
+void backlight_task(void);
+// Prints the duty cycle, the frames are counted by the scheduler
+void backlight_debug_frames(void);
 
 #ifdef BACKLIGHT_BREATHING
 void breathing_enable(void);
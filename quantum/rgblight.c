@@ -3,27 +3,11 @@
 #include <util/delay.h>
 #include "progmem.h"
 #include "timer.h"
+#include "avr/timer_avr.h"
 #include "rgblight.h"
+#include "scheduler.h"
 #include "debug.h"
 
-const uint8_t DIM_CURVE[] PROGMEM = {
-  0, 1, 1, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3,
-  3, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4, 4,
-  4, 4, 4, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 6, 6, 6,
-  6, 6, 6, 6, 6, 7, 7, 7, 7, 7, 7, 7, 8, 8, 8, 8,
-  8, 8, 9, 9, 9, 9, 9, 9, 10, 10, 10, 10, 10, 11, 11, 11,
-  11, 11, 12, 12, 12, 12, 12, 13, 13, 13, 13, 14, 14, 14, 14, 15,
-  15, 15, 16, 16, 16, 16, 17, 17, 17, 18, 18, 18, 19, 19, 19, 20,
-  20, 20, 21, 21, 22, 22, 22, 23, 23, 24, 24, 25, 25, 25, 26, 26,
-  27, 27, 28, 28, 29, 29, 30, 30, 31, 32, 32, 33, 33, 34, 35, 35,
-  36, 36, 37, 38, 38, 39, 40, 40, 41, 42, 43, 43, 44, 45, 46, 47,
-  48, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62,
-  63, 64, 65, 66, 68, 69, 70, 71, 73, 74, 75, 76, 78, 79, 81, 82,
-  83, 85, 86, 88, 90, 91, 93, 94, 96, 98, 99, 101, 103, 105, 107, 109,
-  110, 112, 114, 116, 118, 121, 123, 125, 127, 129, 132, 134, 136, 139, 141, 144,
-  146, 149, 151, 154, 157, 159, 162, 165, 168, 171, 174, 177, 180, 183, 186, 190,
-  193, 196, 200, 203, 207, 211, 214, 218, 222, 226, 230, 234, 238, 242, 248, 255
-};
 const uint8_t RGBLED_BREATHING_TABLE[] PROGMEM = {
   0, 0, 0, 0, 1, 1, 1, 2, 2, 3, 4, 5, 5, 6, 7, 9,
   10, 11, 12, 14, 15, 17, 18, 20, 21, 23, 25, 27, 29, 31, 33, 35,
@@ -53,58 +37,49 @@ rgblight_config_t inmem_config;
 struct cRGB led[RGBLED_NUM];
 uint8_t rgblight_inited = 0;
 
+#ifdef RGBLIGHT_TIMER
+static bool rgblight_animating = false;
+static uint16_t rgblight_frame_timer = 0;
+#endif
+
+// What the strip shows, led[] with the regions on top. Only the LEDs up
+// to the last one that changed are sent, the ones after it keep their color.
+static struct cRGB frame[RGBLED_NUM];
+static bool frame_valid = false;
+// Set when a region changed, so that rgblight_task() sends the frame
+static bool frame_dirty = false;
+
+typedef struct {
+  uint8_t first;
+  uint8_t count;
+  struct cRGB color;
+} rgblight_region_t;
+
+static rgblight_region_t regions[RGBLIGHT_REGIONS];
+
+static uint16_t rgblight_frames_sent = 0;
+static uint32_t rgblight_leds_sent = 0;
+// Time spent in ws2812_setleds(), which runs with interrupts disabled
+static uint16_t rgblight_irq_off_last = 0;
+static uint16_t rgblight_irq_off_max = 0;
+
+static scheduler_job_t rgblight_job = SCHEDULER_JOB("rgblight", rgblight_task, SCHEDULER_PRIORITY_RGBLIGHT, 0, RGBLIGHT_TASK_BUDGET);
+
 
 void sethsv(uint16_t hue, uint8_t sat, uint8_t val, struct cRGB *led1) {
-  // Convert hue, saturation, and value (HSV/HSB) to RGB. DIM_CURVE is used only
-  // on value and saturation (inverted). This looks the most natural.
-  uint8_t r = 0, g = 0, b = 0, base, color;
+  hsv_to_rgb(hue, sat, val, &led1->r, &led1->g, &led1->b);
+}
 
-  val = pgm_read_byte(&DIM_CURVE[val]);
-  sat = 255 - pgm_read_byte(&DIM_CURVE[255 - sat]);
+void sethsv_range(uint16_t hue, uint16_t hue_step, uint8_t sat, uint8_t val, struct cRGB *leds, uint8_t count) {
+  hsv_level_t level = hsv_level(sat, val);
 
-  if (sat == 0) { // Acromatic color (gray). Hue doesn't mind.
-    r = val;
-    g = val;
-    b = val;
-  } else {
-    base = ((255 - sat) * val) >> 8;
-    color = (val - base) * (hue % 60) / 60;
-
-    switch (hue / 60) {
-      case 0:
-        r = val;
-        g = base + color;
-        b = base;
-        break;
-      case 1:
-        r = val - color;
-        g = val;
-        b = base;
-        break;
-      case 2:
-        r = base;
-        g = val;
-        b = base + color;
-        break;
-      case 3:
-        r = base;
-        g = val - color;
-        b = val;
-        break;
-      case 4:
-        r = base + color;
-        g = base;
-        b = val;
-        break;
-      case 5:
-        r = val;
-        g = base;
-        b = val - color;
-        break;
+  for (uint8_t i = 0; i < count; i++) {
+    hsv_wheel_to_rgb(hsv_hue_to_wheel(hue), level, &leds[i].r, &leds[i].g, &leds[i].b);
+    hue += hue_step;
+    if (hue >= 360) {
+      hue -= 360;
     }
   }
-
-  setrgb(r, g, b, led1);
 }
 
 void setrgb(uint8_t r, uint8_t g, uint8_t b, struct cRGB *led1) {
@@ -115,10 +90,10 @@ void setrgb(uint8_t r, uint8_t g, uint8_t b, struct cRGB *led1) {
 
 
 uint32_t eeconfig_read_rgblight(void) {
-  return eeprom_read_dword(EECONFIG_RGBLIGHT);
+  return eeconfig_read_dword(EECONFIG_RGBLIGHT);
 }
 void eeconfig_update_rgblight(uint32_t val) {
-  eeprom_update_dword(EECONFIG_RGBLIGHT, val);
+  eeconfig_update_dword(EECONFIG_RGBLIGHT, val);
 }
 void eeconfig_update_rgblight_default(void) {
   dprintf("eeconfig_update_rgblight_default\n");
@@ -156,9 +131,8 @@ void rgblight_init(void) {
   }
   eeconfig_debug_rgblight(); // display current eeprom values
 
-  #if !defined(AUDIO_ENABLE) && defined(RGBLIGHT_TIMER)
-    rgblight_timer_init(); // setup the timer
-  #endif
+  // Times its own animation frames, so it's looked at every pass
+  scheduler_add(&rgblight_job);
 
   if (rgblight_config.enable) {
     rgblight_mode(rgblight_config.mode);
@@ -203,17 +177,19 @@ void rgblight_mode(uint8_t mode) {
   eeconfig_update_rgblight(rgblight_config.raw);
   xprintf("rgblight mode: %u\n", rgblight_config.mode);
   if (rgblight_config.mode == 1) {
-    #if !defined(AUDIO_ENABLE) && defined(RGBLIGHT_TIMER)
+    #ifdef RGBLIGHT_TIMER
       rgblight_timer_disable();
     #endif
-  } else if (rgblight_config.mode >= 2 && rgblight_config.mode <= 23) {
+  } else if (rgblight_config.mode >= 2 && rgblight_config.mode <= 25) {
     // MODE 2-5, breathing
     // MODE 6-8, rainbow mood
     // MODE 9-14, rainbow swirl
     // MODE 15-20, snake
     // MODE 21-23, knight
+    // MODE 24, ripple
+    // MODE 25, heatmap
 
-    #if !defined(AUDIO_ENABLE) && defined(RGBLIGHT_TIMER)
+    #ifdef RGBLIGHT_TIMER
       rgblight_timer_enable();
     #endif
   }
@@ -227,7 +203,7 @@ void rgblight_toggle(void) {
   if (rgblight_config.enable) {
     rgblight_mode(rgblight_config.mode);
   } else {
-    #if !defined(AUDIO_ENABLE) && defined(RGBLIGHT_TIMER)
+    #ifdef RGBLIGHT_TIMER
       rgblight_timer_disable();
     #endif
     _delay_ms(50);
@@ -322,62 +298,112 @@ void rgblight_sethsv(uint16_t hue, uint8_t sat, uint8_t val) {
   }
 }
 
-void rgblight_setrgb(uint8_t r, uint8_t g, uint8_t b) {
-  // dprintf("rgblight set rgb: %u,%u,%u\n", r,g,b);
+static void rgblight_fill(uint8_t r, uint8_t g, uint8_t b) {
   for (uint8_t i = 0; i < RGBLED_NUM; i++) {
     led[i].r = r;
     led[i].g = g;
     led[i].b = b;
   }
+}
+
+void rgblight_setrgb(uint8_t r, uint8_t g, uint8_t b) {
+  // dprintf("rgblight set rgb: %u,%u,%u\n", r,g,b);
+  rgblight_fill(r, g, b);
   rgblight_set();
 }
 
-void rgblight_set(void) {
-  if (rgblight_config.enable) {
-    ws2812_setleds(led, RGBLED_NUM);
-  } else {
-    for (uint8_t i = 0; i < RGBLED_NUM; i++) {
-      led[i].r = 0;
-      led[i].g = 0;
-      led[i].b = 0;
+// Timer0 ticks since boot, read atomically
+static uint32_t rgblight_ticks(void) {
+  uint8_t sreg = SREG;
+  cli();
+  uint32_t ticks = timer_read32() * TIMER_RAW_TOP + TIMER_RAW;
+  SREG = sreg;
+  return ticks;
+}
+
+// Composes the frame, and sends the part of it that changed
+static void rgblight_flush(void) {
+  uint8_t length = 0;
+
+  for (uint8_t i = 0; i < RGBLED_NUM; i++) {
+    struct cRGB color = led[i];
+    for (uint8_t j = 0; j < RGBLIGHT_REGIONS; j++) {
+      if ((uint8_t)(i - regions[j].first) < regions[j].count) {
+        color = regions[j].color;
+      }
     }
-    ws2812_setleds(led, RGBLED_NUM);
+    if (!rgblight_config.enable) {
+      color.r = color.g = color.b = 0;
+    }
+    if (color.r != frame[i].r || color.g != frame[i].g || color.b != frame[i].b) {
+      frame[i] = color;
+      length = i + 1;
+    }
+  }
+  if (!frame_valid) {
+    // The strip may still show what the firmware before the reset set
+    length = RGBLED_NUM;
+    frame_valid = true;
   }
+  frame_dirty = false;
+  if (length == 0) {
+    return;
+  }
+
+  uint32_t start = rgblight_ticks();
+  ws2812_setleds(frame, length);
+  // The timer interrupt is held off during the transfer, so only one
+  // millisecond can be missed, which is more than any strip takes
+  rgblight_irq_off_last = (rgblight_ticks() - start) * 1000 / TIMER_RAW_TOP;
+  if (rgblight_irq_off_last > rgblight_irq_off_max) {
+    rgblight_irq_off_max = rgblight_irq_off_last;
+  }
+  rgblight_frames_sent++;
+  rgblight_leds_sent += length;
 }
 
-#if !defined(AUDIO_ENABLE) && defined(RGBLIGHT_TIMER)
+void rgblight_set(void) {
+  rgblight_flush();
+}
 
-// Animation timer -- AVR Timer3
-void rgblight_timer_init(void) {
-  static uint8_t rgblight_timer_is_init = 0;
-  if (rgblight_timer_is_init) {
+void rgblight_set_region(uint8_t region, uint8_t first, uint8_t count, uint8_t r, uint8_t g, uint8_t b) {
+  if (region >= RGBLIGHT_REGIONS) {
     return;
   }
-  rgblight_timer_is_init = 1;
-  /* Timer 3 setup */
-  TCCR3B = _BV(WGM32) //CTC mode OCR3A as TOP
-        | _BV(CS30); //Clock selelct: clk/1
-  /* Set TOP value */
-  uint8_t sreg = SREG;
-  cli();
-  OCR3AH = (RGBLED_TIMER_TOP >> 8) & 0xff;
-  OCR3AL = RGBLED_TIMER_TOP & 0xff;
-  SREG = sreg;
+  regions[region].first = first;
+  regions[region].count = count;
+  regions[region].color.r = r;
+  regions[region].color.g = g;
+  regions[region].color.b = b;
+  frame_dirty = true;
+}
+
+void rgblight_clear_region(uint8_t region) {
+  rgblight_set_region(region, 0, 0, 0, 0, 0);
+}
+
+void rgblight_debug_frames(void) {
+  xprintf("rgblight frames sent: %u, LEDs sent: %lu\n", rgblight_frames_sent, rgblight_leds_sent);
+  xprintf("rgblight interrupts off: %uus, max %uus\n", rgblight_irq_off_last, rgblight_irq_off_max);
 }
+
+#ifdef RGBLIGHT_TIMER
+
+// Animations are computed in the main loop, see rgblight_task()
 void rgblight_timer_enable(void) {
-  TIMSK3 |= _BV(OCIE3A);
-  dprintf("TIMER3 enabled.\n");
+  rgblight_animating = true;
+  dprintf("rgblight animation enabled.\n");
 }
 void rgblight_timer_disable(void) {
-  TIMSK3 &= ~_BV(OCIE3A);
-  dprintf("TIMER3 disabled.\n");
+  rgblight_animating = false;
+  dprintf("rgblight animation disabled.\n");
 }
 void rgblight_timer_toggle(void) {
-  TIMSK3 ^= _BV(OCIE3A);
-  dprintf("TIMER3 toggled.\n");
+  rgblight_animating = !rgblight_animating;
+  dprintf("rgblight animation toggled.\n");
 }
 
-ISR(TIMER3_COMPA_vect) {
+static void rgblight_animate(void) {
   // mode = 1, static light, do nothing here
   if (rgblight_config.mode >= 2 && rgblight_config.mode <= 5) {
     // mode = 2 to 5, breathing mode
@@ -394,10 +420,20 @@ ISR(TIMER3_COMPA_vect) {
   } else if (rgblight_config.mode >= 21 && rgblight_config.mode <= 23) {
     // mode = 21 to 23, knight mode
     rgblight_effect_knight(rgblight_config.mode - 21);
+  } else if (rgblight_config.mode == 24) {
+    rgblight_effect_ripple();
+  } else if (rgblight_config.mode == 25) {
+    rgblight_effect_heatmap();
   }
 }
 
 // Effects
+// They only update the frame buffer, rgblight_task() sends it
+static void rgblight_fill_hsv(uint16_t hue, uint8_t sat, uint8_t val) {
+  struct cRGB tmp_led;
+  sethsv(hue, sat, val, &tmp_led);
+  rgblight_fill(tmp_led.r, tmp_led.g, tmp_led.b);
+}
 void rgblight_effect_breathing(uint8_t interval) {
   static uint8_t pos = 0;
   static uint16_t last_timer = 0;
@@ -407,7 +443,7 @@ void rgblight_effect_breathing(uint8_t interval) {
   }
   last_timer = timer_read();
 
-  rgblight_sethsv_noeeprom(rgblight_config.hue, rgblight_config.sat, pgm_read_byte(&RGBLED_BREATHING_TABLE[pos]));
+  rgblight_fill_hsv(rgblight_config.hue, rgblight_config.sat, pgm_read_byte(&RGBLED_BREATHING_TABLE[pos]));
   pos = (pos + 1) % 256;
 }
 void rgblight_effect_rainbow_mood(uint8_t interval) {
@@ -418,23 +454,17 @@ void rgblight_effect_rainbow_mood(uint8_t interval) {
     return;
   }
   last_timer = timer_read();
-  rgblight_sethsv_noeeprom(current_hue, rgblight_config.sat, rgblight_config.val);
+  rgblight_fill_hsv(current_hue, rgblight_config.sat, rgblight_config.val);
   current_hue = (current_hue + 1) % 360;
 }
 void rgblight_effect_rainbow_swirl(uint8_t interval) {
   static uint16_t current_hue = 0;
   static uint16_t last_timer = 0;
-  uint16_t hue;
-  uint8_t i;
   if (timer_elapsed(last_timer) < pgm_read_byte(&RGBLED_RAINBOW_MOOD_INTERVALS[interval / 2])) {
     return;
   }
   last_timer = timer_read();
-  for (i = 0; i < RGBLED_NUM; i++) {
-    hue = (360 / RGBLED_NUM * i + current_hue) % 360;
-    sethsv(hue, rgblight_config.sat, rgblight_config.val, &led[i]);
-  }
-  rgblight_set();
+  sethsv_range(current_hue, 360 / RGBLED_NUM, rgblight_config.sat, rgblight_config.val, led, RGBLED_NUM);
 
   if (interval % 2) {
     current_hue = (current_hue + 1) % 360;
@@ -473,7 +503,6 @@ void rgblight_effect_snake(uint8_t interval) {
       }
     }
   }
-  rgblight_set();
   if (increment == 1) {
     if (pos - 1 < 0) {
       pos = RGBLED_NUM - 1;
@@ -520,7 +549,6 @@ void rgblight_effect_knight(uint8_t interval) {
       led[i].b = preled[cur].b;
     }
   }
-  rgblight_set();
   if (increment == 1) {
     if (pos - 1 < 0 - RGBLIGHT_EFFECT_KNIGHT_LENGTH) {
       pos = 0 - RGBLIGHT_EFFECT_KNIGHT_LENGTH;
@@ -538,4 +566,25 @@ void rgblight_effect_knight(uint8_t interval) {
   }
 }
 
+void rgblight_effect_ripple(void) {
+  rgblight_reactive_ripple(led, timer_read(), rgblight_config.hue, rgblight_config.sat, rgblight_config.val);
+}
+void rgblight_effect_heatmap(void) {
+  rgblight_reactive_heatmap(led, timer_read(), rgblight_config.sat, rgblight_config.val);
+}
+
 #endif
+
+void rgblight_task(void) {
+#ifdef RGBLIGHT_TIMER
+  if (rgblight_animating && timer_elapsed(rgblight_frame_timer) >= RGBLIGHT_FRAME_INTERVAL) {
+    rgblight_frame_timer = timer_read();
+    rgblight_animate();
+    rgblight_flush();
+    return;
+  }
+#endif
+  if (frame_dirty) {
+    rgblight_flush();
+  }
+}
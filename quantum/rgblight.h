@@ -2,8 +2,8 @@
 #define RGBLIGHT_H
 
 
-#if !defined(AUDIO_ENABLE) && defined(RGBLIGHT_TIMER)
-	#define RGBLIGHT_MODES 23
+#ifdef RGBLIGHT_TIMER
+	#define RGBLIGHT_MODES 25
 #else
 	#define RGBLIGHT_MODES 1
 #endif
@@ -33,12 +33,27 @@
 #define RGBLIGHT_VAL_STEP 17
 #endif
 
-#define RGBLED_TIMER_TOP F_CPU/(256*64)
+// Milliseconds between animation frames, see rgblight_task()
+#ifndef RGBLIGHT_FRAME_INTERVAL
+#define RGBLIGHT_FRAME_INTERVAL 5
+#endif
+// Microseconds rgblight_task() should take, sending a WS2812 LED takes 30
+#ifndef RGBLIGHT_TASK_BUDGET
+#define RGBLIGHT_TASK_BUDGET (RGBLED_NUM * 30 + 300)
+#endif
+
+// Ranges of LEDs that show a fixed color on top of the effects, for example
+// layer indicators, see rgblight_set_region()
+#ifndef RGBLIGHT_REGIONS
+#define RGBLIGHT_REGIONS 2
+#endif
 
 #include <stdint.h>
 #include <stdbool.h>
 #include "eeconfig.h"
 #include "light_ws2812.h"
+#include "color.h"
+#include "rgblight_reactive.h"
 
 typedef union {
   uint32_t raw;
@@ -57,7 +72,12 @@ void rgblight_decrease(void);
 void rgblight_toggle(void);
 void rgblight_step(void);
 void rgblight_mode(uint8_t mode);
+// Sends the LEDs that changed since the last frame
 void rgblight_set(void);
+// Gives count LEDs from first to a region, which shows the color on top of
+// the effects, later regions on top of earlier ones. A count of 0 releases it.
+void rgblight_set_region(uint8_t region, uint8_t first, uint8_t count, uint8_t r, uint8_t g, uint8_t b);
+void rgblight_clear_region(uint8_t region);
 void rgblight_increase_hue(void);
 void rgblight_decrease_hue(void);
 void rgblight_increase_sat(void);
@@ -73,10 +93,17 @@ void eeconfig_update_rgblight_default(void);
 void eeconfig_debug_rgblight(void);
 
 void sethsv(uint16_t hue, uint8_t sat, uint8_t val, struct cRGB *led1);
+// Sets count LEDs, each one hue_step degrees further than the previous one
+void sethsv_range(uint16_t hue, uint16_t hue_step, uint8_t sat, uint8_t val, struct cRGB *leds, uint8_t count);
 void setrgb(uint8_t r, uint8_t g, uint8_t b, struct cRGB *led1);
 void rgblight_sethsv_noeeprom(uint16_t hue, uint8_t sat, uint8_t val);
 
-void rgblight_timer_init(void);
+// Computes the next animation frame, and sends the LEDs that changed,
+// called from the main loop
+void rgblight_task(void);
+// Prints the frames sent, and how long interrupts were off for the last one
+void rgblight_debug_frames(void);
+
 void rgblight_timer_enable(void);
 void rgblight_timer_disable(void);
 void rgblight_timer_toggle(void);
@@ -85,5 +112,7 @@ void rgblight_effect_rainbow_mood(uint8_t interval);
 void rgblight_effect_rainbow_swirl(uint8_t interval);
 void rgblight_effect_snake(uint8_t interval);
 void rgblight_effect_knight(uint8_t interval);
+void rgblight_effect_ripple(void);
+void rgblight_effect_heatmap(void);
 
 #endif
@@ -0,0 +1,99 @@
+#include "rgblight_reactive.h"
+#include "matrix.h"
+#include "color.h"
+
+#define NO_LED 0xFF
+
+typedef struct {
+  uint8_t led;
+  uint16_t time;
+} reactive_event_t;
+
+static reactive_event_t events[RGBLIGHT_REACTIVE_EVENTS];
+static uint8_t event_next = 0;
+static uint8_t event_count = 0;
+
+static uint8_t heat[RGBLED_NUM];
+static uint16_t heat_timer = 0;
+
+__attribute__ ((weak))
+uint8_t rgblight_key_to_led(keypos_t key) {
+  return (uint16_t)(key.row * MATRIX_COLS + key.col) * RGBLED_NUM / (MATRIX_ROWS * MATRIX_COLS);
+}
+
+static void add_heat(int16_t led, uint8_t amount) {
+  if (led < 0 || led >= RGBLED_NUM) {
+    return;
+  }
+  heat[led] = heat[led] > 255 - amount ? 255 : heat[led] + amount;
+}
+
+void rgblight_reactive_record(keypos_t key, uint16_t time) {
+  uint8_t led = rgblight_key_to_led(key);
+
+  if (led >= RGBLED_NUM) {
+    return;
+  }
+  events[event_next].led = led;
+  events[event_next].time = time;
+  event_next = (event_next + 1) % RGBLIGHT_REACTIVE_EVENTS;
+  if (event_count < RGBLIGHT_REACTIVE_EVENTS) {
+    event_count++;
+  }
+
+  add_heat(led, RGBLIGHT_HEATMAP_INCREMENT);
+  add_heat(led - 1, RGBLIGHT_HEATMAP_INCREMENT / 2);
+  add_heat(led + 1, RGBLIGHT_HEATMAP_INCREMENT / 2);
+}
+
+void rgblight_reactive_ripple(struct cRGB *leds, uint16_t now, uint16_t hue, uint8_t sat, uint8_t val) {
+  uint8_t brightness[RGBLED_NUM] = {0};
+
+  for (uint8_t e = 0; e < event_count; e++) {
+    uint16_t age = now - events[e].time;
+    if (events[e].led == NO_LED) {
+      continue;
+    }
+    if (age >= RGBLIGHT_RIPPLE_TIMEOUT) {
+      // Or it would come back when the timer wraps
+      events[e].led = NO_LED;
+      continue;
+    }
+    uint8_t radius = age / RGBLIGHT_RIPPLE_SPEED;
+    uint8_t level = val - (uint32_t)val * age / RGBLIGHT_RIPPLE_TIMEOUT;
+    // The ring of the ripple, on both sides of the key
+    int16_t left = events[e].led - radius;
+    int16_t right = events[e].led + radius;
+    if (left >= 0 && brightness[left] < level) {
+      brightness[left] = level;
+    }
+    if (right < RGBLED_NUM && brightness[right] < level) {
+      brightness[right] = level;
+    }
+  }
+
+  for (uint8_t i = 0; i < RGBLED_NUM; i++) {
+    hsv_to_rgb(hue, sat, brightness[i], &leds[i].r, &leds[i].g, &leds[i].b);
+  }
+}
+
+void rgblight_reactive_heatmap(struct cRGB *leds, uint16_t now, uint8_t sat, uint8_t val) {
+  uint16_t elapsed = now - heat_timer;
+  uint8_t decay = elapsed / RGBLIGHT_HEATMAP_DECAY > 255 ? 255 : elapsed / RGBLIGHT_HEATMAP_DECAY;
+
+  heat_timer += decay * RGBLIGHT_HEATMAP_DECAY;
+  if (decay == 255) {
+    heat_timer = now;
+  }
+  hsv_level_t level = hsv_level(sat, val);
+  for (uint8_t i = 0; i < RGBLED_NUM; i++) {
+    heat[i] = heat[i] > decay ? heat[i] - decay : 0;
+    if (heat[i] == 0) {
+      leds[i].r = leds[i].g = leds[i].b = 0;
+    } else {
+      // 240 degrees, blue, when cold, down to 0, red
+      uint16_t hue = 240 - ((heat[i] * 15) >> 4);
+      hsv_wheel_to_rgb(hsv_hue_to_wheel(hue), level, &leds[i].r, &leds[i].g, &leds[i].b);
+    }
+  }
+}
@@ -0,0 +1,45 @@
+#ifndef RGBLIGHT_REACTIVE_H
+#define RGBLIGHT_REACTIVE_H
+
+#include <stdint.h>
+#include "keyboard.h"
+#include "light_ws2812.h"
+
+/* Lighting effects that react to key presses
+ *
+ * Presses are kept in a small ring, the oldest one is dropped when it's
+ * full, so rendering a frame costs the same however fast someone types.
+ * A ripple costs RGBLIGHT_REACTIVE_EVENTS steps per LED, the heatmap one.
+ */
+
+// Presses that ripples are drawn for
+#ifndef RGBLIGHT_REACTIVE_EVENTS
+#define RGBLIGHT_REACTIVE_EVENTS 8
+#endif
+// Milliseconds a ripple takes to move one LED further
+#ifndef RGBLIGHT_RIPPLE_SPEED
+#define RGBLIGHT_RIPPLE_SPEED 30
+#endif
+// Milliseconds until a ripple has faded out
+#ifndef RGBLIGHT_RIPPLE_TIMEOUT
+#define RGBLIGHT_RIPPLE_TIMEOUT 600
+#endif
+// Heat a press adds to its LED, its neighbours get half
+#ifndef RGBLIGHT_HEATMAP_INCREMENT
+#define RGBLIGHT_HEATMAP_INCREMENT 64
+#endif
+// Milliseconds for the heat of every LED to go down by one
+#ifndef RGBLIGHT_HEATMAP_DECAY
+#define RGBLIGHT_HEATMAP_DECAY 40
+#endif
+
+/* The LED below a key, spreads the matrix evenly over the strip by default */
+uint8_t rgblight_key_to_led(keypos_t key);
+
+void rgblight_reactive_record(keypos_t key, uint16_t time);
+/* Render RGBLED_NUM LEDs for the time now */
+void rgblight_reactive_ripple(struct cRGB *leds, uint16_t now, uint16_t hue, uint8_t sat, uint8_t val);
+/* Cold LEDs are off, warm ones go from blue to red */
+void rgblight_reactive_heatmap(struct cRGB *leds, uint16_t now, uint8_t sat, uint8_t val);
+
+#endif
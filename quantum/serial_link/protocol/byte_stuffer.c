@@ -25,17 +25,29 @@ SOFTWARE.
 #include "serial_link/protocol/byte_stuffer.h"
 #include "serial_link/protocol/frame_validator.h"
 #include "serial_link/protocol/physical.h"
+#include "serial_link/protocol/link_statistics.h"
 #include <stdbool.h>
 
 // This implements the "Consistent overhead byte stuffing protocol"
 // https://en.wikipedia.org/wiki/Consistent_Overhead_Byte_Stuffing
 // http://www.stuartcheshire.org/papers/COBSforToN.pdf
 
+#ifdef SERIAL_LINK_EXPLICIT_ADDRESSING
+// The encoded frame can be up to one byte longer per 254 data bytes, plus the
+// first block header and the terminating zero
+#define MAX_ENCODED_FRAME_SIZE (MAX_FRAME_SIZE + MAX_FRAME_SIZE / 254 + 2)
+#endif
+
 typedef struct byte_stuffer_state {
     uint16_t next_zero;
     uint16_t data_pos;
     bool long_frame;
     uint8_t data[MAX_FRAME_SIZE];
+#ifdef SERIAL_LINK_EXPLICIT_ADDRESSING
+    // The frame as it was received, so that it can be forwarded as is
+    uint16_t encoded_pos;
+    uint8_t encoded[MAX_ENCODED_FRAME_SIZE];
+#endif
 }byte_stuffer_state_t;
 
 static byte_stuffer_state_t states[NUM_LINKS];
@@ -44,6 +56,24 @@ void init_byte_stuffer_state(byte_stuffer_state_t* state) {
     state->next_zero = 0;
     state->data_pos = 0;
     state->long_frame = false;
+#ifdef SERIAL_LINK_EXPLICIT_ADDRESSING
+    state->encoded_pos = 0;
+#endif
+}
+
+static void store_encoded_byte(byte_stuffer_state_t* state, uint8_t data, bool start_of_frame) {
+#ifdef SERIAL_LINK_EXPLICIT_ADDRESSING
+    if (start_of_frame) {
+        state->encoded_pos = 0;
+    }
+    if (state->encoded_pos < MAX_ENCODED_FRAME_SIZE) {
+        state->encoded[state->encoded_pos++] = data;
+    }
+#else
+    (void)state;
+    (void)data;
+    (void)start_of_frame;
+#endif
 }
 
 void init_byte_stuffer(void) {
@@ -55,8 +85,11 @@ void init_byte_stuffer(void) {
 
 void byte_stuffer_recv_byte(uint8_t link, uint8_t data) {
     byte_stuffer_state_t* state = &states[link];
+    link_statistics_t* stats = get_link_statistics(link);
+    stats->bytes_received++;
     // Start of a new frame
     if (state->next_zero == 0) {
+        store_encoded_byte(state, data, true);
         state->next_zero = data;
         state->long_frame = data == 0xFF;
         state->data_pos = 0;
@@ -64,6 +97,7 @@ void byte_stuffer_recv_byte(uint8_t link, uint8_t data) {
     }
 
     state->next_zero--;
+    store_encoded_byte(state, data, false);
     if (data == 0) {
         if (state->next_zero == 0) {
             // The frame is completed
@@ -73,6 +107,7 @@ void byte_stuffer_recv_byte(uint8_t link, uint8_t data) {
         }
         else {
             // The frame is invalid, so reset
+            stats->invalid_frames++;
             init_byte_stuffer_state(state);
         }
     }
@@ -80,6 +115,8 @@ void byte_stuffer_recv_byte(uint8_t link, uint8_t data) {
         if (state->data_pos == MAX_FRAME_SIZE) {
             // We exceeded our maximum frame size
             // therefore there's nothing else to do than reset to a new frame
+            stats->oversize_frames++;
+            store_encoded_byte(state, data, true);
             state->next_zero = data;
             state->long_frame = data == 0xFF;
             state->data_pos = 0;
@@ -107,6 +144,7 @@ static void send_block(uint8_t link, uint8_t* start, uint8_t* end, uint8_t num_n
     if (end > start) {
         send_data(link, start, end-start);
     }
+    get_link_statistics(link)->bytes_sent += 1 + (end - start);
 }
 
 void byte_stuffer_send_frame(uint8_t link, uint8_t* data, uint16_t size) {
@@ -138,5 +176,16 @@ void byte_stuffer_send_frame(uint8_t link, uint8_t* data, uint16_t size) {
         }
         send_block(link, start, data, num_non_zero);
         send_data(link, &zero, 1);
+        get_link_statistics(link)->bytes_sent++;
     }
 }
+
+#ifdef SERIAL_LINK_EXPLICIT_ADDRESSING
+void byte_stuffer_forward_frame(uint8_t from_link, uint8_t to_link) {
+    byte_stuffer_state_t* state = &states[from_link];
+    send_data(to_link, state->encoded, state->encoded_pos);
+    link_statistics_t* stats = get_link_statistics(to_link);
+    stats->bytes_sent += state->encoded_pos;
+    stats->frames_forwarded++;
+}
+#endif
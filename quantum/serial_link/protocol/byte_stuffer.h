@@ -33,5 +33,10 @@ SOFTWARE.
 void init_byte_stuffer(void);
 void byte_stuffer_recv_byte(uint8_t link, uint8_t data);
 void byte_stuffer_send_frame(uint8_t link, uint8_t* data, uint16_t size);
+#ifdef SERIAL_LINK_EXPLICIT_ADDRESSING
+// Sends the frame that was just completed on from_link unmodified to to_link.
+// Only valid while the frame is being processed
+void byte_stuffer_forward_frame(uint8_t from_link, uint8_t to_link);
+#endif
 
 #endif
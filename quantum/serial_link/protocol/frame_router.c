@@ -25,6 +25,7 @@ SOFTWARE.
 #include "serial_link/protocol/frame_router.h"
 #include "serial_link/protocol/transport.h"
 #include "serial_link/protocol/frame_validator.h"
+#include "serial_link/protocol/byte_stuffer.h"
 
 static bool is_master;
 
@@ -32,9 +33,21 @@ void router_set_master(bool master) {
    is_master = master;
 }
 
+// The transport only has room for the objects of slaves 1 to NUM_SLAVES
+static bool valid_slave(uint8_t slave) {
+    return slave != 0 && slave <= NUM_SLAVES;
+}
+
+#ifndef SERIAL_LINK_EXPLICIT_ADDRESSING
+
+// The last byte of each frame contains the routing information
+// Frames going down contains a bitmask of the target slaves, which is shifted
+// by each slave, so the lowest bit always refers to the receiving slave
+// Frames going up contains a hop count, which is increased by each slave
+
 void route_incoming_frame(uint8_t link, uint8_t* data, uint16_t size){
     if (is_master) {
-        if (link == DOWN_LINK) {
+        if (link == DOWN_LINK && valid_slave(data[size-1])) {
             transport_recv_frame(data[size-1], data, size - 1);
         }
     }
@@ -67,3 +80,125 @@ void router_send_frame(uint8_t destination, uint8_t* data, uint16_t size) {
         }
     }
 }
+
+#else
+
+#if NUM_SLAVES >= ROUTER_ADDRESS_DISCOVERY
+#error "NUM_SLAVES has to be below the discovery and broadcast addresses"
+#endif
+
+// The last byte of each frame contains the address of the target slave for
+// frames going down, and the address of the sending slave for frames going up.
+// The addresses never change, so the slaves can pass through frames that are
+// not for them without decoding, validating or re-encoding them.
+// The slaves get their addresses assigned by the discovery frame, which is the
+// only frame that is modified on the way down.
+
+static uint8_t address;
+static uint8_t num_slaves;
+static uint8_t discovered_slaves;
+
+void router_set_address(uint8_t a) {
+    address = a;
+}
+
+uint8_t router_get_address(void) {
+    return address;
+}
+
+uint8_t router_get_num_slaves(void) {
+    return num_slaves;
+}
+
+void router_start_discovery(void) {
+    if (is_master) {
+        // The slaves that didn't answer the last discovery are considered gone
+        num_slaves = discovered_slaves;
+        discovered_slaves = 0;
+        uint8_t frame[2 + 4] = {0, ROUTER_ADDRESS_DISCOVERY};
+        validator_send_frame(DOWN_LINK, frame, 2);
+    }
+}
+
+bool router_filter_frame(uint8_t link, uint8_t* data, uint16_t size) {
+    if (is_master) {
+        return link == DOWN_LINK;
+    }
+    if (link == DOWN_LINK) {
+        // Everything coming from below is for the master
+        byte_stuffer_forward_frame(DOWN_LINK, UP_LINK);
+        return false;
+    }
+    if (size < 5) {
+        return false;
+    }
+    uint8_t destination = data[size - 5];
+    if (destination == ROUTER_ADDRESS_DISCOVERY) {
+        return true;
+    }
+    if (destination != address) {
+        byte_stuffer_forward_frame(UP_LINK, DOWN_LINK);
+    }
+    return destination == address || destination == ROUTER_ADDRESS_BROADCAST;
+}
+
+static void discovery_frame_received(uint8_t link, uint8_t* data, uint16_t size) {
+    if (size != 2) {
+        return;
+    }
+    if (is_master) {
+        if (link == DOWN_LINK && valid_slave(data[0])) {
+            if (data[0] > discovered_slaves) {
+                discovered_slaves = data[0];
+            }
+            if (discovered_slaves > num_slaves) {
+                num_slaves = discovered_slaves;
+            }
+        }
+    }
+    else if (link == UP_LINK) {
+        // The slaves past NUM_SLAVES stay without an address, and don't
+        // pass the discovery on to the ones below them either
+        if (!valid_slave(data[0] + 1)) {
+            address = 0;
+            return;
+        }
+        address = data[0] + 1;
+        uint8_t announce[2 + 4] = {address, ROUTER_ADDRESS_DISCOVERY};
+        validator_send_frame(UP_LINK, announce, 2);
+        data[0] = address;
+        validator_send_frame(DOWN_LINK, data, size);
+    }
+}
+
+void route_incoming_frame(uint8_t link, uint8_t* data, uint16_t size){
+    uint8_t routing = data[size - 1];
+    if (routing == ROUTER_ADDRESS_DISCOVERY) {
+        discovery_frame_received(link, data, size);
+    }
+    else if (is_master) {
+        if (link == DOWN_LINK && valid_slave(routing)) {
+            transport_recv_frame(routing, data, size - 1);
+        }
+    }
+    else if (link == UP_LINK) {
+        transport_recv_frame(0, data, size - 1);
+    }
+}
+
+void router_send_frame(uint8_t destination, uint8_t* data, uint16_t size) {
+    if (destination == 0) {
+        if (!is_master && address != 0) {
+            data[size] = address;
+            validator_send_frame(UP_LINK, data, size + 1);
+        }
+    }
+    else {
+        if (is_master) {
+            data[size] = destination;
+            validator_send_frame(DOWN_LINK, data, size + 1);
+        }
+    }
+}
+
+#endif
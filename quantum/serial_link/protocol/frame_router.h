@@ -35,4 +35,19 @@ void router_set_master(bool master);
 void route_incoming_frame(uint8_t link, uint8_t* data, uint16_t size);
 void router_send_frame(uint8_t destination, uint8_t* data, uint16_t size);
 
+#ifdef SERIAL_LINK_EXPLICIT_ADDRESSING
+#define ROUTER_ADDRESS_MASTER 0
+#define ROUTER_ADDRESS_DISCOVERY 0xFE
+#define ROUTER_ADDRESS_BROADCAST 0xFF
+
+// Called with the frame including the CRC, before it's validated
+// Returns true if the frame should be validated and routed to this device
+bool router_filter_frame(uint8_t link, uint8_t* data, uint16_t size);
+// Sends a discovery frame, which assigns addresses to the slaves
+void router_start_discovery(void);
+uint8_t router_get_num_slaves(void);
+void router_set_address(uint8_t address);
+uint8_t router_get_address(void);
+#endif
+
 #endif
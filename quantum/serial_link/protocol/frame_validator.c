@@ -25,6 +25,7 @@ SOFTWARE.
 #include "serial_link/protocol/frame_validator.h"
 #include "serial_link/protocol/frame_router.h"
 #include "serial_link/protocol/byte_stuffer.h"
+#include "serial_link/protocol/link_statistics.h"
 #include <string.h>
 
 const uint32_t poly8_lookup[256] =
@@ -104,18 +105,32 @@ static uint32_t crc32_byte(uint8_t *p, uint32_t bytelength)
 }
 
 void validator_recv_frame(uint8_t link, uint8_t* data, uint16_t size) {
+    link_statistics_t* stats = get_link_statistics(link);
     if (size > 4) {
+#ifdef SERIAL_LINK_EXPLICIT_ADDRESSING
+        if (!router_filter_frame(link, data, size)) {
+            return;
+        }
+#endif
         uint32_t frame_crc;
         memcpy(&frame_crc, data + size -4, 4);
         uint32_t expected_crc = crc32_byte(data, size - 4);
         if (frame_crc == expected_crc) {
+            stats->frames_received++;
             route_incoming_frame(link, data, size-4);
         }
+        else {
+            stats->crc_errors++;
+        }
+    }
+    else {
+        stats->invalid_frames++;
     }
 }
 
 void validator_send_frame(uint8_t link, uint8_t* data, uint16_t size) {
     uint32_t crc = crc32_byte(data, size);
     memcpy(data + size, &crc, 4);
+    get_link_statistics(link)->frames_sent++;
     byte_stuffer_send_frame(link, data, size + 4);
 }
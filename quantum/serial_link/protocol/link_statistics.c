@@ -0,0 +1,55 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Fred Sundvik
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "serial_link/protocol/link_statistics.h"
+#include <string.h>
+
+static serial_link_statistics_t statistics;
+static uint32_t frames_at_last_update[NUM_LINKS];
+
+void init_link_statistics(void) {
+    memset(&statistics, 0, sizeof(statistics));
+    memset(frames_at_last_update, 0, sizeof(frames_at_last_update));
+}
+
+link_statistics_t* get_link_statistics(uint8_t link) {
+    return &statistics.links[link];
+}
+
+void get_all_link_statistics(serial_link_statistics_t* s) {
+    memcpy(s, &statistics, sizeof(statistics));
+}
+
+void update_link_statistics_rate(uint32_t elapsed_ms) {
+    if (elapsed_ms == 0) {
+        return;
+    }
+    int i;
+    for (i=0;i<NUM_LINKS;i++) {
+        link_statistics_t* link = &statistics.links[i];
+        uint32_t frames = link->frames_received - frames_at_last_update[i];
+        link->frames_per_second = (frames * 1000 + elapsed_ms / 2) / elapsed_ms;
+        frames_at_last_update[i] = link->frames_received;
+    }
+}
@@ -0,0 +1,64 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Fred Sundvik
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef SERIAL_LINK_LINK_STATISTICS_H
+#define SERIAL_LINK_LINK_STATISTICS_H
+
+#include <stdint.h>
+#include "serial_link/protocol/byte_stuffer.h"
+
+typedef struct {
+    uint32_t bytes_received;
+    uint32_t bytes_sent;
+    uint32_t frames_received;
+    uint32_t frames_sent;
+    // Frames passed through to the next link without being decoded
+    uint32_t frames_forwarded;
+    // Frames that were received, but failed the CRC check
+    uint32_t crc_errors;
+    // Frames with invalid byte stuffing or too short to contain a CRC
+    uint32_t invalid_frames;
+    // Frames that exceeded MAX_FRAME_SIZE and had to be dropped
+    uint32_t oversize_frames;
+    // Errors reported by the serial driver
+    uint32_t parity_errors;
+    uint32_t framing_errors;
+    uint32_t overrun_errors;
+    uint32_t noise_errors;
+    uint32_t breaks_detected;
+    // Valid frames received during the last measurement period
+    uint32_t frames_per_second;
+} link_statistics_t;
+
+typedef struct {
+    link_statistics_t links[NUM_LINKS];
+} serial_link_statistics_t;
+
+void init_link_statistics(void);
+link_statistics_t* get_link_statistics(uint8_t link);
+void get_all_link_statistics(serial_link_statistics_t* statistics);
+// Call this periodically, with the time since the last call, to update the frame rates
+void update_link_statistics_rate(uint32_t elapsed_ms);
+
+#endif
@@ -28,7 +28,10 @@ SOFTWARE.
 #include "serial_link/protocol/triple_buffered_object.h"
 #include "serial_link/system/serial_link.h"
 
+// The maximum number of slaves, this can be reduced in config.h to save memory
+#ifndef NUM_SLAVES
 #define NUM_SLAVES 8
+#endif
 #define LOCAL_OBJECT_EXTRA 16
 
 // master -> slave = 1 local(target all), 1 remote object
@@ -28,6 +28,7 @@ SOFTWARE.
 #include "serial_link/protocol/byte_stuffer.h"
 #include "serial_link/protocol/transport.h"
 #include "serial_link/protocol/frame_router.h"
+#include "serial_link/protocol/link_statistics.h"
 #include "matrix.h"
 #include <stdbool.h>
 #include "print.h"
@@ -36,12 +37,16 @@ SOFTWARE.
 static event_source_t new_data_event;
 static bool serial_link_connected;
 static bool is_master = false;
+// Set by the serial link thread, and consumed by serial_link_update
+static volatile bool remote_data_received = false;
+static volatile bool keepalive_due = true;
 
 static uint8_t keyboard_leds(void);
 static void send_keyboard(report_keyboard_t *report);
 static void send_mouse(report_mouse_t *report);
 static void send_system(uint16_t data);
 static void send_consumer(uint16_t data);
+static void publish_link_statistics(void);
 
 host_driver_t serial_driver = {
   keyboard_leds,
@@ -60,6 +65,12 @@ host_driver_t serial_driver = {
 #error "Serial link thread priority not set"
 #endif
 
+// The matrix is only sent when it changes, but it's also re-sent at this
+// interval in case a frame was lost
+#ifndef SERIAL_LINK_KEEPALIVE_MS
+#define SERIAL_LINK_KEEPALIVE_MS 20
+#endif
+
 static SerialConfig config = {
     .sc_speed = SERIAL_LINK_BAUD
 };
@@ -79,7 +90,23 @@ static uint32_t read_from_serial(SerialDriver* driver, uint8_t link) {
     return bytes_read;
 }
 
-static void print_error(char* str, eventflags_t flags, SerialDriver* driver) {
+static void update_error_statistics(char* str, eventflags_t flags, SerialDriver* driver, uint8_t link) {
+    link_statistics_t* stats = get_link_statistics(link);
+    if (flags & SD_PARITY_ERROR) {
+        stats->parity_errors++;
+    }
+    if (flags & SD_FRAMING_ERROR) {
+        stats->framing_errors++;
+    }
+    if (flags & SD_OVERRUN_ERROR) {
+        stats->overrun_errors++;
+    }
+    if (flags & SD_NOISE_ERROR) {
+        stats->noise_errors++;
+    }
+    if (flags & SD_BREAK_DETECTED) {
+        stats->breaks_detected++;
+    }
 #ifdef DEBUG_LINK_ERRORS
     if (flags & SD_PARITY_ERROR) {
         print(str);
@@ -105,7 +132,6 @@ static void print_error(char* str, eventflags_t flags, SerialDriver* driver) {
     }
 #else
     (void)str;
-    (void)flags;
     (void)driver;
 #endif
 }
@@ -133,28 +159,59 @@ static THD_FUNCTION(serialThread, arg) {
         EVENT_MASK(2),
         events);
     bool need_wait = false;
+    systime_t last_statistics_update = chVTGetSystemTimeX();
+    systime_t last_keepalive = last_statistics_update;
     while(true) {
         eventflags_t flags1 = 0;
         eventflags_t flags2 = 0;
         if (need_wait) {
-            eventmask_t mask = chEvtWaitAnyTimeout(ALL_EVENTS, MS2ST(1000));
+            eventmask_t mask = chEvtWaitAnyTimeout(ALL_EVENTS, MS2ST(SERIAL_LINK_KEEPALIVE_MS));
             if (mask & EVENT_MASK(1)) {
                 flags1 = chEvtGetAndClearFlags(&sd1_listener);
-                print_error("DOWNLINK", flags1, &SD1);
+                update_error_statistics("DOWNLINK", flags1, &SD1, DOWN_LINK);
             }
             if (mask & EVENT_MASK(2)) {
                 flags2 = chEvtGetAndClearFlags(&sd2_listener);
-                print_error("UPLINK", flags2, &SD2);
+                update_error_statistics("UPLINK", flags2, &SD2, UP_LINK);
             }
         }
 
+#ifdef SERIAL_LINK_EXPLICIT_ADDRESSING
+        bool was_master = is_master;
+#endif
         // Always stay as master, even if the USB goes into sleep mode
         is_master |= usbGetDriverStateI(&USBD1) == USB_ACTIVE;
         router_set_master(is_master);
+#ifdef SERIAL_LINK_EXPLICIT_ADDRESSING
+        if (is_master && !was_master) {
+            router_start_discovery();
+        }
+#endif
 
         need_wait = true;
         need_wait &= read_from_serial(&SD2, UP_LINK) == 0;
         need_wait &= read_from_serial(&SD1, DOWN_LINK) == 0;
+        if (!need_wait) {
+            remote_data_received = true;
+        }
+
+        systime_t current_time = chVTGetSystemTimeX();
+        if (current_time - last_keepalive >= MS2ST(SERIAL_LINK_KEEPALIVE_MS)) {
+            last_keepalive = current_time;
+            keepalive_due = true;
+        }
+
+        systime_t statistics_delta = current_time - last_statistics_update;
+        if (statistics_delta >= MS2ST(1000)) {
+            last_statistics_update += statistics_delta;
+            update_link_statistics_rate(ST2MS(statistics_delta));
+            publish_link_statistics();
+#ifdef SERIAL_LINK_EXPLICIT_ADDRESSING
+            // Discover the chain again, in case slaves have been connected or removed
+            router_start_discovery();
+#endif
+        }
+
         update_transport();
     }
 }
@@ -168,25 +225,81 @@ void send_data(uint8_t link, const uint8_t* data, uint16_t size) {
     }
 }
 
-static systime_t last_update = 0;
-
 typedef struct {
     matrix_row_t rows[MATRIX_ROWS];
 } matrix_object_t;
 
-static matrix_object_t last_matrix = {};
-
 SLAVE_TO_MASTER_OBJECT(keyboard_matrix, matrix_object_t);
 MASTER_TO_ALL_SLAVES_OBJECT(serial_link_connected, bool);
+SLAVE_TO_MASTER_OBJECT(link_statistics, serial_link_statistics_t);
 
 static remote_object_t* remote_objects[] = {
     REMOTE_OBJECT(serial_link_connected),
     REMOTE_OBJECT(keyboard_matrix),
+    REMOTE_OBJECT(link_statistics),
 };
 
+static serial_link_statistics_t remote_statistics[NUM_SLAVES];
+
+static void publish_link_statistics(void) {
+    if (!is_master) {
+        serial_link_statistics_t* s = begin_write_link_statistics();
+        get_all_link_statistics(s);
+        end_write_link_statistics();
+    }
+}
+
+const serial_link_statistics_t* get_remote_link_statistics(uint8_t slave) {
+    if (slave >= NUM_SLAVES) {
+        return NULL;
+    }
+    serial_link_statistics_t* s = read_link_statistics(slave);
+    if (s) {
+        remote_statistics[slave] = *s;
+    }
+    return &remote_statistics[slave];
+}
+
+static void print_link_statistics(const link_statistics_t* s) {
+    xprintf("  rx: %lu bytes, %lu frames, %lu frames/s\n",
+        s->bytes_received, s->frames_received, s->frames_per_second);
+    xprintf("  tx: %lu bytes, %lu frames, %lu forwarded\n",
+        s->bytes_sent, s->frames_sent, s->frames_forwarded);
+    xprintf("  crc: %lu, invalid: %lu, oversize: %lu\n",
+        s->crc_errors, s->invalid_frames, s->oversize_frames);
+    xprintf("  parity: %lu, framing: %lu, overrun: %lu, noise: %lu, break: %lu\n",
+        s->parity_errors, s->framing_errors, s->overrun_errors, s->noise_errors, s->breaks_detected);
+}
+
+static void print_all_link_statistics(const serial_link_statistics_t* s) {
+    print(" UPLINK\n");
+    print_link_statistics(&s->links[UP_LINK]);
+    print(" DOWNLINK\n");
+    print_link_statistics(&s->links[DOWN_LINK]);
+}
+
+void serial_link_print_statistics(void) {
+    serial_link_statistics_t local;
+    get_all_link_statistics(&local);
+    print("Serial link statistics\n");
+    print("local:\n");
+    print_all_link_statistics(&local);
+    if (is_master) {
+        uint8_t i;
+        for (i=0;i<NUM_SLAVES;i++) {
+            const serial_link_statistics_t* remote = get_remote_link_statistics(i);
+            if (remote->links[UP_LINK].frames_received > 0) {
+                xprintf("slave %d:\n", i + 1);
+                print_all_link_statistics(remote);
+            }
+        }
+    }
+}
+
 void init_serial_link(void) {
     serial_link_connected = false;
     init_serial_link_hal();
+    init_link_statistics();
     add_remote_objects(remote_objects, sizeof(remote_objects)/sizeof(remote_object_t*));
     init_byte_stuffer();
     sdStart(&SD1, &config);
@@ -198,35 +311,40 @@ void init_serial_link(void) {
 
 void matrix_set_remote(matrix_row_t* rows, uint8_t index);
 
-void serial_link_update(void) {
-    if (read_serial_link_connected()) {
-        serial_link_connected = true;
+static void write_matrix(void) {
+    matrix_object_t* m = begin_write_keyboard_matrix();
+    for(uint8_t i=0;i<MATRIX_ROWS;i++) {
+        m->rows[i] = matrix_get_row(i);
     }
+    end_write_keyboard_matrix();
+}
 
-    matrix_object_t matrix;
-    bool changed = false;
-    for(uint8_t i=0;i<MATRIX_ROWS;i++) {
-        matrix.rows[i] = matrix_get_row(i);
-        changed |= matrix.rows[i] != last_matrix.rows[i];
+void serial_link_matrix_changed(void) {
+    write_matrix();
+}
+
+void serial_link_update(void) {
+    // Nothing to do for most of the scans, so return as quickly as possible
+    if (!remote_data_received && !keepalive_due) {
+        return;
     }
 
-    systime_t current_time = chVTGetSystemTimeX();
-    systime_t delta = current_time - last_update;
-    if (changed || delta > US2ST(1000)) {
-        last_update = current_time;
-        last_matrix = matrix;
-        matrix_object_t* m = begin_write_keyboard_matrix();
-        for(uint8_t i=0;i<MATRIX_ROWS;i++) {
-            m->rows[i] = matrix.rows[i];
-        }
-        end_write_keyboard_matrix();
+    if (keepalive_due) {
+        keepalive_due = false;
+        write_matrix();
         *begin_write_serial_link_connected() = true;
         end_write_serial_link_connected();
     }
 
-    matrix_object_t* m = read_keyboard_matrix(0);
-    if (m) {
-        matrix_set_remote(m->rows, 0);
+    if (remote_data_received) {
+        remote_data_received = false;
+        if (read_serial_link_connected()) {
+            serial_link_connected = true;
+        }
+        matrix_object_t* m = read_keyboard_matrix(0);
+        if (m) {
+            matrix_set_remote(m->rows, 0);
+        }
     }
 }
 
@@ -27,6 +27,7 @@ SOFTWARE.
 
 #include "host_driver.h"
 #include <stdbool.h>
+#include "serial_link/protocol/link_statistics.h"
 
 void init_serial_link(void);
 void init_serial_link_hal(void);
@@ -34,6 +35,11 @@ bool is_serial_link_connected(void);
 bool is_serial_link_master(void);
 host_driver_t* get_serial_link_driver(void);
 void serial_link_update(void);
+// Call this from the matrix scan when the debounced local matrix changes
+void serial_link_matrix_changed(void);
+// Returns the last statistics received from the slave, only valid on the master
+const serial_link_statistics_t* get_remote_link_statistics(uint8_t slave);
+void serial_link_print_statistics(void);
 
 #if defined(PROTOCOL_CHIBIOS)
 #include "ch.h"
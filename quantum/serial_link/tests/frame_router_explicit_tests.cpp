@@ -0,0 +1,278 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Fred Sundvik
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include <array>
+#include <vector>
+extern "C" {
+    #include "serial_link/protocol/transport.h"
+    #include "serial_link/protocol/byte_stuffer.h"
+    #include "serial_link/protocol/frame_router.h"
+    #include "serial_link/protocol/link_statistics.h"
+}
+
+using testing::ElementsAreArray;
+
+// Simulates a chain of a master and GetParam() slaves
+class FrameRouterExplicit : public testing::TestWithParam<int> {
+public:
+    FrameRouterExplicit() :
+        current_router(0)
+    {
+        Instance = this;
+        init_byte_stuffer();
+        init_link_statistics();
+        for (auto& r : routers) {
+            r.address = 0;
+        }
+        activate_router(0);
+        router_start_discovery();
+        run();
+        reset();
+    }
+
+    ~FrameRouterExplicit() {
+        Instance = nullptr;
+    }
+
+    void send_data(uint8_t link, const uint8_t* data, uint16_t size) {
+        auto& r = routers[current_router];
+        std::copy(data, data + size, std::back_inserter(r.send_buffers[link]));
+        std::copy(data, data + size, std::back_inserter(r.sent_history[link]));
+    }
+
+    void transport_recv_frame(uint8_t from, uint8_t* data, uint16_t size) {
+        received_frame f;
+        f.receiver = current_router;
+        f.from = from;
+        f.data.assign(data, data + size);
+        received.push_back(f);
+    }
+
+    int num_slaves() {
+        return GetParam();
+    }
+
+    void activate_router(uint8_t num) {
+        routers[current_router].address = router_get_address();
+        current_router = num;
+        router_set_master(num == 0);
+        router_set_address(routers[num].address);
+    }
+
+    void deliver(uint8_t from, uint8_t link) {
+        std::vector<uint8_t> data;
+        data.swap(routers[from].send_buffers[link]);
+        int to = link == DOWN_LINK ? from + 1 : from - 1;
+        if (to < 0 || to > num_slaves()) {
+            return;
+        }
+        uint8_t receive_link = link == DOWN_LINK ? UP_LINK : DOWN_LINK;
+        activate_router(to);
+        uint32_t validated = get_link_statistics(receive_link)->frames_received;
+        for (auto d : data) {
+            byte_stuffer_recv_byte(receive_link, d);
+        }
+        routers[to].validated += get_link_statistics(receive_link)->frames_received - validated;
+    }
+
+    void run() {
+        bool sent = true;
+        while (sent) {
+            sent = false;
+            for (int i=0;i<=num_slaves();i++) {
+                for (uint8_t link=0;link<NUM_LINKS;link++) {
+                    if (routers[i].send_buffers[link].size() > 0) {
+                        deliver(i, link);
+                        sent = true;
+                    }
+                }
+            }
+        }
+    }
+
+    void reset() {
+        for (auto& r : routers) {
+            r.sent_history[UP_LINK].clear();
+            r.sent_history[DOWN_LINK].clear();
+            r.validated = 0;
+        }
+        received.clear();
+    }
+
+    struct router_state {
+        std::vector<uint8_t> send_buffers[NUM_LINKS];
+        std::vector<uint8_t> sent_history[NUM_LINKS];
+        uint8_t address;
+        uint32_t validated;
+    };
+
+    struct received_frame {
+        int receiver;
+        uint8_t from;
+        std::vector<uint8_t> data;
+    };
+
+    router_state routers[9];
+    int current_router;
+    std::vector<received_frame> received;
+
+    static FrameRouterExplicit* Instance;
+};
+
+FrameRouterExplicit* FrameRouterExplicit::Instance = nullptr;
+
+typedef struct {
+    std::array<uint8_t, 4> data;
+    uint8_t extra[16];
+} frame_buffer_t;
+
+extern "C" {
+    void send_data(uint8_t link, const uint8_t* data, uint16_t size) {
+        FrameRouterExplicit::Instance->send_data(link, data, size);
+    }
+
+    void transport_recv_frame(uint8_t from, uint8_t* data, uint16_t size) {
+        FrameRouterExplicit::Instance->transport_recv_frame(from, data, size);
+    }
+}
+
+TEST_P(FrameRouterExplicit, discovery_assigns_addresses_and_counts_the_slaves) {
+    activate_router(0);
+    EXPECT_EQ(router_get_num_slaves(), num_slaves());
+    for (int i=1;i<=num_slaves();i++) {
+        EXPECT_EQ(routers[i].address, i);
+    }
+    EXPECT_EQ(received.size(), 0);
+}
+
+TEST_P(FrameRouterExplicit, discovery_forgets_removed_slaves) {
+    activate_router(0);
+    router_start_discovery();
+    // Nobody answers
+    routers[0].send_buffers[DOWN_LINK].clear();
+    router_start_discovery();
+    EXPECT_EQ(router_get_num_slaves(), 0);
+}
+
+TEST_P(FrameRouterExplicit, master_send_is_received_only_by_the_target) {
+    frame_buffer_t data;
+    data.data = {0xAB, 0x70, 0x55, 0xBB};
+    for (int target=1;target<=num_slaves();target++) {
+        reset();
+        activate_router(0);
+        router_send_frame(target, (uint8_t*)&data, 4);
+        run();
+        ASSERT_EQ(received.size(), 1);
+        EXPECT_EQ(received[0].receiver, target);
+        EXPECT_EQ(received[0].from, 0);
+        EXPECT_THAT(received[0].data, ElementsAreArray(data.data));
+        for (int i=1;i<=num_slaves();i++) {
+            EXPECT_EQ(routers[i].validated, i == target ? 1 : 0);
+        }
+    }
+}
+
+TEST_P(FrameRouterExplicit, intermediate_slaves_forward_frames_unmodified) {
+    frame_buffer_t data;
+    data.data = {0x00, 0x70, 0x00, 0xBB};
+    activate_router(0);
+    router_send_frame(num_slaves(), (uint8_t*)&data, 4);
+    run();
+    for (int i=1;i<num_slaves();i++) {
+        EXPECT_EQ(routers[i].sent_history[DOWN_LINK], routers[0].sent_history[DOWN_LINK]);
+        EXPECT_EQ(routers[i].sent_history[UP_LINK].size(), 0);
+    }
+}
+
+TEST_P(FrameRouterExplicit, master_broadcast_is_received_by_everyone) {
+    frame_buffer_t data;
+    data.data = {0xAB, 0x70, 0x55, 0xBB};
+    activate_router(0);
+    router_send_frame(ROUTER_ADDRESS_BROADCAST, (uint8_t*)&data, 4);
+    run();
+    ASSERT_EQ(received.size(), num_slaves());
+    for (int i=0;i<num_slaves();i++) {
+        EXPECT_EQ(received[i].receiver, i + 1);
+        EXPECT_EQ(received[i].from, 0);
+        EXPECT_THAT(received[i].data, ElementsAreArray(data.data));
+    }
+}
+
+TEST_P(FrameRouterExplicit, every_slave_sends_to_master) {
+    frame_buffer_t data;
+    data.data = {0xAB, 0x70, 0x55, 0xBB};
+    for (int source=1;source<=num_slaves();source++) {
+        reset();
+        activate_router(source);
+        router_send_frame(0, (uint8_t*)&data, 4);
+        run();
+        ASSERT_EQ(received.size(), 1);
+        EXPECT_EQ(received[0].receiver, 0);
+        EXPECT_EQ(received[0].from, source);
+        EXPECT_THAT(received[0].data, ElementsAreArray(data.data));
+        for (int i=1;i<source;i++) {
+            EXPECT_EQ(routers[i].validated, 0);
+            EXPECT_EQ(routers[i].sent_history[UP_LINK], routers[source].sent_history[UP_LINK]);
+        }
+    }
+}
+
+TEST_P(FrameRouterExplicit, slave_without_address_does_not_send) {
+    frame_buffer_t data;
+    data.data = {0xAB, 0x70, 0x55, 0xBB};
+    activate_router(1);
+    router_set_address(0);
+    router_send_frame(0, (uint8_t*)&data, 4);
+    EXPECT_EQ(routers[1].send_buffers[UP_LINK].size(), 0);
+}
+
+TEST_P(FrameRouterExplicit, master_drops_frames_from_addresses_out_of_range) {
+    activate_router(0);
+    for (uint8_t from : {0, NUM_SLAVES + 1, ROUTER_ADDRESS_BROADCAST}) {
+        uint8_t frame[] = {0xAB, 0x70, 0x55, 0xBB, from};
+        route_incoming_frame(DOWN_LINK, frame, sizeof(frame));
+    }
+    EXPECT_EQ(received.size(), 0);
+}
+
+TEST_P(FrameRouterExplicit, master_ignores_slaves_announced_past_num_slaves) {
+    activate_router(0);
+    uint8_t announce[] = {NUM_SLAVES + 1, ROUTER_ADDRESS_DISCOVERY};
+    route_incoming_frame(DOWN_LINK, announce, sizeof(announce));
+    router_start_discovery();
+    EXPECT_EQ(router_get_num_slaves(), num_slaves());
+}
+
+TEST_P(FrameRouterExplicit, slaves_past_num_slaves_take_no_address) {
+    activate_router(1);
+    uint8_t discovery[] = {NUM_SLAVES, ROUTER_ADDRESS_DISCOVERY};
+    route_incoming_frame(UP_LINK, discovery, sizeof(discovery));
+    EXPECT_EQ(router_get_address(), 0);
+    EXPECT_EQ(routers[1].send_buffers[UP_LINK].size(), 0);
+    EXPECT_EQ(routers[1].send_buffers[DOWN_LINK].size(), 0);
+}
+
+INSTANTIATE_TEST_CASE_P(OneToEightSlaves, FrameRouterExplicit, testing::Range(1, 9));
@@ -227,3 +227,13 @@ TEST_F(FrameRouter, master_receives_on_uplink_does_nothing) {
     EXPECT_EQ(router_buffers[0].send_buffers[UP_LINK].size(), 0);
     EXPECT_EQ(router_buffers[0].send_buffers[DOWN_LINK].size(), 0);
 }
+
+TEST_F(FrameRouter, master_drops_frames_from_hops_out_of_range) {
+    EXPECT_CALL(*this, transport_recv_frame(_, _, _))
+        .Times(0);
+    activate_router(0);
+    for (uint8_t hops : {0, NUM_SLAVES + 1}) {
+        uint8_t frame[] = {0xAB, 0x70, 0x55, 0xBB, hops};
+        route_incoming_frame(DOWN_LINK, frame, sizeof(frame));
+    }
+}
@@ -0,0 +1,150 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Fred Sundvik
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include <vector>
+extern "C" {
+#include "serial_link/protocol/byte_stuffer.h"
+#include "serial_link/protocol/frame_validator.h"
+#include "serial_link/protocol/frame_router.h"
+#include "serial_link/protocol/link_statistics.h"
+#include "serial_link/protocol/physical.h"
+}
+
+using testing::_;
+
+class LinkStatistics : public testing::Test {
+public:
+    LinkStatistics() {
+        Instance = this;
+        init_byte_stuffer();
+        init_link_statistics();
+    }
+
+    ~LinkStatistics() {
+        Instance = nullptr;
+    }
+
+    MOCK_METHOD3(route_incoming_frame, void (uint8_t link, uint8_t* data, uint16_t size));
+
+    void send_data(uint8_t link, const uint8_t* data, uint16_t size) {
+        std::copy(data, data + size, std::back_inserter(sent_data));
+    }
+
+    void receive_sent_data(uint8_t link) {
+        for (auto& d : sent_data) {
+            byte_stuffer_recv_byte(link, d);
+        }
+    }
+
+    std::vector<uint8_t> sent_data;
+
+    static LinkStatistics* Instance;
+};
+
+LinkStatistics* LinkStatistics::Instance = nullptr;
+
+extern "C" {
+    void route_incoming_frame(uint8_t link, uint8_t* data, uint16_t size) {
+        LinkStatistics::Instance->route_incoming_frame(link, data, size);
+    }
+
+    void send_data(uint8_t link, const uint8_t* data, uint16_t size) {
+        LinkStatistics::Instance->send_data(link, data, size);
+    }
+}
+
+TEST_F(LinkStatistics, starts_with_everything_cleared) {
+    link_statistics_t* s = get_link_statistics(UP_LINK);
+    EXPECT_EQ(s->bytes_received, 0);
+    EXPECT_EQ(s->frames_received, 0);
+    EXPECT_EQ(s->crc_errors, 0);
+    EXPECT_EQ(s->oversize_frames, 0);
+}
+
+TEST_F(LinkStatistics, counts_sent_and_received_frames_and_bytes) {
+    uint8_t data[] = {1, 2, 0, 4, 0, 0, 0, 0};
+    validator_send_frame(DOWN_LINK, data, 4);
+    EXPECT_EQ(get_link_statistics(DOWN_LINK)->frames_sent, 1);
+    EXPECT_EQ(get_link_statistics(DOWN_LINK)->bytes_sent, sent_data.size());
+    EXPECT_CALL(*this, route_incoming_frame(UP_LINK, _, 4));
+    receive_sent_data(UP_LINK);
+    link_statistics_t* s = get_link_statistics(UP_LINK);
+    EXPECT_EQ(s->frames_received, 1);
+    EXPECT_EQ(s->bytes_received, sent_data.size());
+    EXPECT_EQ(s->crc_errors, 0);
+    EXPECT_EQ(s->invalid_frames, 0);
+    EXPECT_EQ(get_link_statistics(DOWN_LINK)->frames_received, 0);
+}
+
+TEST_F(LinkStatistics, counts_crc_errors) {
+    uint8_t data[] = {1, 2, 3, 4, 0, 0, 0, 0};
+    validator_send_frame(DOWN_LINK, data, 4);
+    sent_data[2] ^= 0x10;
+    EXPECT_CALL(*this, route_incoming_frame(_, _, _))
+        .Times(0);
+    receive_sent_data(UP_LINK);
+    EXPECT_EQ(get_link_statistics(UP_LINK)->crc_errors, 1);
+    EXPECT_EQ(get_link_statistics(UP_LINK)->frames_received, 0);
+}
+
+TEST_F(LinkStatistics, counts_frames_that_are_too_short_as_invalid) {
+    uint8_t data[] = {1, 2, 3};
+    validator_recv_frame(UP_LINK, data, 3);
+    EXPECT_EQ(get_link_statistics(UP_LINK)->invalid_frames, 1);
+    EXPECT_EQ(get_link_statistics(UP_LINK)->crc_errors, 0);
+}
+
+TEST_F(LinkStatistics, counts_invalid_byte_stuffing) {
+    byte_stuffer_recv_byte(UP_LINK, 3);
+    byte_stuffer_recv_byte(UP_LINK, 1);
+    byte_stuffer_recv_byte(UP_LINK, 0);
+    EXPECT_EQ(get_link_statistics(UP_LINK)->invalid_frames, 1);
+}
+
+TEST_F(LinkStatistics, counts_oversize_frames) {
+    EXPECT_CALL(*this, route_incoming_frame(_, _, _))
+        .Times(0);
+    int i;
+    for (i=0;i<MAX_FRAME_SIZE + 10;i++) {
+        byte_stuffer_recv_byte(DOWN_LINK, 0xFF);
+    }
+    EXPECT_EQ(get_link_statistics(DOWN_LINK)->oversize_frames, 1);
+}
+
+TEST_F(LinkStatistics, calculates_frames_per_second) {
+    uint8_t data[] = {1, 2, 3, 4, 0, 0, 0, 0};
+    validator_send_frame(DOWN_LINK, data, 4);
+    EXPECT_CALL(*this, route_incoming_frame(_, _, _))
+        .Times(10);
+    for (int i=0;i<10;i++) {
+        receive_sent_data(UP_LINK);
+    }
+    update_link_statistics_rate(500);
+    EXPECT_EQ(get_link_statistics(UP_LINK)->frames_per_second, 20);
+    EXPECT_EQ(get_link_statistics(DOWN_LINK)->frames_per_second, 0);
+    update_link_statistics_rate(1000);
+    EXPECT_EQ(get_link_statistics(UP_LINK)->frames_per_second, 0);
+}
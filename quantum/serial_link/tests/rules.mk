@@ -1,16 +1,34 @@
 serial_link_byte_stuffer_SRC :=\
 	$(SERIAL_PATH)/tests/byte_stuffer_tests.cpp \
-	$(SERIAL_PATH)/protocol/byte_stuffer.c
+	$(SERIAL_PATH)/protocol/byte_stuffer.c \
+	$(SERIAL_PATH)/protocol/link_statistics.c
 
 serial_link_frame_validator_SRC := \
 	$(SERIAL_PATH)/tests/frame_validator_tests.cpp \
-	$(SERIAL_PATH)/protocol/frame_validator.c 
+	$(SERIAL_PATH)/protocol/frame_validator.c \
+	$(SERIAL_PATH)/protocol/link_statistics.c
 
 serial_link_frame_router_SRC := \
 	$(SERIAL_PATH)/tests/frame_router_tests.cpp \
 	$(SERIAL_PATH)/protocol/byte_stuffer.c \
 	$(SERIAL_PATH)/protocol/frame_validator.c \
-	$(SERIAL_PATH)/protocol/frame_router.c
+	$(SERIAL_PATH)/protocol/frame_router.c \
+	$(SERIAL_PATH)/protocol/link_statistics.c
+
+serial_link_frame_router_explicit_SRC := \
+	$(SERIAL_PATH)/tests/frame_router_explicit_tests.cpp \
+	$(SERIAL_PATH)/protocol/byte_stuffer.c \
+	$(SERIAL_PATH)/protocol/frame_validator.c \
+	$(SERIAL_PATH)/protocol/frame_router.c \
+	$(SERIAL_PATH)/protocol/link_statistics.c
+
+serial_link_frame_router_explicit_DEFS := -DSERIAL_LINK_EXPLICIT_ADDRESSING
+
+serial_link_link_statistics_SRC := \
+	$(SERIAL_PATH)/tests/link_statistics_tests.cpp \
+	$(SERIAL_PATH)/protocol/byte_stuffer.c \
+	$(SERIAL_PATH)/protocol/frame_validator.c \
+	$(SERIAL_PATH)/protocol/link_statistics.c
 
 serial_link_triple_buffered_object_SRC := \
 	$(SERIAL_PATH)/tests/triple_buffered_object_tests.cpp \
@@ -2,5 +2,7 @@ TEST_LIST +=\
 	serial_link_byte_stuffer\
 	serial_link_frame_validator\
 	serial_link_frame_router\
+	serial_link_frame_router_explicit\
+	serial_link_link_statistics\
 	serial_link_triple_buffered_object\
 	serial_link_transport
\ No newline at end of file
@@ -0,0 +1,100 @@
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <cstdlib>
+extern "C" {
+#include "color.h"
+}
+
+// The conversion rgblight used before, with two divisions per LED
+static void reference_hsv_to_rgb(uint16_t hue, uint8_t sat, uint8_t val, uint8_t* r, uint8_t* g, uint8_t* b) {
+    uint8_t base, color;
+
+    val = DIM_CURVE[val];
+    sat = 255 - DIM_CURVE[255 - sat];
+    *r = *g = *b = 0;
+
+    if (sat == 0) {
+        *r = val;
+        *g = val;
+        *b = val;
+        return;
+    }
+    base = ((255 - sat) * val) >> 8;
+    color = (val - base) * (hue % 60) / 60;
+
+    switch (hue / 60) {
+        case 0: *r = val;          *g = base + color; *b = base;         break;
+        case 1: *r = val - color;  *g = val;          *b = base;         break;
+        case 2: *r = base;         *g = val;          *b = base + color; break;
+        case 3: *r = base;         *g = val - color;  *b = val;          break;
+        case 4: *r = base + color; *g = base;         *b = val;          break;
+        case 5: *r = val;          *g = base;         *b = val - color;  break;
+    }
+}
+
+TEST(Color, whole_sextants_map_exactly_onto_the_wheel) {
+    for (int sextant = 0; sextant < 6; sextant++) {
+        EXPECT_EQ(hsv_hue_to_wheel(sextant * 60), sextant * 256);
+    }
+    for (int hue = 0; hue < 360; hue++) {
+        EXPECT_LT(hsv_hue_to_wheel(hue), HSV_WHEEL_SIZE);
+        if (hue > 0) {
+            EXPECT_GT(hsv_hue_to_wheel(hue), hsv_hue_to_wheel(hue - 1));
+        }
+    }
+}
+
+TEST(Color, differs_from_the_division_by_at_most_one) {
+    int max_error = 0;
+    int num_differences = 0;
+    for (int hue = 0; hue < 360; hue++) {
+        for (int sat = 0; sat < 256; sat++) {
+            for (int val = 0; val < 256; val++) {
+                uint8_t r, g, b, ref_r, ref_g, ref_b;
+                hsv_to_rgb(hue, sat, val, &r, &g, &b);
+                reference_hsv_to_rgb(hue, sat, val, &ref_r, &ref_g, &ref_b);
+                int error = std::max(std::abs(r - ref_r), std::max(std::abs(g - ref_g), std::abs(b - ref_b)));
+                max_error = std::max(max_error, error);
+                num_differences += error != 0;
+            }
+        }
+    }
+    printf("max error %d, %d of %d colors differ\n", max_error, num_differences, 360 * 256 * 256);
+    EXPECT_LE(max_error, 1);
+}
+
+TEST(Color, grays_and_sextant_starts_are_exact) {
+    for (int val = 0; val < 256; val++) {
+        for (int hue = 0; hue < 360; hue += 60) {
+            for (int sat = 0; sat < 256; sat += 51) {
+                uint8_t r, g, b, ref_r, ref_g, ref_b;
+                hsv_to_rgb(hue, sat, val, &r, &g, &b);
+                reference_hsv_to_rgb(hue, sat, val, &ref_r, &ref_g, &ref_b);
+                EXPECT_EQ(r, ref_r);
+                EXPECT_EQ(g, ref_g);
+                EXPECT_EQ(b, ref_b);
+            }
+        }
+    }
+}
+
+// A strip like sethsv_range(), with the level computed once, wrapping the hue
+TEST(Color, a_strip_matches_converting_each_led) {
+    const int num_leds = 16;
+    for (int start_hue = 0; start_hue < 360; start_hue++) {
+        hsv_level_t level = hsv_level(200, 200);
+        uint16_t hue = start_hue;
+        for (int i = 0; i < num_leds; i++) {
+            uint8_t r, g, b, ref_r, ref_g, ref_b;
+            hsv_wheel_to_rgb(hsv_hue_to_wheel(hue), level, &r, &g, &b);
+            hsv_to_rgb((start_hue + 360 / num_leds * i) % 360, 200, 200, &ref_r, &ref_g, &ref_b);
+            ASSERT_EQ(r, ref_r);
+            ASSERT_EQ(g, ref_g);
+            ASSERT_EQ(b, ref_b);
+            hue += 360 / num_leds;
+            if (hue >= 360) {
+                hue -= 360;
+            }
+        }
+    }
+}
@@ -0,0 +1,225 @@
+#include "gtest/gtest.h"
+#include <cstdint>
+extern "C" {
+#include "dynamic_keymap.h"
+}
+
+static const int EEPROM_SIZE = 2048;
+
+class DynamicKeymap : public testing::Test {
+public:
+    DynamicKeymap() {
+        Instance = this;
+        for (int i = 0; i < EEPROM_SIZE; i++) {
+            eeprom[i] = 0xFF;
+        }
+        num_writes = 0;
+        dynamic_keymap_init();
+    }
+
+    ~DynamicKeymap() {
+        Instance = nullptr;
+    }
+
+    uint8_t read(uintptr_t addr) {
+        EXPECT_LT(addr, EEPROM_SIZE);
+        return eeprom[addr];
+    }
+
+    void update(uintptr_t addr, uint8_t value) {
+        EXPECT_LT(addr, EEPROM_SIZE);
+        if (eeprom[addr] != value) {
+            eeprom[addr] = value;
+            num_writes++;
+        }
+    }
+
+    static keypos_t key(uint8_t row, uint8_t col) {
+        keypos_t k;
+        k.row = row;
+        k.col = col;
+        return k;
+    }
+
+    bool lookup(uint8_t layer, uint8_t row, uint8_t col, uint16_t* keycode) {
+        return dynamic_keymap_lookup(layer, key(row, col), keycode);
+    }
+
+    uint8_t eeprom[EEPROM_SIZE];
+    int num_writes;
+    static DynamicKeymap* Instance;
+};
+
+DynamicKeymap* DynamicKeymap::Instance = nullptr;
+
+extern "C" {
+uint8_t eeprom_read_byte(const uint8_t* addr) {
+    return DynamicKeymap::Instance->read((uintptr_t)addr);
+}
+
+void eeprom_update_byte(uint8_t* addr, uint8_t value) {
+    DynamicKeymap::Instance->update((uintptr_t)addr, value);
+}
+}
+
+TEST_F(DynamicKeymap, an_erased_eeprom_has_no_entries) {
+    uint16_t keycode;
+    EXPECT_EQ(dynamic_keymap_count(), 0);
+    EXPECT_FALSE(lookup(0, 0, 0, &keycode));
+    EXPECT_FALSE(lookup(3, 3, 7, &keycode));
+}
+
+TEST_F(DynamicKeymap, an_entry_overrides_only_its_key_and_layer) {
+    uint16_t keycode = 0;
+    EXPECT_TRUE(dynamic_keymap_set(1, key(2, 3), 0x1234));
+    EXPECT_TRUE(lookup(1, 2, 3, &keycode));
+    EXPECT_EQ(keycode, 0x1234);
+    EXPECT_FALSE(lookup(0, 2, 3, &keycode));
+    EXPECT_FALSE(lookup(2, 2, 3, &keycode));
+    EXPECT_FALSE(lookup(1, 2, 4, &keycode));
+    EXPECT_FALSE(lookup(1, 3, 3, &keycode));
+}
+
+TEST_F(DynamicKeymap, setting_an_entry_again_replaces_it) {
+    uint16_t keycode = 0;
+    EXPECT_TRUE(dynamic_keymap_set(0, key(1, 1), 0x0004));
+    EXPECT_TRUE(dynamic_keymap_set(0, key(1, 1), 0x0005));
+    EXPECT_EQ(dynamic_keymap_count(), 1);
+    EXPECT_TRUE(lookup(0, 1, 1, &keycode));
+    EXPECT_EQ(keycode, 0x0005);
+}
+
+TEST_F(DynamicKeymap, entries_are_loaded_from_the_eeprom) {
+    dynamic_keymap_set(0, key(0, 0), 0x0029);
+    dynamic_keymap_set(4, key(3, 7), 0x5C00);
+    dynamic_keymap_init();
+    uint16_t keycode = 0;
+    EXPECT_EQ(dynamic_keymap_count(), 2);
+    EXPECT_TRUE(lookup(0, 0, 0, &keycode));
+    EXPECT_EQ(keycode, 0x0029);
+    EXPECT_TRUE(lookup(4, 3, 7, &keycode));
+    EXPECT_EQ(keycode, 0x5C00);
+}
+
+TEST_F(DynamicKeymap, uses_the_documented_eeprom_layout) {
+    dynamic_keymap_set(2, key(3, 5), 0xABCD);
+    uint8_t* p = eeprom + DYNAMIC_KEYMAP_EEPROM_ADDR;
+    EXPECT_EQ(p[0], 1);
+    EXPECT_EQ(p[1], 2);
+    EXPECT_EQ(p[2], 3);
+    EXPECT_EQ(p[3], 5);
+    EXPECT_EQ(p[4], 0xCD);
+    EXPECT_EQ(p[5], 0xAB);
+}
+
+TEST_F(DynamicKeymap, an_invalid_count_is_treated_as_empty) {
+    eeprom[DYNAMIC_KEYMAP_EEPROM_ADDR] = DYNAMIC_KEYMAP_MAX_ENTRIES + 1;
+    dynamic_keymap_init();
+    EXPECT_EQ(dynamic_keymap_count(), 0);
+}
+
+TEST_F(DynamicKeymap, entries_outside_the_matrix_are_rejected) {
+    EXPECT_FALSE(dynamic_keymap_set(0, key(MATRIX_ROWS, 0), 0x0004));
+    EXPECT_FALSE(dynamic_keymap_set(0, key(0, MATRIX_COLS), 0x0004));
+    EXPECT_FALSE(dynamic_keymap_set(32, key(0, 0), 0x0004));
+    EXPECT_EQ(dynamic_keymap_count(), 0);
+    EXPECT_EQ(num_writes, 0);
+}
+
+TEST_F(DynamicKeymap, stops_accepting_entries_when_full) {
+    for (int i = 0; i < DYNAMIC_KEYMAP_MAX_ENTRIES; i++) {
+        EXPECT_TRUE(dynamic_keymap_set(i / (MATRIX_ROWS * MATRIX_COLS), key((i / MATRIX_COLS) % MATRIX_ROWS, i % MATRIX_COLS), 0x100 + i));
+    }
+    EXPECT_EQ(dynamic_keymap_count(), DYNAMIC_KEYMAP_MAX_ENTRIES);
+    int writes = num_writes;
+    EXPECT_FALSE(dynamic_keymap_set(31, key(3, 7), 0x0004));
+    EXPECT_EQ(num_writes, writes);
+    // Existing entries can still be changed
+    EXPECT_TRUE(dynamic_keymap_set(0, key(0, 0), 0x0004));
+    for (int i = 1; i < DYNAMIC_KEYMAP_MAX_ENTRIES; i++) {
+        uint16_t keycode = 0;
+        EXPECT_TRUE(lookup(i / (MATRIX_ROWS * MATRIX_COLS), (i / MATRIX_COLS) % MATRIX_ROWS, i % MATRIX_COLS, &keycode));
+        EXPECT_EQ(keycode, 0x100 + i);
+    }
+}
+
+// The entries take a layer or a column each, there are only so many
+#if DYNAMIC_KEYMAP_MAX_ENTRIES <= 16
+TEST_F(DynamicKeymap, every_key_of_a_full_overlay_is_found) {
+    // Same row and column on every layer, and every column of a row,
+    // so that the keys collide in the table
+    for (int i = 0; i < DYNAMIC_KEYMAP_MAX_ENTRIES; i++) {
+        uint8_t layer = i % 2 ? i : 0;
+        uint8_t col = i % 2 ? 0 : (i / 2) % MATRIX_COLS;
+        ASSERT_TRUE(dynamic_keymap_set(layer, key(1, col), 0x200 + i));
+    }
+    for (int i = 0; i < DYNAMIC_KEYMAP_MAX_ENTRIES; i++) {
+        uint8_t layer = i % 2 ? i : 0;
+        uint8_t col = i % 2 ? 0 : (i / 2) % MATRIX_COLS;
+        uint16_t keycode = 0;
+        EXPECT_TRUE(lookup(layer, 1, col, &keycode));
+        EXPECT_EQ(keycode, 0x200 + i);
+    }
+    uint16_t keycode;
+    EXPECT_FALSE(lookup(2, 1, 0, &keycode));
+}
+#endif
+
+TEST_F(DynamicKeymap, clearing_an_entry_keeps_the_others) {
+    dynamic_keymap_set(0, key(0, 1), 0x0001);
+    dynamic_keymap_set(0, key(0, 2), 0x0002);
+    dynamic_keymap_set(0, key(0, 3), 0x0003);
+    dynamic_keymap_clear(0, key(0, 1));
+    dynamic_keymap_clear(0, key(0, 5));
+    EXPECT_EQ(dynamic_keymap_count(), 2);
+    uint16_t keycode = 0;
+    EXPECT_FALSE(lookup(0, 0, 1, &keycode));
+    EXPECT_TRUE(lookup(0, 0, 2, &keycode));
+    EXPECT_EQ(keycode, 0x0002);
+    EXPECT_TRUE(lookup(0, 0, 3, &keycode));
+    EXPECT_EQ(keycode, 0x0003);
+    dynamic_keymap_init();
+    EXPECT_EQ(dynamic_keymap_count(), 2);
+    EXPECT_FALSE(lookup(0, 0, 1, &keycode));
+}
+
+TEST_F(DynamicKeymap, reset_removes_all_entries) {
+    dynamic_keymap_set(0, key(0, 1), 0x0001);
+    dynamic_keymap_set(1, key(2, 1), 0x0002);
+    dynamic_keymap_reset();
+    uint16_t keycode;
+    EXPECT_EQ(dynamic_keymap_count(), 0);
+    EXPECT_FALSE(lookup(0, 0, 1, &keycode));
+    EXPECT_FALSE(lookup(1, 2, 1, &keycode));
+}
+
+TEST_F(DynamicKeymap, processes_console_reports) {
+    uint16_t keycode = 0;
+    const uint8_t set[] = {DYNAMIC_KEYMAP_SET, 1, 2, 3, 0x12, 0x34};
+    EXPECT_TRUE(dynamic_keymap_process_report(set, sizeof(set)));
+    EXPECT_TRUE(lookup(1, 2, 3, &keycode));
+    EXPECT_EQ(keycode, 0x1234);
+
+    const uint8_t get[] = {DYNAMIC_KEYMAP_GET, 1, 2, 3};
+    EXPECT_TRUE(dynamic_keymap_process_report(get, sizeof(get)));
+
+    const uint8_t clear[] = {DYNAMIC_KEYMAP_CLEAR, 1, 2, 3};
+    EXPECT_TRUE(dynamic_keymap_process_report(clear, sizeof(clear)));
+    EXPECT_FALSE(lookup(1, 2, 3, &keycode));
+
+    EXPECT_TRUE(dynamic_keymap_process_report(set, sizeof(set)));
+    const uint8_t reset[] = {DYNAMIC_KEYMAP_RESET};
+    EXPECT_TRUE(dynamic_keymap_process_report(reset, sizeof(reset)));
+    EXPECT_EQ(dynamic_keymap_count(), 0);
+}
+
+TEST_F(DynamicKeymap, rejects_invalid_console_reports) {
+    const uint8_t short_set[] = {DYNAMIC_KEYMAP_SET, 1, 2, 3, 0x12};
+    const uint8_t bad_key[] = {DYNAMIC_KEYMAP_CLEAR, 0, MATRIX_ROWS, 0};
+    const uint8_t unknown[] = {0x7F, 0, 0, 0};
+    EXPECT_FALSE(dynamic_keymap_process_report(short_set, sizeof(short_set)));
+    EXPECT_FALSE(dynamic_keymap_process_report(bad_key, sizeof(bad_key)));
+    EXPECT_FALSE(dynamic_keymap_process_report(unknown, sizeof(unknown)));
+    EXPECT_FALSE(dynamic_keymap_process_report(unknown, 0));
+    EXPECT_EQ(num_writes, 0);
+}
@@ -0,0 +1,135 @@
+#include "gtest/gtest.h"
+extern "C" {
+#include "rgblight_reactive.h"
+}
+
+class RgblightReactive : public testing::Test {
+public:
+    RgblightReactive() {
+        // Lets the ripples and the heat from earlier tests expire
+        now += 60000;
+        render_ripple();
+        render_heatmap();
+    }
+
+    void press(uint8_t row, uint8_t col) {
+        keypos_t key;
+        key.row = row;
+        key.col = col;
+        rgblight_reactive_record(key, now);
+    }
+
+    void render_ripple() {
+        rgblight_reactive_ripple(leds, now, 0, 255, 255);
+    }
+
+    void render_heatmap() {
+        rgblight_reactive_heatmap(leds, now, 255, 255);
+    }
+
+    bool lit(int i) {
+        return leds[i].r || leds[i].g || leds[i].b;
+    }
+
+    int num_lit() {
+        int n = 0;
+        for (int i = 0; i < RGBLED_NUM; i++) {
+            n += lit(i);
+        }
+        return n;
+    }
+
+    static uint16_t now;
+    struct cRGB leds[RGBLED_NUM];
+};
+
+uint16_t RgblightReactive::now = 1000;
+
+TEST_F(RgblightReactive, the_matrix_is_spread_over_the_strip) {
+    keypos_t key;
+    key.row = 0;
+    key.col = 0;
+    EXPECT_EQ(rgblight_key_to_led(key), 0);
+    key.row = MATRIX_ROWS - 1;
+    key.col = MATRIX_COLS - 1;
+    EXPECT_EQ(rgblight_key_to_led(key), RGBLED_NUM - 1);
+    key.row = MATRIX_ROWS / 2;
+    key.col = 0;
+    EXPECT_EQ(rgblight_key_to_led(key), RGBLED_NUM / 2);
+}
+
+TEST_F(RgblightReactive, nothing_is_lit_without_presses) {
+    render_ripple();
+    EXPECT_EQ(num_lit(), 0);
+    render_heatmap();
+    EXPECT_EQ(num_lit(), 0);
+}
+
+TEST_F(RgblightReactive, a_ripple_moves_away_from_the_key) {
+    // LED 8
+    press(2, 0);
+    render_ripple();
+    EXPECT_TRUE(lit(8));
+    EXPECT_EQ(num_lit(), 1);
+
+    now += RGBLIGHT_RIPPLE_SPEED * 3;
+    render_ripple();
+    EXPECT_TRUE(lit(5));
+    EXPECT_TRUE(lit(11));
+    EXPECT_EQ(num_lit(), 2);
+}
+
+TEST_F(RgblightReactive, a_ripple_fades_out) {
+    press(2, 0);
+    render_ripple();
+    uint8_t start = leds[8].r;
+    now += RGBLIGHT_RIPPLE_SPEED * 2;
+    render_ripple();
+    EXPECT_LT(leds[6].r, start);
+    now += RGBLIGHT_RIPPLE_TIMEOUT;
+    render_ripple();
+    EXPECT_EQ(num_lit(), 0);
+    // Not even when the timer wraps
+    now += 65536 - RGBLIGHT_RIPPLE_TIMEOUT - RGBLIGHT_RIPPLE_SPEED * 2;
+    render_ripple();
+    EXPECT_EQ(num_lit(), 0);
+}
+
+TEST_F(RgblightReactive, only_the_newest_presses_are_kept) {
+    press(0, 0);
+    for (int i = 0; i < RGBLIGHT_REACTIVE_EVENTS; i++) {
+        press(3, 7);
+    }
+    render_ripple();
+    EXPECT_FALSE(lit(0));
+    EXPECT_TRUE(lit(RGBLED_NUM - 1));
+}
+
+TEST_F(RgblightReactive, presses_heat_up_their_leds) {
+    press(2, 0);
+    render_heatmap();
+    EXPECT_TRUE(lit(7));
+    EXPECT_TRUE(lit(8));
+    EXPECT_TRUE(lit(9));
+    EXPECT_EQ(num_lit(), 3);
+    // Cold is blue
+    EXPECT_GT(leds[7].b, leds[7].r);
+
+    for (int i = 0; i < 10; i++) {
+        press(2, 0);
+    }
+    render_heatmap();
+    // Hot is red
+    EXPECT_GT(leds[8].r, leds[8].b);
+}
+
+TEST_F(RgblightReactive, the_heat_decays) {
+    press(2, 0);
+    now += RGBLIGHT_HEATMAP_DECAY * RGBLIGHT_HEATMAP_INCREMENT / 2;
+    render_heatmap();
+    EXPECT_TRUE(lit(8));
+    EXPECT_FALSE(lit(7));
+    now += RGBLIGHT_HEATMAP_DECAY * RGBLIGHT_HEATMAP_INCREMENT / 2;
+    render_heatmap();
+    EXPECT_EQ(num_lit(), 0);
+}
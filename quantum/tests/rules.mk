@@ -0,0 +1,27 @@
+dynamic_keymap_DEFS := -DMATRIX_ROWS=4 -DMATRIX_COLS=8 -DNO_PRINT
+dynamic_keymap_SRC :=\
+	$(QUANTUM_PATH)/tests/dynamic_keymap_tests.cpp \
+	$(QUANTUM_PATH)/dynamic_keymap.c
+
+# The largest table, over 256 slots
+dynamic_keymap_large_DEFS := $(dynamic_keymap_DEFS) -DDYNAMIC_KEYMAP_MAX_ENTRIES=254
+dynamic_keymap_large_SRC := $(dynamic_keymap_SRC)
+
+color_SRC :=\
+	$(QUANTUM_PATH)/tests/color_tests.cpp \
+	$(QUANTUM_PATH)/color.c
+
+ws2812_encode_SRC :=\
+	$(QUANTUM_PATH)/tests/ws2812_encode_tests.cpp \
+	$(QUANTUM_PATH)/ws2812_encode.c
+
+rgblight_reactive_DEFS := -DMATRIX_ROWS=4 -DMATRIX_COLS=8 -DRGBLED_NUM=16
+rgblight_reactive_SRC :=\
+	$(QUANTUM_PATH)/tests/rgblight_reactive_tests.cpp \
+	$(QUANTUM_PATH)/rgblight_reactive.c \
+	$(QUANTUM_PATH)/color.c
+
+tap_dance_DEFS := -DMATRIX_ROWS=4 -DMATRIX_COLS=8 -DTAP_DANCE_ENABLE -DNO_PRINT
+tap_dance_SRC :=\
+	$(QUANTUM_PATH)/tests/tap_dance_tests.cpp \
+	$(QUANTUM_PATH)/process_keycode/process_tap_dance.c
@@ -0,0 +1,210 @@
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+extern "C" {
+#include "quantum.h"
+#include "action_tapping.h"
+#include "process_tap_dance.h"
+}
+
+static const int NUM_DANCES = 40;
+// Every fifth dance has a tapping term of its own
+static const uint16_t LONG_TERM = TAPPING_TERM * 3;
+
+static uint16_t now;
+static int timer_calls;
+static std::vector<std::string> calls;
+static std::vector<uint16_t> registered;
+
+extern "C" {
+uint16_t timer_read(void) {
+    timer_calls++;
+    return now;
+}
+uint16_t timer_elapsed(uint16_t last) {
+    timer_calls++;
+    return TIMER_DIFF_16(now, last);
+}
+void register_code16(uint16_t code) {
+    registered.push_back(code);
+}
+void unregister_code16(uint16_t code) {
+    registered.erase(std::find(registered.begin(), registered.end(), code));
+}
+}
+
+static std::string describe(qk_tap_dance_state_t* state) {
+    return std::to_string(state->keycode - QK_TAP_DANCE) + "x" + std::to_string(state->count) +
+        (state->interrupted ? "i" : "");
+}
+
+static void dance_finished(qk_tap_dance_state_t* state, void* user_data) {
+    (void)user_data;
+    calls.push_back("finished " + describe(state));
+}
+
+static void dance_reset(qk_tap_dance_state_t* state, void* user_data) {
+    (void)user_data;
+    calls.push_back("reset " + describe(state));
+}
+
+qk_tap_dance_action_t tap_dance_actions[NUM_DANCES];
+
+class TapDance : public testing::Test {
+public:
+    static void SetUpTestCase() {
+        for (int i = 0; i < NUM_DANCES; i++) {
+            if (i % 5 == 4) {
+                tap_dance_actions[i] = ACTION_TAP_DANCE_FN_ADVANCED_TIME(NULL, dance_finished, dance_reset, LONG_TERM);
+            } else {
+                tap_dance_actions[i] = ACTION_TAP_DANCE_FN_ADVANCED(NULL, dance_finished, dance_reset);
+            }
+        }
+        // ACTION_TAP_DANCE_DOUBLE, its compound literal is C only
+        static qk_tap_dance_pair_t pair = { KC_A, KC_B };
+        tap_dance_actions[NUM_DANCES - 1] = ACTION_TAP_DANCE_FN_ADVANCED(NULL, qk_tap_dance_pair_finished, qk_tap_dance_pair_reset);
+        tap_dance_actions[NUM_DANCES - 1].user_data = &pair;
+    }
+    void SetUp() override {
+        now = 1000;
+        calls.clear();
+        registered.clear();
+    }
+    void TearDown() override {
+        // Let whatever is left time out, for the next test
+        now += 2 * LONG_TERM;
+        matrix_scan_tap_dance();
+    }
+    void key(uint16_t keycode, bool pressed) {
+        keyrecord_t record = {};
+        record.event.pressed = pressed;
+        record.event.time = now;
+        process_tap_dance(keycode, &record);
+    }
+    void tap(uint16_t keycode) {
+        key(keycode, true);
+        key(keycode, false);
+    }
+    // Scans once a millisecond up to and including end
+    void scan_until(uint16_t end) {
+        while (now != end) {
+            now++;
+            matrix_scan_tap_dance();
+        }
+    }
+};
+
+TEST_F(TapDance, a_tap_finishes_after_the_tapping_term) {
+    tap(TD(3));
+    scan_until(now + TAPPING_TERM);
+    EXPECT_TRUE(calls.empty());
+    scan_until(now + 1);
+    EXPECT_EQ(calls, (std::vector<std::string>{"finished 3x1", "reset 3x1"}));
+}
+
+TEST_F(TapDance, taps_within_the_term_count_up) {
+    tap(TD(7));
+    scan_until(now + TAPPING_TERM - 1);
+    tap(TD(7));
+    scan_until(now + TAPPING_TERM - 1);
+    tap(TD(7));
+    EXPECT_TRUE(calls.empty());
+    scan_until(now + TAPPING_TERM + 1);
+    EXPECT_EQ(calls, (std::vector<std::string>{"finished 7x3", "reset 7x3"}));
+}
+
+TEST_F(TapDance, a_dance_can_have_a_tapping_term_of_its_own) {
+    tap(TD(4));
+    scan_until(now + LONG_TERM);
+    EXPECT_TRUE(calls.empty());
+    scan_until(now + 1);
+    EXPECT_EQ(calls, (std::vector<std::string>{"finished 4x1", "reset 4x1"}));
+}
+
+TEST_F(TapDance, another_key_interrupts_the_dance) {
+    tap(TD(12));
+    key(KC_X, true);
+    EXPECT_EQ(calls, (std::vector<std::string>{"finished 12x1i", "reset 12x1i"}));
+    calls.clear();
+    scan_until(now + LONG_TERM);
+    EXPECT_TRUE(calls.empty());
+}
+
+TEST_F(TapDance, another_dance_interrupts_the_dance) {
+    tap(TD(20));
+    tap(TD(21));
+    EXPECT_EQ(calls, (std::vector<std::string>{"finished 20x1i", "reset 20x1i"}));
+    calls.clear();
+    scan_until(now + TAPPING_TERM + 1);
+    EXPECT_EQ(calls, (std::vector<std::string>{"finished 21x1", "reset 21x1"}));
+}
+
+TEST_F(TapDance, a_held_dance_resets_once_released) {
+    key(TD(5), true);
+    scan_until(now + TAPPING_TERM + 1);
+    EXPECT_EQ(calls, (std::vector<std::string>{"finished 5x1"}));
+    scan_until(now + 100);
+    key(TD(5), false);
+    scan_until(now + 1);
+    EXPECT_EQ(calls, (std::vector<std::string>{"finished 5x1", "reset 5x1"}));
+}
+
+TEST_F(TapDance, every_dance_held_at_once_finishes_and_resets) {
+    for (int i = 0; i < NUM_DANCES - 1; i++) {
+        key(TD(i), true);
+    }
+    // Each dance was interrupted by the next, but is held
+    EXPECT_EQ(calls.size(), (size_t)NUM_DANCES - 2);
+    for (int i = 0; i < NUM_DANCES - 1; i++) {
+        key(TD(i), false);
+    }
+    calls.clear();
+    scan_until(now + LONG_TERM + 1);
+    int resets = 0;
+    for (auto& call : calls) {
+        if (call.compare(0, 6, "reset ") == 0) {
+            resets++;
+        }
+    }
+    EXPECT_EQ(resets, NUM_DANCES - 1);
+}
+
+TEST_F(TapDance, the_earliest_term_of_the_held_dances_ends_the_wait) {
+    key(TD(9), true);
+    key(TD(10), true);
+    calls.clear();
+    key(TD(9), false);
+    key(TD(10), false);
+    // 9 resets after its longer term, 10 after the default, releasing 9
+    // interrupted it
+    scan_until(now + TAPPING_TERM + 1);
+    EXPECT_EQ(calls, (std::vector<std::string>{"finished 10x1i", "reset 10x1i"}));
+    scan_until(now + LONG_TERM - TAPPING_TERM);
+    EXPECT_EQ(calls, (std::vector<std::string>{"finished 10x1i", "reset 10x1i", "reset 9x1i"}));
+}
+
+TEST_F(TapDance, idle_scans_do_not_read_the_timer) {
+    timer_calls = 0;
+    scan_until(now + 100);
+    EXPECT_EQ(timer_calls, 0);
+}
+
+TEST_F(TapDance, scans_check_one_timer_until_a_dance_is_due) {
+    tap(TD(14));
+    timer_calls = 0;
+    scan_until(now + LONG_TERM);
+    EXPECT_EQ(timer_calls, LONG_TERM);
+    EXPECT_TRUE(calls.empty());
+}
+
+TEST_F(TapDance, the_double_action_registers_the_second_key_on_two_taps) {
+    uint16_t dance = TD(NUM_DANCES - 1);
+    tap(dance);
+    key(dance, true);
+    scan_until(now + TAPPING_TERM + 1);
+    EXPECT_EQ(registered, (std::vector<uint16_t>{KC_B}));
+    key(dance, false);
+    scan_until(now + 1);
+    EXPECT_TRUE(registered.empty());
+}
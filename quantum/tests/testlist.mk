@@ -0,0 +1,7 @@
+TEST_LIST +=\
+	dynamic_keymap \
+	dynamic_keymap_large \
+	color \
+	ws2812_encode \
+	rgblight_reactive \
+	tap_dance
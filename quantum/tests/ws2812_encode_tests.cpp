@@ -0,0 +1,76 @@
+#include "gtest/gtest.h"
+#include <vector>
+extern "C" {
+#include "ws2812_encode.h"
+}
+
+// Decodes the bitstream the way a WS2812 sees it, a pulse that is high for
+// two SPI bits is a one, for one SPI bit a zero
+static std::vector<uint8_t> decode(const std::vector<uint8_t>& stream) {
+    std::vector<uint8_t> data;
+    std::vector<int> bits;
+    for (uint8_t byte : stream) {
+        for (int i = 7; i >= 0; i--) {
+            bits.push_back((byte >> i) & 1);
+        }
+    }
+    EXPECT_EQ(bits.size() % 24, 0u);
+    for (size_t i = 0; i + 24 <= bits.size(); i += 24) {
+        uint8_t byte = 0;
+        for (size_t j = i; j < i + 24; j += 3) {
+            // Every bit starts high and ends low
+            EXPECT_EQ(bits[j], 1) << "at SPI bit " << j;
+            EXPECT_EQ(bits[j + 2], 0) << "at SPI bit " << j + 2;
+            byte = (byte << 1) | bits[j + 1];
+        }
+        data.push_back(byte);
+    }
+    return data;
+}
+
+static std::vector<uint8_t> encode(const std::vector<uint8_t>& leds) {
+    std::vector<uint8_t> stream(leds.size() * 3 + 1, 0xAA);
+    uint16_t length = ws2812_encode(leds.data(), leds.size() / 3, stream.data());
+    EXPECT_EQ(length, leds.size() / 3 * WS2812_ENCODED_BYTES_PER_LED);
+    // Nothing is written past the returned length
+    EXPECT_EQ(stream[length], 0xAA);
+    stream.resize(length);
+    return stream;
+}
+
+TEST(Ws2812Encode, encodes_zeros) {
+    std::vector<uint8_t> expected = {0x92, 0x49, 0x24, 0x92, 0x49, 0x24, 0x92, 0x49, 0x24};
+    EXPECT_EQ(encode({0, 0, 0}), expected);
+}
+
+TEST(Ws2812Encode, encodes_ones) {
+    std::vector<uint8_t> expected = {0xDB, 0x6D, 0xB6, 0xDB, 0x6D, 0xB6, 0xDB, 0x6D, 0xB6};
+    EXPECT_EQ(encode({0xFF, 0xFF, 0xFF}), expected);
+}
+
+TEST(Ws2812Encode, sends_the_most_significant_bit_first) {
+    std::vector<uint8_t> stream = encode({0x80, 0x01, 0x00});
+    // 110 100 100 ...
+    EXPECT_EQ(stream[0], 0xD2);
+    // ... 100 110
+    EXPECT_EQ(stream[5], 0x26);
+}
+
+TEST(Ws2812Encode, every_byte_decodes_to_itself) {
+    std::vector<uint8_t> leds;
+    for (int i = 0; i < 256; i++) {
+        leds.push_back(i);
+    }
+    leds.push_back(0x5A);
+    leds.push_back(0xA5);
+    EXPECT_EQ(decode(encode(leds)), leds);
+}
+
+TEST(Ws2812Encode, keeps_the_led_order) {
+    std::vector<uint8_t> leds = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+    EXPECT_EQ(decode(encode(leds)), leds);
+}
+
+TEST(Ws2812Encode, encodes_nothing_for_no_leds) {
+    EXPECT_TRUE(encode({}).empty());
+}
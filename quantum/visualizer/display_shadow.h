@@ -0,0 +1,41 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Fred Sundvik
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef TMK_VISUALIZER_DISPLAY_SHADOW_H_
+#define TMK_VISUALIZER_DISPLAY_SHADOW_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// A display driver keeps a shadow of what it last sent to the display, and
+// only sends the bytes of its memory that differ from it. So redrawing the
+// same thing, even after clearing it first, sends nothing.
+
+// Finds the first and last byte of ram that differ from the shadow, and copies
+// the span between them to the shadow, which the caller then has to send.
+// Returns false, without touching first and last, when nothing differs.
+bool display_shadow_update(uint8_t* shadow, const uint8_t* ram, uint16_t size,
+        uint16_t* first, uint16_t* last);
+
+#endif /* TMK_VISUALIZER_DISPLAY_SHADOW_H_ */
@@ -48,8 +48,8 @@ bool display_welcome(keyframe_animation_t* animation, visualizer_state_t* state)
     // or state structs
     gdispDrawString(0, 3, welcome_text[0], state->font_dejavusansbold12, Black);
     gdispDrawString(0, 15, welcome_text[1], state->font_dejavusansbold12, Black);
-    // Always remember to flush the display
-    gdispFlush();
+    // No need to flush the display, the visualizer does it after the
+    // animations ran, and only sends what changed
     // you could set the backlight color as well, but we won't do it here, since
     // it's part of the following animation
     // lcd_backlight_color(hue, saturation, intensity);
@@ -0,0 +1,240 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Fred Sundvik
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "visualizer.h"
+
+//#define DEBUG_VISUALIZER
+
+#ifdef DEBUG_VISUALIZER
+#include "debug.h"
+#else
+#include "nodebug.h"
+#endif
+
+// The running animations, in a min-heap on the time they next need an
+// update, so only the ones due are looked at. An animation knows where it
+// is in the heap, heap_position is its index + 1, and 0 when it's stopped.
+static keyframe_animation_t* heap[VISUALIZER_MAX_ANIMATIONS];
+static int heap_size = 0;
+// Taken out of the heap while its frame functions run
+static keyframe_animation_t* updating = NULL;
+
+// Wraps around like the system ticks do
+#define TICKS_BEFORE(a, b) ((systemticks_t)((a) - (b)) > ((systemticks_t)-1 >> 1))
+
+static void heap_place(int index, keyframe_animation_t* animation) {
+    heap[index] = animation;
+    animation->heap_position = index + 1;
+}
+
+static void heap_up(int index) {
+    keyframe_animation_t* animation = heap[index];
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (!TICKS_BEFORE(animation->deadline, heap[parent]->deadline)) {
+            break;
+        }
+        heap_place(index, heap[parent]);
+        index = parent;
+    }
+    heap_place(index, animation);
+}
+
+static void heap_down(int index) {
+    keyframe_animation_t* animation = heap[index];
+    while (true) {
+        int child = 2 * index + 1;
+        if (child >= heap_size) {
+            break;
+        }
+        if (child + 1 < heap_size && TICKS_BEFORE(heap[child + 1]->deadline, heap[child]->deadline)) {
+            child++;
+        }
+        if (!TICKS_BEFORE(heap[child]->deadline, animation->deadline)) {
+            break;
+        }
+        heap_place(index, heap[child]);
+        index = child;
+    }
+    heap_place(index, animation);
+}
+
+static bool heap_push(keyframe_animation_t* animation) {
+    if (heap_size == VISUALIZER_MAX_ANIMATIONS) {
+        dprint("Too many animations, raise VISUALIZER_MAX_ANIMATIONS\n");
+        return false;
+    }
+    heap[heap_size] = animation;
+    heap_up(heap_size++);
+    return true;
+}
+
+static void heap_remove(keyframe_animation_t* animation) {
+    int index = animation->heap_position - 1;
+    animation->heap_position = 0;
+    heap_size--;
+    if (index == heap_size) {
+        return;
+    }
+    heap[index] = heap[heap_size];
+    heap_up(index);
+    heap_down(heap[index]->heap_position - 1);
+}
+
+void start_keyframe_animation(keyframe_animation_t* animation) {
+    animation->current_frame = -1;
+    animation->time_left_in_frame = 0;
+    animation->need_update = true;
+    // Due right away, the first frame starts at the next update
+    animation->deadline = gfxSystemTicks();
+    animation->last_update = animation->deadline;
+    if (animation->heap_position) {
+        heap_up(animation->heap_position - 1);
+    } else if (animation != updating) {
+        heap_push(animation);
+    }
+}
+
+static void reset_keyframe_animation(keyframe_animation_t* animation) {
+    animation->current_frame = animation->num_frames;
+    animation->time_left_in_frame = 0;
+    animation->need_update = true;
+    animation->first_update_of_frame = false;
+    animation->last_update_of_frame = false;
+}
+
+void stop_keyframe_animation(keyframe_animation_t* animation) {
+    reset_keyframe_animation(animation);
+    if (animation->heap_position) {
+        heap_remove(animation);
+    }
+}
+
+void stop_all_keyframe_animations(void) {
+    for (int i=0;i<heap_size;i++) {
+        reset_keyframe_animation(heap[i]);
+        heap[i]->heap_position = 0;
+    }
+    heap_size = 0;
+    if (updating) {
+        reset_keyframe_animation(updating);
+    }
+}
+
+static bool update_keyframe_animation(keyframe_animation_t* animation, visualizer_state_t* state, systemticks_t delta, systemticks_t* sleep_time) {
+    // TODO: Clean up this messy code
+    dprintf("Animation frame%d, left %d, delta %d\n", animation->current_frame,
+            animation->time_left_in_frame, delta);
+    if (animation->current_frame == animation->num_frames) {
+        animation->need_update = false;
+        return false;
+    }
+    if (animation->current_frame == -1) {
+       animation->current_frame = 0;
+       animation->time_left_in_frame = animation->frame_lengths[0];
+       animation->need_update = true;
+       animation->first_update_of_frame = true;
+    } else {
+        animation->time_left_in_frame -= delta;
+        while (animation->time_left_in_frame <= 0) {
+            int left = animation->time_left_in_frame;
+            if (animation->need_update) {
+                animation->time_left_in_frame = 0;
+                animation->last_update_of_frame = true;
+                (*animation->frame_functions[animation->current_frame])(animation, state);
+                animation->last_update_of_frame = false;
+            }
+            animation->current_frame++;
+            animation->need_update = true;
+            animation->first_update_of_frame = true;
+            if (animation->current_frame == animation->num_frames) {
+                if (animation->loop) {
+                    animation->current_frame = 0;
+                }
+                else {
+                    stop_keyframe_animation(animation);
+                    return false;
+                }
+            }
+            delta = -left;
+            animation->time_left_in_frame = animation->frame_lengths[animation->current_frame];
+            animation->time_left_in_frame -= delta;
+        }
+    }
+    if (animation->need_update) {
+        animation->need_update = (*animation->frame_functions[animation->current_frame])(animation, state);
+        animation->first_update_of_frame = false;
+    }
+    if (animation->current_frame == animation->num_frames) {
+        // Stopped by its own frame function
+        return false;
+    }
+
+    systemticks_t update_interval = animation->update_interval ?
+        (systemticks_t)animation->update_interval : gfxMillisecondsToTicks(VISUALIZER_UPDATE_INTERVAL);
+    *sleep_time = animation->need_update ? update_interval : (unsigned)animation->time_left_in_frame;
+    return true;
+}
+
+systemticks_t update_keyframe_animations(visualizer_state_t* state, systemticks_t now) {
+    while (heap_size > 0 && !TICKS_BEFORE(now, heap[0]->deadline)) {
+        keyframe_animation_t* animation = heap[0];
+        heap_remove(animation);
+
+        systemticks_t sleep_time;
+        updating = animation;
+        bool running = update_keyframe_animation(animation, state, now - animation->last_update, &sleep_time);
+        updating = NULL;
+        animation->last_update = now;
+
+        // Restarted by a frame function, that put it back already
+        if (!running || animation->heap_position) {
+            continue;
+        }
+        // At least a tick later, so that every animation gets one update
+        // a call, even with frames of no length
+        animation->deadline = now + (sleep_time ? sleep_time : 1);
+        heap_push(animation);
+    }
+    if (heap_size == 0) {
+        return TIME_INFINITE;
+    }
+    return TICKS_BEFORE(now, heap[0]->deadline) ? (systemticks_t)(heap[0]->deadline - now) : 0;
+}
+
+void run_next_keyframe(keyframe_animation_t* animation, visualizer_state_t* state) {
+    int next_frame = animation->current_frame + 1;
+    if (next_frame == animation->num_frames) {
+        next_frame = 0;
+    }
+    keyframe_animation_t temp_animation = *animation;
+    temp_animation.current_frame = next_frame;
+    temp_animation.time_left_in_frame = animation->frame_lengths[next_frame];
+    temp_animation.first_update_of_frame = true;
+    temp_animation.last_update_of_frame = false;
+    temp_animation.need_update  = false;
+    visualizer_state_t temp_state = *state;
+    (*temp_animation.frame_functions[next_frame])(&temp_animation, &temp_state);
+}
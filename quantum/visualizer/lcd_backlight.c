@@ -23,7 +23,6 @@ SOFTWARE.
 */
 
 #include "lcd_backlight.h"
-#include <math.h>
 
 static uint8_t current_hue = 0x00;
 static uint8_t current_saturation = 0x00;
@@ -35,50 +34,85 @@ void lcd_backlight_init(void) {
     lcd_backlight_color(current_hue, current_saturation, current_intensity);
 }
 
+// cos(h) / cos(60 - h) in 1/8192ths, for the 85 hue steps of each third of
+// the color wheel, 120 degrees
+#define HSI_SECTOR 85
+#define HSI_ONE 8192
+static const int16_t hsi_cos_ratio[HSI_SECTOR] = {
+    16384, 15713, 15095, 14521, 13988, 13491, 13024, 12586,
+    12173, 11783, 11412, 11061, 10725, 10405, 10099, 9805,
+    9522, 9250, 8988, 8734, 8489, 8250, 8019, 7794,
+    7574, 7360, 7151, 6945, 6744, 6547, 6353, 6162,
+    5974, 5788, 5604, 5422, 5242, 5063, 4886, 4709,
+    4534, 4358, 4183, 4009, 3834, 3658, 3483, 3306,
+    3129, 2950, 2770, 2588, 2404, 2218, 2030, 1839,
+    1645, 1448, 1247, 1041, 832, 618, 398, 173,
+    -58, -297, -542, -796, -1058, -1330, -1613, -1907,
+    -2213, -2533, -2869, -3220, -3591, -3981, -4394, -4832,
+    -5299, -5796, -6329, -6903, -7521,
+};
+
 // This code is based on Brian Neltner's blogpost and example code
 // "Why every LED light should be using HSI colorspace".
 // http://blog.saikoled.com/post/43693602826/why-every-led-light-should-be-using-hsi
-static void hsi_to_rgb(float h, float s, float i, uint16_t* r_out, uint16_t* g_out, uint16_t* b_out) {
-    unsigned int r, g, b;
-    h = fmodf(h, 360.0f); // cycle h around to 0-360 degrees
-    h = 3.14159f * h / 180.0f; // Convert to radians.
-    s = s > 0.0f ? (s < 1.0f ? s : 1.0f) : 0.0f; // clamp s and i to interval [0,1]
-    i = i > 0.0f ? (i < 1.0f ? i : 1.0f) : 0.0f;
+// The color with most of the intensity is 1 + s * cos(h) / cos(60 - h), the
+// next 1 + s * (1 - cos(h) / cos(60 - h)) and the last 1 - s, a third of the
+// intensity each, which adds up to all of it.
+void lcd_backlight_hsi_to_rgb(uint8_t hue, uint8_t saturation, uint16_t intensity, uint16_t* r, uint16_t* g, uint16_t* b) {
+    // 255 is all the way around
+    if (hue == 255) {
+        hue = 0;
+    }
+    uint8_t sector = hue / HSI_SECTOR;
+    int32_t s_ratio = (int32_t)saturation * hsi_cos_ratio[hue - sector * HSI_SECTOR];
+    uint16_t first = (uint32_t)intensity * (HSI_ONE + s_ratio / 255) / (3 * HSI_ONE);
+    uint16_t second = (uint32_t)intensity * (HSI_ONE + ((int32_t)saturation * HSI_ONE - s_ratio) / 255) / (3 * HSI_ONE);
+    uint16_t last = (uint32_t)intensity * (HSI_ONE * (255 - saturation) / 255) / (3 * HSI_ONE);
 
-    // Math! Thanks in part to Kyle Miller.
-    if(h < 2.09439f) {
-        r = 65535.0f * i/3.0f *(1.0f + s * cos(h) / cosf(1.047196667f - h));
-        g = 65535.0f * i/3.0f *(1.0f + s *(1.0f - cosf(h) / cos(1.047196667f - h)));
-        b = 65535.0f * i/3.0f *(1.0f - s);
-    } else if(h < 4.188787) {
-        h = h - 2.09439;
-        g = 65535.0f * i/3.0f *(1.0f + s * cosf(h) / cosf(1.047196667f - h));
-        b = 65535.0f * i/3.0f *(1.0f + s * (1.0f - cosf(h) / cosf(1.047196667f - h)));
-        r = 65535.0f * i/3.0f *(1.0f - s);
-    } else {
-        h = h - 4.188787;
-        b = 65535.0f*i/3.0f * (1.0f + s * cosf(h) / cosf(1.047196667f - h));
-        r = 65535.0f*i/3.0f * (1.0f + s * (1.0f - cosf(h) / cosf(1.047196667f - h)));
-        g = 65535.0f*i/3.0f * (1.0f - s);
+    switch (sector) {
+    case 0:
+        *r = first; *g = second; *b = last;
+        break;
+    case 1:
+        *g = first; *b = second; *r = last;
+        break;
+    default:
+        *b = first; *r = second; *g = last;
+        break;
     }
-    *r_out = r > 65535 ? 65535 : r;
-    *g_out = g > 65535 ? 65535 : g;
-    *b_out = b > 65535 ? 65535 : b;
 }
 
 void lcd_backlight_color(uint8_t hue, uint8_t saturation, uint8_t intensity) {
     uint16_t r, g, b;
-    float hue_f = 360.0f * (float)hue / 255.0f;
-    float saturation_f = (float)saturation / 255.0f;
-    float intensity_f = (float)intensity / 255.0f;
-    intensity_f *= (float)current_brightness / 255.0f;
-    hsi_to_rgb(hue_f, saturation_f, intensity_f, &r, &g, &b);
+    // Scaled by the brightness, to 0-65535
+    uint16_t intensity_16 = (uint32_t)intensity * current_brightness * 65535 / (255 * 255);
+    lcd_backlight_hsi_to_rgb(hue, saturation, intensity_16, &r, &g, &b);
 	current_hue = hue;
 	current_saturation = saturation;
 	current_intensity = intensity;
 	lcd_backlight_hal_color(r, g, b);
 }
 
+uint32_t lcd_color_interpolate(uint32_t from, uint32_t to, uint32_t position, uint32_t length) {
+    if (position >= length) {
+        return to;
+    }
+    while (length > 0xFFFF) {
+        length >>= 1;
+        position >>= 1;
+    }
+    // One division for all three, the rest is multiplying by this
+    int32_t t = (position << 16) / length;
+    // The shortest way around the color wheel
+    int32_t d_h = (int8_t)(LCD_HUE(to) - LCD_HUE(from));
+    int32_t d_s = (int32_t)LCD_SAT(to) - LCD_SAT(from);
+    int32_t d_i = (int32_t)LCD_INT(to) - LCD_INT(from);
+    uint8_t hue = LCD_HUE(from) + d_h * t / 0x10000;
+    uint8_t sat = LCD_SAT(from) + d_s * t / 0x10000;
+    uint8_t intensity = LCD_INT(from) + d_i * t / 0x10000;
+    return LCD_COLOR((uint32_t)hue, (uint32_t)sat, (uint32_t)intensity);
+}
+
 void lcd_backlight_brightness(uint8_t b) {
     current_brightness = b;
     lcd_backlight_color(current_hue, current_saturation, current_intensity);
@@ -35,6 +35,11 @@ SOFTWARE.
 void lcd_backlight_init(void);
 void lcd_backlight_color(uint8_t hue, uint8_t saturation, uint8_t intensity);
 void lcd_backlight_brightness(uint8_t b);
+// The 16-bit PWM values of a color, intensity is 0-65535
+void lcd_backlight_hsi_to_rgb(uint8_t hue, uint8_t saturation, uint16_t intensity, uint16_t* r, uint16_t* g, uint16_t* b);
+// The LCD_COLOR position / length of the way between two, the hue going the
+// shortest way around
+uint32_t lcd_color_interpolate(uint32_t from, uint32_t to, uint32_t position, uint32_t length);
 
 void lcd_backlight_hal_init(void);
 void lcd_backlight_hal_color(uint16_t r, uint16_t g, uint16_t b);
@@ -0,0 +1,102 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Fred Sundvik
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "led_compositor.h"
+#include <string.h>
+
+// led_wave for every 256th of a turn
+static const uint8_t raised_cosine[256] = {
+    255, 255, 255, 255, 254, 254, 254, 253, 253, 252, 251, 250, 250, 249, 248, 246,
+    245, 244, 243, 241, 240, 238, 237, 235, 234, 232, 230, 228, 226, 224, 222, 220,
+    218, 215, 213, 211, 208, 206, 203, 201, 198, 196, 193, 190, 188, 185, 182, 179,
+    176, 173, 170, 167, 165, 162, 158, 155, 152, 149, 146, 143, 140, 137, 134, 131,
+    128, 124, 121, 118, 115, 112, 109, 106, 103, 100, 97, 93, 90, 88, 85, 82,
+    79, 76, 73, 70, 67, 65, 62, 59, 57, 54, 52, 49, 47, 44, 42, 40,
+    37, 35, 33, 31, 29, 27, 25, 23, 21, 20, 18, 17, 15, 14, 12, 11,
+    10, 9, 7, 6, 5, 5, 4, 3, 2, 2, 1, 1, 1, 0, 0, 0,
+    0, 0, 0, 0, 1, 1, 1, 2, 2, 3, 4, 5, 5, 6, 7, 9,
+    10, 11, 12, 14, 15, 17, 18, 20, 21, 23, 25, 27, 29, 31, 33, 35,
+    37, 40, 42, 44, 47, 49, 52, 54, 57, 59, 62, 65, 67, 70, 73, 76,
+    79, 82, 85, 88, 90, 93, 97, 100, 103, 106, 109, 112, 115, 118, 121, 124,
+    127, 131, 134, 137, 140, 143, 146, 149, 152, 155, 158, 162, 165, 167, 170, 173,
+    176, 179, 182, 185, 188, 190, 193, 196, 198, 201, 203, 206, 208, 211, 213, 215,
+    218, 220, 222, 224, 226, 228, 230, 232, 234, 235, 237, 238, 240, 241, 243, 244,
+    245, 246, 248, 249, 250, 250, 251, 252, 253, 253, 254, 254, 254, 255, 255, 255,
+};
+
+uint32_t led_fraction(uint32_t position, uint32_t length) {
+    // Keep position << 16 in 32 bits
+    while (length > 0xFFFF) {
+        length >>= 1;
+        position >>= 1;
+    }
+    if (position >= length) {
+        return LED_FRACTION_ONE;
+    }
+    return (position << 16) / length;
+}
+
+uint8_t led_wave(uint16_t phase) {
+    return raised_cosine[phase >> 8];
+}
+
+static void blend_row(uint8_t* dest, const uint8_t* from, const uint8_t* to, uint16_t count, uint16_t amount) {
+    uint16_t keep = LED_BLEND_ONE - amount;
+    for (uint16_t i = 0; i < count; i++) {
+        dest[i] = (from[i] * keep + to[i] * amount) >> 8;
+    }
+}
+
+void led_frame_fill(led_frame_t* frame, uint8_t luma) {
+    memset(frame->luma, luma, sizeof(frame->luma));
+}
+
+void led_frame_blend(led_frame_t* dest, const led_frame_t* from, const led_frame_t* to, uint16_t amount) {
+    if (amount > LED_BLEND_ONE) {
+        amount = LED_BLEND_ONE;
+    }
+    // The rows follow each other, so the frame is blended as one long row
+    blend_row(&dest->luma[0][0], &from->luma[0][0], &to->luma[0][0],
+        LED_COMPOSITOR_ROWS * LED_COMPOSITOR_COLS, amount);
+}
+
+// The wave of index out of num, a full turn from the first to the last
+static uint8_t gradient_luma(uint16_t phase, uint8_t index, uint8_t num) {
+    return led_wave(phase - (uint16_t)(((uint32_t)index << 16) / (num - 1)));
+}
+
+void led_frame_column_gradient(led_frame_t* frame, uint16_t phase) {
+    for (uint8_t col = 0; col < LED_COMPOSITOR_COLS; col++) {
+        frame->luma[0][col] = gradient_luma(phase, col, LED_COMPOSITOR_COLS);
+    }
+    for (uint8_t row = 1; row < LED_COMPOSITOR_ROWS; row++) {
+        memcpy(frame->luma[row], frame->luma[0], LED_COMPOSITOR_COLS);
+    }
+}
+
+void led_frame_row_gradient(led_frame_t* frame, uint16_t phase) {
+    for (uint8_t row = 0; row < LED_COMPOSITOR_ROWS; row++) {
+        memset(frame->luma[row], gradient_luma(phase, row, LED_COMPOSITOR_ROWS), LED_COMPOSITOR_COLS);
+    }
+}
@@ -0,0 +1,61 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Fred Sundvik
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef TMK_VISUALIZER_LED_COMPOSITOR_H_
+#define TMK_VISUALIZER_LED_COMPOSITOR_H_
+
+#include <stdint.h>
+
+// The LED animations are drawn into frames of one luma byte per LED, row by
+// row, the same layout the LED display is blitted from
+
+// TODO: Should be customizable per keyboard
+#ifndef LED_COMPOSITOR_ROWS
+#define LED_COMPOSITOR_ROWS 7
+#endif
+#ifndef LED_COMPOSITOR_COLS
+#define LED_COMPOSITOR_COLS 7
+#endif
+
+typedef struct {
+    uint8_t luma[LED_COMPOSITOR_ROWS][LED_COMPOSITOR_COLS];
+} led_frame_t;
+
+// Fractions are in 1/65536ths, blend amounts in 1/256ths
+#define LED_FRACTION_ONE 0x10000
+#define LED_BLEND_ONE 0x100
+
+// position / length, without overflowing for long lengths
+uint32_t led_fraction(uint32_t position, uint32_t length);
+// 0.5 * (cos(phase) + 1), 0-255, the phase in 1/65536ths of a turn
+uint8_t led_wave(uint16_t phase);
+
+void led_frame_fill(led_frame_t* frame, uint8_t luma);
+// dest = from + (to - from) * amount, dest can be either of them
+void led_frame_blend(led_frame_t* dest, const led_frame_t* from, const led_frame_t* to, uint16_t amount);
+// A full cosine wave across the columns or the rows, moved on by phase
+void led_frame_column_gradient(led_frame_t* frame, uint16_t phase);
+void led_frame_row_gradient(led_frame_t* frame, uint16_t phase);
+
+#endif /* TMK_VISUALIZER_LED_COMPOSITOR_H_ */
@@ -22,8 +22,8 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 #include "led_test.h"
+#include "led_compositor.h"
 #include "gfx.h"
-#include "math.h"
 
 #define CROSSFADE_TIME 1000
 #define GRADIENT_TIME 3000
@@ -66,34 +66,31 @@ keyframe_animation_t led_test_animation = {
     },
 };
 
-static uint8_t fade_led_color(keyframe_animation_t* animation, int from, int to) {
+// The frame the LED display shows, the animations draw into it
+static led_frame_t led_frame;
+static led_frame_t crossfade_start_frame;
+static led_frame_t crossfade_end_frame;
+
+static void show_led_frame(void) {
+    gdispGBlitArea(LED_DISPLAY, 0, 0, LED_COMPOSITOR_COLS, LED_COMPOSITOR_ROWS,
+        0, 0, LED_COMPOSITOR_COLS, (const pixel_t*)&led_frame.luma[0][0]);
+}
+
+// How far into the current frame the animation is
+static uint32_t frame_fraction(keyframe_animation_t* animation) {
     int frame_length = animation->frame_lengths[animation->current_frame];
     int current_pos = frame_length - animation->time_left_in_frame;
-    int delta = to - from;
-    int luma = (delta * current_pos) / frame_length;
-    luma += from;
-    return luma;
+    if (current_pos < 0) {
+        current_pos = 0;
+    }
+    return led_fraction(current_pos, frame_length);
 }
 
 static void keyframe_fade_all_leds_from_to(keyframe_animation_t* animation, uint8_t from, uint8_t to) {
-    uint8_t luma = fade_led_color(animation, from, to);
-    color_t color = LUMA2COLOR(luma);
-    gdispGClear(LED_DISPLAY, color);
-}
-
-// TODO: Should be customizable per keyboard
-#define NUM_ROWS 7
-#define NUM_COLS 7
-
-static uint8_t crossfade_start_frame[NUM_ROWS][NUM_COLS];
-static uint8_t crossfade_end_frame[NUM_ROWS][NUM_COLS];
-
-static uint8_t compute_gradient_color(float t, float index, float num) {
-    const float two_pi = M_2_PI;
-    float normalized_index = (1.0f - index / (num - 1.0f)) * two_pi;
-    float x = t * two_pi + normalized_index;
-    float v = 0.5 * (cosf(x) + 1.0f);
-    return (uint8_t)(255.0f * v);
+    uint32_t fraction = frame_fraction(animation);
+    uint8_t luma = (from * (LED_FRACTION_ONE - fraction) + to * fraction) >> 16;
+    led_frame_fill(&led_frame, luma);
+    show_led_frame();
 }
 
 bool keyframe_fade_in_all_leds(keyframe_animation_t* animation, visualizer_state_t* state) {
@@ -110,48 +107,27 @@ bool keyframe_fade_out_all_leds(keyframe_animation_t* animation, visualizer_stat
 
 bool keyframe_led_left_to_right_gradient(keyframe_animation_t* animation, visualizer_state_t* state) {
     (void)state;
-    float frame_length = animation->frame_lengths[animation->current_frame];
-    float current_pos = frame_length - animation->time_left_in_frame;
-    float t = current_pos / frame_length;
-    for (int i=0; i< NUM_COLS; i++) {
-        uint8_t color = compute_gradient_color(t, i, NUM_COLS);
-        gdispGDrawLine(LED_DISPLAY, i, 0, i, NUM_ROWS - 1, LUMA2COLOR(color));
-    }
+    led_frame_column_gradient(&led_frame, frame_fraction(animation));
+    show_led_frame();
     return true;
 }
 
 bool keyframe_led_top_to_bottom_gradient(keyframe_animation_t* animation, visualizer_state_t* state) {
     (void)state;
-    float frame_length = animation->frame_lengths[animation->current_frame];
-    float current_pos = frame_length - animation->time_left_in_frame;
-    float t = current_pos / frame_length;
-    for (int i=0; i< NUM_ROWS; i++) {
-        uint8_t color = compute_gradient_color(t, i, NUM_ROWS);
-        gdispGDrawLine(LED_DISPLAY, 0, i, NUM_COLS - 1, i, LUMA2COLOR(color));
-    }
+    led_frame_row_gradient(&led_frame, frame_fraction(animation));
+    show_led_frame();
     return true;
 }
 
-static void copy_current_led_state(uint8_t* dest) {
-    for (int i=0;i<NUM_ROWS;i++) {
-        for (int j=0;j<NUM_COLS;j++) {
-            dest[i*NUM_COLS + j] = gdispGGetPixelColor(LED_DISPLAY, j, i);
-        }
-    }
-}
 bool keyframe_led_crossfade(keyframe_animation_t* animation, visualizer_state_t* state) {
     (void)state;
     if (animation->first_update_of_frame) {
-        copy_current_led_state(&crossfade_start_frame[0][0]);
+        crossfade_start_frame = led_frame;
         run_next_keyframe(animation, state);
-        copy_current_led_state(&crossfade_end_frame[0][0]);
-    }
-    for (int i=0;i<NUM_ROWS;i++) {
-        for (int j=0;j<NUM_COLS;j++) {
-            color_t color  = LUMA2COLOR(fade_led_color(animation, crossfade_start_frame[i][j], crossfade_end_frame[i][j]));
-            gdispGDrawPixel(LED_DISPLAY, j, i, color);
-        }
+        crossfade_end_frame = led_frame;
     }
+    led_frame_blend(&led_frame, &crossfade_start_frame, &crossfade_end_frame, frame_fraction(animation) >> 8);
+    show_led_frame();
     return true;
 }
 
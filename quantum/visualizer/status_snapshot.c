@@ -0,0 +1,100 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Fred Sundvik
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "status_snapshot.h"
+
+bool status_snapshot_same(const visualizer_keyboard_status_t* status1, const visualizer_keyboard_status_t* status2) {
+    return status1->layer == status2->layer &&
+        status1->default_layer == status2->default_layer &&
+        status1->leds == status2->leds &&
+        status1->suspended == status2->suspended;
+}
+
+void status_sender_init(status_sender_t* sender, const visualizer_keyboard_status_t* status, uint16_t now) {
+    sender->snapshot.version = 0;
+    sender->snapshot.status = *status;
+    sender->pending = true;
+    // So that the first snapshot goes out right away
+    sender->last_sent = now - VISUALIZER_STATUS_COALESCE;
+}
+
+static void set_pending(status_sender_t* sender) {
+    // Changes waiting for the next send share a version
+    if (!sender->pending) {
+        sender->snapshot.version++;
+        sender->pending = true;
+    }
+}
+
+void status_sender_update(status_sender_t* sender, const visualizer_keyboard_status_t* status) {
+    if (status_snapshot_same(&sender->snapshot.status, status)) {
+        return;
+    }
+    sender->snapshot.status = *status;
+    set_pending(sender);
+}
+
+void status_sender_resync(status_sender_t* sender) {
+    // As a new version, since the slaves that already have the snapshot
+    // only look at the new ones, they just compare it
+    set_pending(sender);
+}
+
+const status_snapshot_t* status_sender_poll(status_sender_t* sender, uint16_t now) {
+    uint16_t elapsed = now - sender->last_sent;
+    if (sender->pending) {
+        if (elapsed < VISUALIZER_STATUS_COALESCE) {
+            return NULL;
+        }
+    }
+    else if (VISUALIZER_STATUS_REFRESH == 0 || elapsed < VISUALIZER_STATUS_REFRESH) {
+        return NULL;
+    }
+    sender->pending = false;
+    sender->last_sent = now;
+    return &sender->snapshot;
+}
+
+const status_snapshot_t* status_sender_flush(status_sender_t* sender, uint16_t now) {
+    if (!sender->pending) {
+        return status_sender_poll(sender, now);
+    }
+    sender->pending = false;
+    sender->last_sent = now;
+    return &sender->snapshot;
+}
+
+bool status_receiver_receive(status_receiver_t* receiver, const status_snapshot_t* snapshot) {
+    int16_t ahead = snapshot->version - receiver->version;
+    if (receiver->synced && ahead == 0) {
+        return false;
+    }
+    // An older version means the master restarted, start over from it
+    if (receiver->synced && ahead > 1) {
+        receiver->missed += ahead - 1;
+    }
+    receiver->synced = true;
+    receiver->version = snapshot->version;
+    return true;
+}
@@ -0,0 +1,86 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Fred Sundvik
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef TMK_VISUALIZER_STATUS_SNAPSHOT_H_
+#define TMK_VISUALIZER_STATUS_SNAPSHOT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "visualizer.h"
+
+// The keyboard status is sent from the master to the slaves as a snapshot,
+// only when it changed. The changes in the same VISUALIZER_STATUS_COALESCE
+// milliseconds go out together, as the last status. The version goes up by
+// one for every status sent, so the slaves can tell the new ones from the
+// repeats, and count the ones they missed. A slave without a snapshot asks
+// for one every VISUALIZER_STATUS_RETRY milliseconds, so the ones connected
+// later get it too. Repeating the snapshot every VISUALIZER_STATUS_REFRESH
+// milliseconds, for slaves that lost the last one, is off with 0.
+
+#ifndef VISUALIZER_STATUS_COALESCE
+#define VISUALIZER_STATUS_COALESCE VISUALIZER_UPDATE_INTERVAL
+#endif
+#ifndef VISUALIZER_STATUS_REFRESH
+#define VISUALIZER_STATUS_REFRESH 0
+#endif
+#ifndef VISUALIZER_STATUS_RETRY
+#define VISUALIZER_STATUS_RETRY 100
+#endif
+
+typedef struct {
+    uint16_t version;
+    visualizer_keyboard_status_t status;
+} status_snapshot_t;
+
+typedef struct {
+    status_snapshot_t snapshot;
+    // Changed since the snapshot was last sent
+    bool pending;
+    uint16_t last_sent;
+} status_sender_t;
+
+typedef struct {
+    uint16_t version;
+    bool synced;
+    // Versions that never arrived
+    uint16_t missed;
+} status_receiver_t;
+
+bool status_snapshot_same(const visualizer_keyboard_status_t* status1, const visualizer_keyboard_status_t* status2);
+
+void status_sender_init(status_sender_t* sender, const visualizer_keyboard_status_t* status, uint16_t now);
+// Records the current status, a new version if it changed
+void status_sender_update(status_sender_t* sender, const visualizer_keyboard_status_t* status);
+// Sends the snapshot again with the next poll, for a slave that asked for it
+void status_sender_resync(status_sender_t* sender);
+// The snapshot to send at now ms, or NULL if there's nothing to send
+const status_snapshot_t* status_sender_poll(status_sender_t* sender, uint16_t now);
+// The same, but a changed status is sent without waiting out the coalesce
+// time, for the changes the main loop won't poll for
+const status_snapshot_t* status_sender_flush(status_sender_t* sender, uint16_t now);
+
+// True if the snapshot is a newer version than the last one received
+bool status_receiver_receive(status_receiver_t* receiver, const status_snapshot_t* snapshot);
+
+#endif /* TMK_VISUALIZER_STATUS_SNAPSHOT_H_ */
@@ -0,0 +1,121 @@
+#include "gtest/gtest.h"
+#include <cstring>
+extern "C" {
+#include "display_shadow.h"
+}
+
+// Flushes like the ST7565 driver, a display with two buffers, which shows the
+// one written last, and counts the bytes it would send
+class DisplayShadow : public testing::Test {
+public:
+    static const int pages = 4;
+    static const int width = 128;
+
+    DisplayShadow() {
+        memset(ram, 0, sizeof(ram));
+        memset(shadow, 0xFF, sizeof(shadow));
+        buffer = 0;
+        writes = 0;
+    }
+
+    void flush() {
+        bool sent = false;
+        for (int p = 0; p < pages; p++) {
+            uint16_t first, last;
+            if (display_shadow_update(shadow[buffer][p], ram[p], width, &first, &last)) {
+                sent = true;
+                writes += 4 + last - first + 1;
+            }
+        }
+        if (!sent && memcmp(shadow[!buffer], ram, sizeof(ram)) == 0) {
+            return;
+        }
+        writes++;
+        buffer = !buffer;
+    }
+
+    void clear() {
+        memset(ram, 0, sizeof(ram));
+    }
+
+    void draw_text(const char* text) {
+        for (int i = 0; text[i]; i++) {
+            for (int col = 0; col < 6; col++) {
+                ram[1][i * 6 + col] = text[i] + col;
+                ram[2][i * 6 + col] = text[i] - col;
+            }
+        }
+    }
+
+    uint8_t ram[pages][width];
+    uint8_t shadow[2][pages][width];
+    int buffer;
+    int writes;
+};
+
+TEST_F(DisplayShadow, the_first_flush_sends_everything) {
+    flush();
+    EXPECT_EQ(writes, pages * (4 + width) + 1);
+}
+
+TEST_F(DisplayShadow, an_identical_redraw_sends_nothing) {
+    draw_text("Layer 1");
+    flush();
+    flush();
+    writes = 0;
+    clear();
+    draw_text("Layer 1");
+    flush();
+    EXPECT_EQ(writes, 0);
+    flush();
+    EXPECT_EQ(writes, 0);
+}
+
+TEST_F(DisplayShadow, only_the_differing_columns_are_sent) {
+    draw_text("Layer 1");
+    flush();
+    flush();
+    writes = 0;
+    clear();
+    draw_text("Layer 2");
+    flush();
+    // The last character on the two pages the text covers, and the switch
+    EXPECT_EQ(writes, 2 * (4 + 6) + 1);
+}
+
+TEST_F(DisplayShadow, both_buffers_are_brought_up_to_date) {
+    flush();
+    flush();
+    draw_text("Layer 2");
+    flush();
+    writes = 0;
+    flush();
+    EXPECT_GT(writes, 0);
+    writes = 0;
+    flush();
+    EXPECT_EQ(writes, 0);
+}
+
+TEST_F(DisplayShadow, drawing_back_what_is_shown_only_switches_buffers) {
+    flush();
+    flush();
+    draw_text("Layer 2");
+    flush();
+    clear();
+    writes = 0;
+    // The other buffer still has the cleared screen
+    flush();
+    EXPECT_EQ(writes, 1);
+    EXPECT_EQ(memcmp(shadow[!buffer], ram, sizeof(ram)), 0);
+}
+
+TEST(DisplayShadowUpdate, returns_the_span_and_updates_the_shadow) {
+    uint8_t shadow[8] = {0};
+    uint8_t ram[8] = {0, 0, 1, 0, 0, 2, 0, 0};
+    uint16_t first = 99, last = 99;
+    EXPECT_TRUE(display_shadow_update(shadow, ram, 8, &first, &last));
+    EXPECT_EQ(first, 2);
+    EXPECT_EQ(last, 5);
+    EXPECT_EQ(memcmp(shadow, ram, 8), 0);
+    EXPECT_FALSE(display_shadow_update(shadow, ram, 8, &first, &last));
+}
@@ -0,0 +1,16 @@
+// Just enough of uGFX for the keyframe timeline, the tests set the time
+#ifndef GFX_H
+#define GFX_H
+
+#include <stdint.h>
+
+// Narrower than any real one, so the tests can wrap around
+typedef uint16_t systemticks_t;
+#define TIME_INFINITE ((systemticks_t)-1)
+#define gfxMillisecondsToTicks(ms) ((systemticks_t)(ms))
+
+typedef struct GDisplay GDisplay;
+
+systemticks_t gfxSystemTicks(void);
+
+#endif
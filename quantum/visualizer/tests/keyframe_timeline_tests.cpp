@@ -0,0 +1,184 @@
+#include "gtest/gtest.h"
+#include <string>
+#include <vector>
+extern "C" {
+#include "visualizer.h"
+}
+
+static systemticks_t now;
+
+extern "C" systemticks_t gfxSystemTicks(void) {
+    return now;
+}
+
+struct FrameCall {
+    std::string animation;
+    int frame;
+    systemticks_t time;
+};
+
+static std::vector<FrameCall> calls;
+static bool keep_updating;
+
+// The animations are told apart by their first frame length
+static std::string name_of(keyframe_animation_t* animation) {
+    return "a" + std::to_string(animation->frame_lengths[0]);
+}
+
+static bool record_frame(keyframe_animation_t* animation, visualizer_state_t* state) {
+    (void)state;
+    calls.push_back({name_of(animation), animation->current_frame, now});
+    return keep_updating;
+}
+
+static keyframe_animation_t make_animation(int first, int second, bool loop) {
+    keyframe_animation_t animation = {};
+    animation.num_frames = 2;
+    animation.loop = loop;
+    animation.frame_lengths[0] = first;
+    animation.frame_lengths[1] = second;
+    animation.frame_functions[0] = record_frame;
+    animation.frame_functions[1] = record_frame;
+    return animation;
+}
+
+class KeyframeTimeline : public testing::Test {
+public:
+    void SetUp() override {
+        now = 1000;
+        calls.clear();
+        keep_updating = false;
+    }
+    void TearDown() override {
+        stop_all_keyframe_animations();
+    }
+    // Updates when asked to, like the visualizer thread, until time end
+    void run_until(systemticks_t end) {
+        while (true) {
+            systemticks_t sleep = update_keyframe_animations(&state, now);
+            if (sleep == TIME_INFINITE || (systemticks_t)(end - now) < sleep) {
+                now = end;
+                return;
+            }
+            now += sleep;
+        }
+    }
+    visualizer_state_t state = {};
+};
+
+TEST_F(KeyframeTimeline, the_frames_of_an_animation_run_in_turn) {
+    keyframe_animation_t animation = make_animation(10, 20, false);
+    start_keyframe_animation(&animation);
+    EXPECT_EQ(update_keyframe_animations(&state, now), 10);
+    ASSERT_EQ(calls.size(), 1u);
+    EXPECT_EQ(calls[0].frame, 0);
+    run_until(1100);
+    ASSERT_EQ(calls.size(), 2u);
+    EXPECT_EQ(calls[1].frame, 1);
+    EXPECT_EQ(calls[1].time, 1010);
+    EXPECT_EQ(update_keyframe_animations(&state, now), TIME_INFINITE);
+}
+
+TEST_F(KeyframeTimeline, the_thread_sleeps_until_the_earliest_animation_is_due) {
+    keyframe_animation_t slow = make_animation(50, 50, true);
+    keyframe_animation_t fast = make_animation(7, 7, true);
+    start_keyframe_animation(&slow);
+    start_keyframe_animation(&fast);
+    EXPECT_EQ(update_keyframe_animations(&state, now), 7);
+    now += 3;
+    // Woken up early, by a key press say, nothing is due
+    calls.clear();
+    EXPECT_EQ(update_keyframe_animations(&state, now), 4);
+    EXPECT_TRUE(calls.empty());
+    now += 4;
+    EXPECT_EQ(update_keyframe_animations(&state, now), 7);
+    ASSERT_EQ(calls.size(), 1u);
+    EXPECT_EQ(calls[0].animation, "a7");
+}
+
+TEST_F(KeyframeTimeline, more_than_four_animations_run_at_once) {
+    std::vector<keyframe_animation_t> animations;
+    for (int i = 0; i < VISUALIZER_MAX_ANIMATIONS; i++) {
+        animations.push_back(make_animation(10 + i, 100, false));
+    }
+    for (auto& animation : animations) {
+        start_keyframe_animation(&animation);
+    }
+    run_until(1050);
+    for (int i = 0; i < VISUALIZER_MAX_ANIMATIONS; i++) {
+        int frames = 0;
+        for (auto& call : calls) {
+            if (call.animation == "a" + std::to_string(10 + i)) {
+                frames++;
+                if (call.frame == 1) {
+                    EXPECT_EQ(call.time, 1000 + 10 + i);
+                }
+            }
+        }
+        EXPECT_EQ(frames, 2) << "animation " << i;
+    }
+}
+
+TEST_F(KeyframeTimeline, continuous_frames_update_every_interval) {
+    keyframe_animation_t animation = make_animation(100, 100, false);
+    animation.update_interval = 25;
+    keep_updating = true;
+    start_keyframe_animation(&animation);
+    run_until(1099);
+    std::vector<systemticks_t> times;
+    for (auto& call : calls) {
+        times.push_back(call.time);
+    }
+    EXPECT_EQ(times, (std::vector<systemticks_t>{1000, 1025, 1050, 1075}));
+}
+
+TEST_F(KeyframeTimeline, continuous_frames_default_to_the_update_interval) {
+    keyframe_animation_t animation = make_animation(100, 100, false);
+    keep_updating = true;
+    start_keyframe_animation(&animation);
+    EXPECT_EQ(update_keyframe_animations(&state, now), VISUALIZER_UPDATE_INTERVAL);
+}
+
+TEST_F(KeyframeTimeline, a_stopped_animation_no_longer_runs) {
+    keyframe_animation_t first = make_animation(10, 10, true);
+    keyframe_animation_t second = make_animation(15, 15, true);
+    start_keyframe_animation(&first);
+    start_keyframe_animation(&second);
+    update_keyframe_animations(&state, now);
+    stop_keyframe_animation(&first);
+    calls.clear();
+    run_until(1100);
+    for (auto& call : calls) {
+        EXPECT_EQ(call.animation, "a15");
+    }
+    EXPECT_FALSE(calls.empty());
+    stop_all_keyframe_animations();
+    EXPECT_EQ(update_keyframe_animations(&state, now), TIME_INFINITE);
+}
+
+TEST_F(KeyframeTimeline, restarting_an_animation_starts_it_over) {
+    keyframe_animation_t animation = make_animation(10, 20, false);
+    start_keyframe_animation(&animation);
+    run_until(1015);
+    start_keyframe_animation(&animation);
+    calls.clear();
+    update_keyframe_animations(&state, now);
+    ASSERT_EQ(calls.size(), 1u);
+    EXPECT_EQ(calls[0].frame, 0);
+    EXPECT_EQ(update_keyframe_animations(&state, now), 10);
+}
+
+TEST_F(KeyframeTimeline, deadlines_wrap_around_with_the_ticks) {
+    now = 0xFFF0;
+    keyframe_animation_t late = make_animation(40, 40, false);
+    keyframe_animation_t early = make_animation(30, 30, false);
+    start_keyframe_animation(&late);
+    start_keyframe_animation(&early);
+    EXPECT_EQ(update_keyframe_animations(&state, now), 30);
+    run_until(0x0100);
+    ASSERT_EQ(calls.size(), 4u);
+    EXPECT_EQ(calls[2].animation, "a30");
+    EXPECT_EQ(calls[2].time, 0x000E);
+    EXPECT_EQ(calls[3].animation, "a40");
+    EXPECT_EQ(calls[3].time, 0x0018);
+}
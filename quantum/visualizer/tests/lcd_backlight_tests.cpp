@@ -0,0 +1,122 @@
+#include "gtest/gtest.h"
+#include <cmath>
+#include <cstdlib>
+extern "C" {
+#include "lcd_backlight.h"
+}
+
+static uint16_t hal_r, hal_g, hal_b;
+
+extern "C" void lcd_backlight_hal_init(void) {
+}
+
+extern "C" void lcd_backlight_hal_color(uint16_t r, uint16_t g, uint16_t b) {
+    hal_r = r;
+    hal_g = g;
+    hal_b = b;
+}
+
+// The float version this replaced
+static void float_hsi_to_rgb(float h, float s, float i, uint16_t* r_out, uint16_t* g_out, uint16_t* b_out) {
+    unsigned int r, g, b;
+    h = fmodf(h, 360.0f);
+    h = 3.14159f * h / 180.0f;
+    s = s > 0.0f ? (s < 1.0f ? s : 1.0f) : 0.0f;
+    i = i > 0.0f ? (i < 1.0f ? i : 1.0f) : 0.0f;
+
+    if(h < 2.09439f) {
+        r = 65535.0f * i/3.0f *(1.0f + s * cos(h) / cosf(1.047196667f - h));
+        g = 65535.0f * i/3.0f *(1.0f + s *(1.0f - cosf(h) / cos(1.047196667f - h)));
+        b = 65535.0f * i/3.0f *(1.0f - s);
+    } else if(h < 4.188787) {
+        h = h - 2.09439;
+        g = 65535.0f * i/3.0f *(1.0f + s * cosf(h) / cosf(1.047196667f - h));
+        b = 65535.0f * i/3.0f *(1.0f + s * (1.0f - cosf(h) / cosf(1.047196667f - h)));
+        r = 65535.0f * i/3.0f *(1.0f - s);
+    } else {
+        h = h - 4.188787;
+        b = 65535.0f*i/3.0f * (1.0f + s * cosf(h) / cosf(1.047196667f - h));
+        r = 65535.0f*i/3.0f * (1.0f + s * (1.0f - cosf(h) / cosf(1.047196667f - h)));
+        g = 65535.0f*i/3.0f * (1.0f - s);
+    }
+    *r_out = r > 65535 ? 65535 : r;
+    *g_out = g > 65535 ? 65535 : g;
+    *b_out = b > 65535 ? 65535 : b;
+}
+
+static void float_color(uint8_t hue, uint8_t saturation, uint8_t intensity, uint8_t brightness, uint16_t* r, uint16_t* g, uint16_t* b) {
+    float hue_f = 360.0f * (float)hue / 255.0f;
+    float saturation_f = (float)saturation / 255.0f;
+    float intensity_f = (float)intensity / 255.0f;
+    intensity_f *= (float)brightness / 255.0f;
+    float_hsi_to_rgb(hue_f, saturation_f, intensity_f, r, g, b);
+}
+
+TEST(LcdBacklight, every_color_matches_the_float_version) {
+    for (int hue = 0; hue < 256; hue++) {
+        for (int saturation = 0; saturation < 256; saturation += 15) {
+            for (int intensity = 0; intensity < 256; intensity += 51) {
+                uint16_t r, g, b;
+                float_color(hue, saturation, intensity, 0xFF, &r, &g, &b);
+                lcd_backlight_brightness(0xFF);
+                lcd_backlight_color(hue, saturation, intensity);
+                ASSERT_NEAR(hal_r, r, 4) << hue << " " << saturation << " " << intensity;
+                ASSERT_NEAR(hal_g, g, 4) << hue << " " << saturation << " " << intensity;
+                ASSERT_NEAR(hal_b, b, 4) << hue << " " << saturation << " " << intensity;
+            }
+        }
+    }
+}
+
+TEST(LcdBacklight, the_brightness_scales_the_intensity_like_the_float_version) {
+    for (int brightness = 0; brightness < 256; brightness += 17) {
+        for (int hue = 0; hue < 256; hue += 7) {
+            uint16_t r, g, b;
+            float_color(hue, 0xC0, 0xE0, brightness, &r, &g, &b);
+            lcd_backlight_brightness(brightness);
+            lcd_backlight_color(hue, 0xC0, 0xE0);
+            ASSERT_NEAR(hal_r, r, 4) << hue << " " << brightness;
+            ASSERT_NEAR(hal_g, g, 4) << hue << " " << brightness;
+            ASSERT_NEAR(hal_b, b, 4) << hue << " " << brightness;
+        }
+    }
+}
+
+TEST(LcdBacklight, the_channels_add_up_to_the_intensity) {
+    for (int hue = 0; hue < 256; hue++) {
+        uint16_t r, g, b;
+        lcd_backlight_hsi_to_rgb(hue, 0xFF, 0xFFFF, &r, &g, &b);
+        EXPECT_NEAR(r + g + b, 0xFFFF, 3) << hue;
+    }
+}
+
+TEST(LcdBacklight, interpolation_goes_from_one_color_to_the_other) {
+    uint32_t from = LCD_COLOR(0x10, 0x20, 0x30);
+    uint32_t to = LCD_COLOR(0x50, 0x00, 0xF0);
+    EXPECT_EQ(lcd_color_interpolate(from, to, 0, 100), from);
+    EXPECT_EQ(lcd_color_interpolate(from, to, 50, 100), LCD_COLOR(0x30, 0x10, 0x90));
+    EXPECT_EQ(lcd_color_interpolate(from, to, 100, 100), to);
+}
+
+TEST(LcdBacklight, interpolation_matches_dividing_every_channel) {
+    uint32_t from = LCD_COLOR(0x23, 0xF1, 0x07);
+    uint32_t to = LCD_COLOR(0x71, 0x11, 0xFE);
+    for (int position = 0; position <= 1000; position++) {
+        uint32_t color = lcd_color_interpolate(from, to, position, 1000);
+        ASSERT_NEAR(LCD_HUE(color), 0x23 + (0x71 - 0x23) * position / 1000, 1) << position;
+        ASSERT_NEAR(LCD_SAT(color), 0xF1 + (0x11 - 0xF1) * position / 1000, 1) << position;
+        ASSERT_NEAR(LCD_INT(color), 0x07 + (0xFE - 0x07) * position / 1000, 1) << position;
+    }
+}
+
+TEST(LcdBacklight, interpolation_takes_the_shortest_way_around_the_hue) {
+    EXPECT_EQ(LCD_HUE(lcd_color_interpolate(LCD_COLOR(0xFA, 0, 0), LCD_COLOR(0x05, 0, 0), 50, 100)), 0xFF);
+    EXPECT_EQ(LCD_HUE(lcd_color_interpolate(LCD_COLOR(0x05, 0, 0), LCD_COLOR(0xFA, 0, 0), 50, 100)), 0x00);
+}
+
+TEST(LcdBacklight, long_frames_interpolate_too) {
+    uint32_t from = LCD_COLOR(0x00, 0x00, 0x00);
+    uint32_t to = LCD_COLOR(0x60, 0x80, 0x80);
+    // Five seconds of 100 kHz ticks
+    EXPECT_EQ(lcd_color_interpolate(from, to, 250000, 500000), LCD_COLOR(0x30, 0x40, 0x40));
+}
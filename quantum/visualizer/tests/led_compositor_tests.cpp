@@ -0,0 +1,85 @@
+#include "gtest/gtest.h"
+#include <cmath>
+#include <cstring>
+extern "C" {
+#include "led_compositor.h"
+}
+
+// The float gradient this replaced, with a full turn from the first to the last
+static uint8_t float_gradient(float t, float index, float num) {
+    const float two_pi = 2.0f * M_PI;
+    float x = t * two_pi + (1.0f - index / (num - 1.0f)) * two_pi;
+    return 255.0f * 0.5f * (cosf(x) + 1.0f);
+}
+
+TEST(LedCompositor, the_wave_matches_the_cosine) {
+    for (int phase = 0; phase < 0x10000; phase += 0x100) {
+        ASSERT_NEAR(led_wave(phase), float_gradient(phase / 65536.0f, 0, 2), 1) << phase;
+    }
+}
+
+TEST(LedCompositor, fill_sets_every_led) {
+    led_frame_t frame;
+    led_frame_fill(&frame, 0x5A);
+    for (int row = 0; row < LED_COMPOSITOR_ROWS; row++) {
+        for (int col = 0; col < LED_COMPOSITOR_COLS; col++) {
+            ASSERT_EQ(frame.luma[row][col], 0x5A);
+        }
+    }
+}
+
+TEST(LedCompositor, blend_goes_from_one_frame_to_the_other) {
+    led_frame_t from, to, dest;
+    for (int row = 0; row < LED_COMPOSITOR_ROWS; row++) {
+        for (int col = 0; col < LED_COMPOSITOR_COLS; col++) {
+            from.luma[row][col] = row * 40;
+            to.luma[row][col] = 255 - col * 40;
+        }
+    }
+    led_frame_blend(&dest, &from, &to, 0);
+    EXPECT_EQ(memcmp(&dest, &from, sizeof(dest)), 0);
+    led_frame_blend(&dest, &from, &to, LED_BLEND_ONE);
+    EXPECT_EQ(memcmp(&dest, &to, sizeof(dest)), 0);
+    for (int amount = 0; amount <= LED_BLEND_ONE; amount++) {
+        led_frame_blend(&dest, &from, &to, amount);
+        for (int row = 0; row < LED_COMPOSITOR_ROWS; row++) {
+            for (int col = 0; col < LED_COMPOSITOR_COLS; col++) {
+                int expected = from.luma[row][col] + (to.luma[row][col] - from.luma[row][col]) * amount / 256;
+                ASSERT_NEAR(dest.luma[row][col], expected, 1) << amount;
+            }
+        }
+    }
+}
+
+TEST(LedCompositor, blend_can_write_over_its_source) {
+    led_frame_t from, to;
+    led_frame_fill(&from, 0);
+    led_frame_fill(&to, 200);
+    led_frame_blend(&from, &from, &to, LED_BLEND_ONE / 2);
+    EXPECT_EQ(from.luma[LED_COMPOSITOR_ROWS - 1][LED_COMPOSITOR_COLS - 1], 100);
+}
+
+TEST(LedCompositor, gradients_match_the_float_version) {
+    led_frame_t columns, rows;
+    for (int position = 0; position <= 3000; position += 7) {
+        uint32_t fraction = led_fraction(position, 3000);
+        led_frame_column_gradient(&columns, fraction);
+        led_frame_row_gradient(&rows, fraction);
+        float t = position / 3000.0f;
+        for (int row = 0; row < LED_COMPOSITOR_ROWS; row++) {
+            for (int col = 0; col < LED_COMPOSITOR_COLS; col++) {
+                ASSERT_NEAR(columns.luma[row][col], float_gradient(t, col, LED_COMPOSITOR_COLS), 4) << position;
+                ASSERT_NEAR(rows.luma[row][col], float_gradient(t, row, LED_COMPOSITOR_ROWS), 4) << position;
+            }
+        }
+    }
+}
+
+TEST(LedCompositor, fractions_of_long_frames) {
+    EXPECT_EQ(led_fraction(0, 100), 0u);
+    EXPECT_EQ(led_fraction(50, 100), LED_FRACTION_ONE / 2);
+    EXPECT_EQ(led_fraction(100, 100), (uint32_t)LED_FRACTION_ONE);
+    EXPECT_EQ(led_fraction(150, 100), (uint32_t)LED_FRACTION_ONE);
+    // Three seconds of 100 kHz ticks
+    EXPECT_EQ(led_fraction(150000, 300000), LED_FRACTION_ONE / 2);
+}
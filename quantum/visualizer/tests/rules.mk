@@ -0,0 +1,29 @@
+display_shadow_INC := $(QUANTUM_PATH)/visualizer
+display_shadow_SRC :=\
+	$(QUANTUM_PATH)/visualizer/tests/display_shadow_tests.cpp \
+	$(QUANTUM_PATH)/visualizer/display_shadow.c
+
+keyframe_timeline_INC := $(QUANTUM_PATH)/visualizer/tests $(QUANTUM_PATH)/visualizer
+keyframe_timeline_SRC :=\
+	$(QUANTUM_PATH)/visualizer/tests/keyframe_timeline_tests.cpp \
+	$(QUANTUM_PATH)/visualizer/keyframe_timeline.c
+
+lcd_backlight_INC := $(QUANTUM_PATH)/visualizer
+lcd_backlight_SRC :=\
+	$(QUANTUM_PATH)/visualizer/tests/lcd_backlight_tests.cpp \
+	$(QUANTUM_PATH)/visualizer/lcd_backlight.c
+
+led_compositor_INC := $(QUANTUM_PATH)/visualizer
+led_compositor_SRC :=\
+	$(QUANTUM_PATH)/visualizer/tests/led_compositor_tests.cpp \
+	$(QUANTUM_PATH)/visualizer/led_compositor.c
+
+status_snapshot_INC := $(QUANTUM_PATH)/visualizer/tests $(QUANTUM_PATH)/visualizer
+status_snapshot_SRC :=\
+	$(QUANTUM_PATH)/visualizer/tests/status_snapshot_tests.cpp \
+	$(QUANTUM_PATH)/visualizer/status_snapshot.c
+
+# The same with the periodic refresh on
+status_snapshot_refresh_DEFS := -DVISUALIZER_STATUS_REFRESH=500
+status_snapshot_refresh_INC := $(status_snapshot_INC)
+status_snapshot_refresh_SRC := $(status_snapshot_SRC)
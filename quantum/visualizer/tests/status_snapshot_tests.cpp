@@ -0,0 +1,158 @@
+#include "gtest/gtest.h"
+extern "C" {
+#include "status_snapshot.h"
+}
+
+static visualizer_keyboard_status_t make_status(uint32_t layer, bool suspended = false) {
+    visualizer_keyboard_status_t status = {};
+    status.layer = layer;
+    status.suspended = suspended;
+    return status;
+}
+
+class StatusSnapshot : public testing::Test {
+public:
+    void SetUp() override {
+        now = 1000;
+        status = make_status(1);
+        status_sender_init(&sender, &status, now);
+        receiver = {};
+        // The first snapshot goes out right away
+        const status_snapshot_t* snapshot = status_sender_poll(&sender, now);
+        EXPECT_NE(snapshot, nullptr);
+        if (snapshot) {
+            EXPECT_TRUE(status_receiver_receive(&receiver, snapshot));
+        }
+    }
+    // Polls once a millisecond, like keyboard_task, until end, counting the sends
+    int run_until(uint16_t end) {
+        int sent = 0;
+        while (now != end) {
+            now++;
+            status_sender_update(&sender, &status);
+            if (status_sender_poll(&sender, now)) {
+                sent++;
+            }
+        }
+        return sent;
+    }
+    uint16_t now;
+    visualizer_keyboard_status_t status;
+    status_sender_t sender;
+    status_receiver_t receiver;
+};
+
+#if VISUALIZER_STATUS_REFRESH == 0
+TEST_F(StatusSnapshot, an_idle_keyboard_sends_nothing) {
+    EXPECT_EQ(run_until(now + 10000), 0);
+    EXPECT_EQ(sender.snapshot.version, 0);
+}
+#else
+TEST_F(StatusSnapshot, an_idle_keyboard_only_sends_the_refresh) {
+    EXPECT_EQ(run_until(now + VISUALIZER_STATUS_REFRESH * 4), 4);
+    EXPECT_EQ(sender.snapshot.version, 0);
+}
+#endif
+
+TEST_F(StatusSnapshot, a_change_is_sent_within_the_coalesce_time) {
+    run_until(now + 100);
+    status = make_status(2);
+    status_sender_update(&sender, &status);
+    const status_snapshot_t* snapshot = status_sender_poll(&sender, now);
+    ASSERT_NE(snapshot, nullptr);
+    EXPECT_EQ(snapshot->version, 1);
+    EXPECT_EQ(snapshot->status.layer, 2u);
+}
+
+TEST_F(StatusSnapshot, changes_close_together_are_sent_as_one) {
+    status = make_status(2);
+    status_sender_update(&sender, &status);
+    EXPECT_EQ(status_sender_poll(&sender, now), nullptr);
+    status = make_status(3);
+    status_sender_update(&sender, &status);
+    status = make_status(4, true);
+    EXPECT_EQ(run_until(now + VISUALIZER_STATUS_COALESCE), 1);
+    EXPECT_EQ(sender.snapshot.version, 1);
+    EXPECT_EQ(sender.snapshot.status.layer, 4u);
+    EXPECT_TRUE(sender.snapshot.status.suspended);
+}
+
+TEST_F(StatusSnapshot, the_receiver_ignores_repeats) {
+    status_snapshot_t snapshot = sender.snapshot;
+    EXPECT_FALSE(status_receiver_receive(&receiver, &snapshot));
+    snapshot.version++;
+    EXPECT_TRUE(status_receiver_receive(&receiver, &snapshot));
+    EXPECT_FALSE(status_receiver_receive(&receiver, &snapshot));
+    EXPECT_EQ(receiver.missed, 0);
+}
+
+TEST_F(StatusSnapshot, the_receiver_counts_missed_versions) {
+    status_snapshot_t snapshot = sender.snapshot;
+    snapshot.version += 3;
+    EXPECT_TRUE(status_receiver_receive(&receiver, &snapshot));
+    EXPECT_EQ(receiver.missed, 2);
+    snapshot.version = 0xFFFF;
+    receiver.version = 0xFFFE;
+    receiver.missed = 0;
+    EXPECT_TRUE(status_receiver_receive(&receiver, &snapshot));
+    snapshot.version = 0x0001;
+    EXPECT_TRUE(status_receiver_receive(&receiver, &snapshot));
+    EXPECT_EQ(receiver.missed, 1);
+}
+
+TEST_F(StatusSnapshot, a_restarted_master_is_followed) {
+    status_snapshot_t snapshot = sender.snapshot;
+    snapshot.version = 20;
+    status_receiver_receive(&receiver, &snapshot);
+    uint16_t missed = receiver.missed;
+    snapshot.version = 0;
+    EXPECT_TRUE(status_receiver_receive(&receiver, &snapshot));
+    EXPECT_EQ(receiver.version, 0);
+    EXPECT_EQ(receiver.missed, missed);
+}
+
+TEST_F(StatusSnapshot, a_flush_sends_a_change_right_away) {
+    status = make_status(2);
+    status_sender_update(&sender, &status);
+    EXPECT_EQ(status_sender_poll(&sender, now), nullptr);
+    status = make_status(2, true);
+    status_sender_update(&sender, &status);
+    const status_snapshot_t* snapshot = status_sender_flush(&sender, now);
+    ASSERT_NE(snapshot, nullptr);
+    EXPECT_EQ(snapshot->version, 1);
+    EXPECT_TRUE(snapshot->status.suspended);
+    EXPECT_EQ(status_sender_poll(&sender, now + VISUALIZER_STATUS_COALESCE), nullptr);
+}
+
+#if VISUALIZER_STATUS_REFRESH == 0
+TEST_F(StatusSnapshot, a_flush_without_a_change_sends_nothing) {
+    EXPECT_EQ(status_sender_flush(&sender, now + 1), nullptr);
+    EXPECT_EQ(status_sender_flush(&sender, now + 10000), nullptr);
+}
+#else
+TEST_F(StatusSnapshot, a_flush_without_a_change_sends_only_the_refresh) {
+    EXPECT_EQ(status_sender_flush(&sender, now + 1), nullptr);
+    EXPECT_NE(status_sender_flush(&sender, now + VISUALIZER_STATUS_REFRESH), nullptr);
+}
+#endif
+
+TEST_F(StatusSnapshot, a_resync_sends_the_snapshot_again) {
+    run_until(now + 100);
+    status_sender_resync(&sender);
+    EXPECT_EQ(run_until(now + VISUALIZER_STATUS_COALESCE), 1);
+    // A slave that has it already compares it, one that hasn't takes it
+    status_snapshot_t snapshot = sender.snapshot;
+    EXPECT_TRUE(status_receiver_receive(&receiver, &snapshot));
+    EXPECT_EQ(receiver.missed, 0);
+    status_receiver_t new_receiver = {};
+    EXPECT_TRUE(status_receiver_receive(&new_receiver, &snapshot));
+    EXPECT_EQ(snapshot.status.layer, 1u);
+}
+
+TEST_F(StatusSnapshot, a_change_during_a_resync_goes_out_with_it) {
+    status_sender_resync(&sender);
+    status = make_status(2);
+    EXPECT_EQ(run_until(now + VISUALIZER_STATUS_COALESCE), 1);
+    EXPECT_EQ(sender.snapshot.version, 1);
+    EXPECT_EQ(sender.snapshot.status.layer, 2u);
+}
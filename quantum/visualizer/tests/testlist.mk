@@ -0,0 +1,7 @@
+TEST_LIST +=\
+	display_shadow \
+	keyframe_timeline \
+	lcd_backlight \
+	led_compositor \
+	status_snapshot \
+	status_snapshot_refresh
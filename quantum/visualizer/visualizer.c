@@ -23,6 +23,7 @@ SOFTWARE.
 */
 
 #include "visualizer.h"
+#include "status_snapshot.h"
 #include "config.h"
 #include <string.h>
 #ifdef PROTOCOL_CHIBIOS
@@ -46,6 +47,7 @@ SOFTWARE.
 #ifdef SERIAL_LINK_ENABLE
 #include "serial_link/protocol/transport.h"
 #include "serial_link/system/serial_link.h"
+#include "timer.h"
 #endif
 
 // Define this in config.h
@@ -61,25 +63,22 @@ static visualizer_keyboard_status_t current_status = {
     .suspended = false,
 };
 
-static bool same_status(visualizer_keyboard_status_t* status1, visualizer_keyboard_status_t* status2) {
-    return status1->layer == status2->layer &&
-        status1->default_layer == status2->default_layer &&
-        status1->leds == status2->leds &&
-        status1->suspended == status2->suspended;
-}
-
 static bool visualizer_enabled = false;
 
-#define MAX_SIMULTANEOUS_ANIMATIONS 4
-static keyframe_animation_t* animations[MAX_SIMULTANEOUS_ANIMATIONS] = {};
-
 #ifdef SERIAL_LINK_ENABLE
-MASTER_TO_ALL_SLAVES_OBJECT(current_status, visualizer_keyboard_status_t);
+MASTER_TO_ALL_SLAVES_OBJECT(status_snapshot, status_snapshot_t);
+// Sent by the slaves that don't have a snapshot yet
+SLAVE_TO_MASTER_OBJECT(status_request, bool);
 
 static remote_object_t* remote_objects[] = {
-    REMOTE_OBJECT(current_status),
+    REMOTE_OBJECT(status_snapshot),
+    REMOTE_OBJECT(status_request),
 };
 
+static status_sender_t status_sender;
+static status_receiver_t status_receiver;
+static uint16_t last_status_request;
+
 #endif
 
 GDisplay* LCD_DISPLAY = 0;
@@ -95,119 +94,6 @@ GDisplay* get_led_display(void) {
     return gdispGetDisplay(1);
 }
 
-void start_keyframe_animation(keyframe_animation_t* animation) {
-    animation->current_frame = -1;
-    animation->time_left_in_frame = 0;
-    animation->need_update = true;
-    int free_index = -1;
-    for (int i=0;i<MAX_SIMULTANEOUS_ANIMATIONS;i++) {
-        if (animations[i] == animation) {
-            return;
-        }
-        if (free_index == -1 && animations[i] == NULL) {
-           free_index=i;
-        }
-    }
-    if (free_index!=-1) {
-        animations[free_index] = animation;
-    }
-}
-
-void stop_keyframe_animation(keyframe_animation_t* animation) {
-    animation->current_frame = animation->num_frames;
-    animation->time_left_in_frame = 0;
-    animation->need_update = true;
-    animation->first_update_of_frame = false;
-    animation->last_update_of_frame = false;
-    for (int i=0;i<MAX_SIMULTANEOUS_ANIMATIONS;i++) {
-        if (animations[i] == animation) {
-            animations[i] = NULL;
-            return;
-        }
-    }
-}
-
-void stop_all_keyframe_animations(void) {
-    for (int i=0;i<MAX_SIMULTANEOUS_ANIMATIONS;i++) {
-        if (animations[i]) {
-            animations[i]->current_frame = animations[i]->num_frames;
-            animations[i]->time_left_in_frame = 0;
-            animations[i]->need_update = true;
-            animations[i]->first_update_of_frame = false;
-            animations[i]->last_update_of_frame = false;
-            animations[i] = NULL;
-        }
-    }
-}
-
-static bool update_keyframe_animation(keyframe_animation_t* animation, visualizer_state_t* state, systemticks_t delta, systemticks_t* sleep_time) {
-    // TODO: Clean up this messy code
-    dprintf("Animation frame%d, left %d, delta %d\n", animation->current_frame,
-            animation->time_left_in_frame, delta);
-    if (animation->current_frame == animation->num_frames) {
-        animation->need_update = false;
-        return false;
-    }
-    if (animation->current_frame == -1) {
-       animation->current_frame = 0;
-       animation->time_left_in_frame = animation->frame_lengths[0];
-       animation->need_update = true;
-       animation->first_update_of_frame = true;
-    } else {
-        animation->time_left_in_frame -= delta;
-        while (animation->time_left_in_frame <= 0) {
-            int left = animation->time_left_in_frame;
-            if (animation->need_update) {
-                animation->time_left_in_frame = 0;
-                animation->last_update_of_frame = true;
-                (*animation->frame_functions[animation->current_frame])(animation, state);
-                animation->last_update_of_frame = false;
-            }
-            animation->current_frame++;
-            animation->need_update = true;
-            animation->first_update_of_frame = true;
-            if (animation->current_frame == animation->num_frames) {
-                if (animation->loop) {
-                    animation->current_frame = 0;
-                }
-                else {
-                    stop_keyframe_animation(animation);
-                    return false;
-                }
-            }
-            delta = -left;
-            animation->time_left_in_frame = animation->frame_lengths[animation->current_frame];
-            animation->time_left_in_frame -= delta;
-        }
-    }
-    if (animation->need_update) {
-        animation->need_update = (*animation->frame_functions[animation->current_frame])(animation, state);
-        animation->first_update_of_frame = false;
-    }
-
-    systemticks_t wanted_sleep = animation->need_update ? gfxMillisecondsToTicks(10) : (unsigned)animation->time_left_in_frame;
-    if (wanted_sleep < *sleep_time) {
-        *sleep_time = wanted_sleep;
-    }
-
-    return true;
-}
-
-void run_next_keyframe(keyframe_animation_t* animation, visualizer_state_t* state) {
-    int next_frame = animation->current_frame + 1;
-    if (next_frame == animation->num_frames) {
-        next_frame = 0;
-    }
-    keyframe_animation_t temp_animation = *animation;
-    temp_animation.current_frame = next_frame;
-    temp_animation.time_left_in_frame = animation->frame_lengths[next_frame];
-    temp_animation.first_update_of_frame = true;
-    temp_animation.last_update_of_frame = false;
-    temp_animation.need_update  = false;
-    visualizer_state_t temp_state = *state;
-    (*temp_animation.frame_functions[next_frame])(&temp_animation, &temp_state);
-}
-
 bool keyframe_no_operation(keyframe_animation_t* animation, visualizer_state_t* state) {
     (void)animation;
     (void)state;
@@ -218,28 +104,8 @@ bool keyframe_no_operation(keyframe_animation_t* animation, visualizer_state_t*
 bool keyframe_animate_backlight_color(keyframe_animation_t* animation, visualizer_state_t* state) {
     int frame_length = animation->frame_lengths[animation->current_frame];
     int current_pos = frame_length - animation->time_left_in_frame;
-    uint8_t t_h = LCD_HUE(state->target_lcd_color);
-    uint8_t t_s = LCD_SAT(state->target_lcd_color);
-    uint8_t t_i = LCD_INT(state->target_lcd_color);
-    uint8_t p_h = LCD_HUE(state->prev_lcd_color);
-    uint8_t p_s = LCD_SAT(state->prev_lcd_color);
-    uint8_t p_i = LCD_INT(state->prev_lcd_color);
-
-    uint8_t d_h1 = t_h - p_h; //Modulo arithmetic since we want to wrap around
-    int d_h2 = t_h - p_h;
-    // Chose the shortest way around
-    int d_h = abs(d_h2) < d_h1 ? d_h2 : d_h1;
-    int d_s = t_s - p_s;
-    int d_i = t_i - p_i;
-
-    int hue = (d_h * current_pos) / frame_length;
-    int sat = (d_s * current_pos) / frame_length;
-    int intensity = (d_i * current_pos) / frame_length;
-    //dprintf("%X -> %X = %X\n", p_h, t_h, hue);
-    hue += p_h;
-    sat += p_s;
-    intensity += p_i;
-    state->current_lcd_color = LCD_COLOR(hue, sat, intensity);
+    state->current_lcd_color = lcd_color_interpolate(state->prev_lcd_color, state->target_lcd_color,
+            current_pos, frame_length);
     lcd_backlight_color(
             LCD_HUE(state->current_lcd_color),
             LCD_SAT(state->current_lcd_color),
@@ -265,7 +131,6 @@ bool keyframe_display_layer_text(keyframe_animation_t* animation, visualizer_sta
     (void)animation;
     gdispClear(White);
     gdispDrawString(0, 10, state->layer_text, state->font_dejavusansbold12, Black);
-    gdispFlush();
     return false;
 }
 
@@ -304,7 +169,6 @@ bool keyframe_display_layer_bitmap(keyframe_animation_t* animation, visualizer_s
     gdispDrawString(0, 10, layer_buffer, state->font_fixed5x8, Black);
     format_layer_bitmap_string(state->status.default_layer >> 16, state->status.layer >> 16, layer_buffer);
     gdispDrawString(0, 20, layer_buffer, state->font_fixed5x8, Black);
-    gdispFlush();
     return false;
 }
 #endif // LCD_ENABLE
@@ -373,14 +237,11 @@ static DECLARE_THREAD_FUNCTION(visualizerThread, arg) {
 #endif
 
     systemticks_t sleep_time = TIME_INFINITE;
-    systemticks_t current_time = gfxSystemTicks();
 
     while(true) {
-        systemticks_t new_time = gfxSystemTicks();
-        systemticks_t delta = new_time - current_time;
-        current_time = new_time;
+        systemticks_t current_time = gfxSystemTicks();
         bool enabled = visualizer_enabled;
-        if (!same_status(&state.status, &current_status)) {
+        if (!status_snapshot_same(&state.status, &current_status)) {
             if (visualizer_enabled) {
                 if (current_status.suspended) {
                     stop_all_keyframe_animations();
@@ -404,12 +265,13 @@ static DECLARE_THREAD_FUNCTION(visualizerThread, arg) {
             user_visualizer_resume(&state);
             state.prev_lcd_color = state.current_lcd_color;
         }
-        sleep_time = TIME_INFINITE;
-        for (int i=0;i<MAX_SIMULTANEOUS_ANIMATIONS;i++) {
-            if (animations[i]) {
-                update_keyframe_animation(animations[i], &state, delta, &sleep_time);
-            }
-        }
+        // Until the next animation is due, whatever woke the thread up
+        sleep_time = update_keyframe_animations(&state, current_time);
+#ifdef LCD_ENABLE
+        // Once for all the animations, the display only sends what changed,
+        // and nothing when an animation drew the same thing again
+        gdispGFlush(LCD_DISPLAY);
+#endif
 #ifdef LED_ENABLE
         gdispGFlush(LED_DISPLAY);
 #endif
@@ -434,7 +296,7 @@ static DECLARE_THREAD_FUNCTION(visualizerThread, arg) {
                 sleep_time = 0;
             }
         }
-        dprintf("Update took %d, last delta %d, sleep_time %d\n", update_delta, delta, sleep_time);
+        dprintf("Update took %d, sleep_time %d\n", update_delta, sleep_time);
 #ifdef PROTOCOL_CHIBIOS
         // The gEventWait function really takes milliseconds, even if the documentation says ticks.
         // Unfortunately there's no generic ugfx conversion from system time to milliseconds,
@@ -464,6 +326,7 @@ void visualizer_init(void) {
 
 #ifdef SERIAL_LINK_ENABLE
     add_remote_objects(remote_objects, sizeof(remote_objects) / sizeof(remote_object_t*) );
+    status_sender_init(&status_sender, &current_status, timer_read());
 #endif
 
 #ifdef LCD_ENABLE
@@ -479,7 +342,7 @@ void visualizer_init(void) {
                               VISUALIZER_THREAD_PRIORITY, visualizerThread, NULL);
 }
 
-void update_status(bool changed) {
+static void update_status(bool changed, bool flush) {
     if (changed) {
         GSourceListener* listener = geventGetSourceListener((GSourceHandle)&current_status, NULL);
         if (listener) {
@@ -487,14 +350,27 @@ void update_status(bool changed) {
         }
     }
 #ifdef SERIAL_LINK_ENABLE
-    static systime_t last_update = 0;
-    systime_t current_update = chVTGetSystemTimeX();
-    systime_t delta = current_update - last_update;
-    if (changed || delta > MS2ST(10)) {
-        last_update = current_update;
-        visualizer_keyboard_status_t* r = begin_write_current_status();
-        *r = current_status;
-        end_write_current_status();
+    // The slaves get theirs from the master, and ask for it until they do
+    if (is_serial_link_connected()) {
+        if (!status_receiver.synced && timer_elapsed(last_status_request) >= VISUALIZER_STATUS_RETRY) {
+            last_status_request = timer_read();
+            *begin_write_status_request() = true;
+            end_write_status_request();
+        }
+        return;
+    }
+    for (uint8_t slave = 0; slave < NUM_SLAVES; slave++) {
+        if (read_status_request(slave)) {
+            status_sender_resync(&status_sender);
+        }
+    }
+    status_sender_update(&status_sender, &current_status);
+    const status_snapshot_t* snapshot = flush ?
+        status_sender_flush(&status_sender, timer_read()) :
+        status_sender_poll(&status_sender, timer_read());
+    if (snapshot) {
+        *begin_write_status_snapshot() = *snapshot;
+        end_write_status_snapshot();
     }
 #endif
 }
@@ -508,11 +384,13 @@ void visualizer_update(uint32_t default_state, uint32_t state, uint32_t leds) {
     bool changed = false;
 #ifdef SERIAL_LINK_ENABLE
     if (is_serial_link_connected ()) {
-        visualizer_keyboard_status_t* new_status = read_current_status();
-        if (new_status) {
-            if (!same_status(&current_status, new_status)) {
+        status_snapshot_t* snapshot = read_status_snapshot();
+        // The repeats of the last version don't need a look
+        if (snapshot && status_receiver_receive(&status_receiver, snapshot)) {
+            dprintf("Status version %d, %d missed\n", snapshot->version, status_receiver.missed);
+            if (!status_snapshot_same(&current_status, &snapshot->status)) {
                 changed = true;
-                current_status = *new_status;
+                current_status = snapshot->status;
             }
         }
     }
@@ -526,20 +404,21 @@ void visualizer_update(uint32_t default_state, uint32_t state, uint32_t leds) {
             .leds = leds,
             .suspended = current_status.suspended,
         };
-        if (!same_status(&current_status, &new_status)) {
+        if (!status_snapshot_same(&current_status, &new_status)) {
             changed = true;
             current_status = new_status;
         }
     }
-    update_status(changed);
+    update_status(changed, false);
 }
 
 void visualizer_suspend(void) {
     current_status.suspended = true;
-    update_status(true);
+    // Nothing polls while suspended, so the slaves have to be told now
+    update_status(true, true);
 }
 
 void visualizer_resume(void) {
     current_status.suspended = false;
-    update_status(true);
+    update_status(true, true);
 }
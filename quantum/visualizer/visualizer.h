@@ -56,6 +56,17 @@ void draw_emulator(void);
 // If you need support for more than 16 keyframes per animation, you can change this
 #define MAX_VISUALIZER_KEY_FRAMES 16
 
+// How many animations can run at the same time, define it in config.h to change
+#ifndef VISUALIZER_MAX_ANIMATIONS
+#define VISUALIZER_MAX_ANIMATIONS 8
+#endif
+
+// Milliseconds between the updates of frames that want continuous updates,
+// unless the animation sets its own update_interval
+#ifndef VISUALIZER_UPDATE_INTERVAL
+#define VISUALIZER_UPDATE_INTERVAL 10
+#endif
+
 struct keyframe_animation_t;
 
 typedef struct {
@@ -98,6 +109,9 @@ typedef struct keyframe_animation_t {
     bool loop;
     int frame_lengths[MAX_VISUALIZER_KEY_FRAMES];
     frame_func frame_functions[MAX_VISUALIZER_KEY_FRAMES];
+    // Ticks between continuous updates, this can be left at 0 for
+    // VISUALIZER_UPDATE_INTERVAL
+    int update_interval;
 
     // Used internally by the system, and can also be read by
     // keyframe update functions
@@ -107,6 +121,11 @@ typedef struct keyframe_animation_t {
     bool last_update_of_frame;
     bool need_update;
 
+    // Used internally by the scheduling, see keyframe_timeline.c
+    systemticks_t deadline;
+    systemticks_t last_update;
+    int heap_position;
+
 } keyframe_animation_t;
 
 extern GDisplay* LCD_DISPLAY;
@@ -114,6 +133,11 @@ extern GDisplay* LED_DISPLAY;
 
 void start_keyframe_animation(keyframe_animation_t* animation);
 void stop_keyframe_animation(keyframe_animation_t* animation);
+void stop_all_keyframe_animations(void);
+// Updates the animations that are due at now, and returns the ticks until
+// the next one is, or TIME_INFINITE when none is running. Called by the
+// visualizer thread
+systemticks_t update_keyframe_animations(visualizer_state_t* state, systemticks_t now);
 // This runs the next keyframe, but does not update the animation state
 // Useful for crossfades for example
 void run_next_keyframe(keyframe_animation_t* animation, visualizer_state_t* state);
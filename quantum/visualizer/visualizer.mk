@@ -21,6 +21,8 @@
 # SOFTWARE.
 
 SRC += $(VISUALIZER_DIR)/visualizer.c
+SRC += $(VISUALIZER_DIR)/keyframe_timeline.c
+SRC += $(VISUALIZER_DIR)/status_snapshot.c
 EXTRAINCDIRS += $(GFXINC) $(VISUALIZER_DIR)
 GFXLIB = $(LIB_PATH)/ugfx
 VPATH += $(VISUALIZER_PATH)
@@ -28,8 +30,8 @@ VPATH += $(VISUALIZER_PATH)
 OPT_DEFS += -DVISUALIZER_ENABLE
 
 ifdef LCD_ENABLE
+SRC += $(VISUALIZER_DIR)/display_shadow.c
 OPT_DEFS += -DLCD_ENABLE
-ULIBS += -lm
 endif
 
 ifdef LCD_BACKLIGHT_ENABLE
@@ -39,6 +41,7 @@ endif
 
 ifdef LED_ENABLE
 SRC += $(VISUALIZER_DIR)/led_test.c
+SRC += $(VISUALIZER_DIR)/led_compositor.c
 OPT_DEFS += -DLED_ENABLE
 endif
 
@@ -0,0 +1,19 @@
+#include "ws2812_encode.h"
+
+uint16_t ws2812_encode(const uint8_t *leds, uint16_t count, uint8_t *out) {
+  uint16_t length = count * 3;
+
+  for (uint16_t i = 0; i < length; i++) {
+    uint8_t data = leds[i];
+    uint32_t bits = 0;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      // MSB first, 110 or 100
+      bits = (bits << 3) | ((data & 0x80) ? 6 : 4);
+      data <<= 1;
+    }
+    *out++ = bits >> 16;
+    *out++ = bits >> 8;
+    *out++ = bits;
+  }
+  return length * 3;
+}
@@ -0,0 +1,21 @@
+#ifndef WS2812_ENCODE_H
+#define WS2812_ENCODE_H
+
+#include <stdint.h>
+
+/* Encodes WS2812 data as an SPI bitstream
+ *
+ * Every data bit becomes three SPI bits, 110 for a one and 100 for a zero.
+ * At an SPI clock of 2.4 MHz, one SPI bit lasts 417 ns, which gives the
+ * high times the LEDs expect, 0.83 us for a one and 0.42 us for a zero.
+ * Clocks from 2.3 to 3.2 MHz are within the tolerances.
+ */
+
+#define WS2812_ENCODED_BYTES_PER_LED 9
+
+/* Encodes count LEDs of three bytes each, in the order they are sent
+ * (green, red, blue, like struct cRGB), returns the number of bytes written
+ */
+uint16_t ws2812_encode(const uint8_t *leds, uint16_t count, uint8_t *out);
+
+#endif
@@ -0,0 +1,93 @@
+/* Non-blocking WS2812 driver for ChibiOS
+ *
+ * The LEDs are encoded into an SPI bitstream, see ws2812_encode.h, which
+ * the SPI driver sends with DMA, so interrupts stay enabled and
+ * ws2812_setleds() returns right away. There are two buffers. A frame set
+ * while the other one is being sent is encoded into the idle buffer, and
+ * goes out as soon as the transfer ends. Only the newest frame is kept.
+ *
+ * The board connects the data line to MOSI and sets the pin mode, enables
+ * the SPI driver in halconf.h and mcuconf.h, and defines
+ * WS2812_SPI_LLD_CONFIG in config.h. It holds the SPIConfig fields
+ * after the callback, for an SPI clock of about 2.4 MHz, for example on an
+ * STM32 at 48 MHz with the clock divided by 16:
+ *   #define WS2812_SPI_LLD_CONFIG NULL, 0, SPI_CR1_BR_1 | SPI_CR1_BR_0, 0
+ */
+
+#include <string.h>
+#include "ch.h"
+#include "hal.h"
+#include "light_ws2812.h"
+#include "ws2812_encode.h"
+
+#ifndef WS2812_SPI_LLD_CONFIG
+#error "WS2812_SPI_LLD_CONFIG has to be defined for the SPI driver"
+#endif
+
+#ifndef WS2812_SPI_DRIVER
+#define WS2812_SPI_DRIVER SPID1
+#endif
+
+// Low time after a frame, so that the LEDs latch it, 320 us at 2.4 MHz
+#ifndef WS2812_SPI_RESET_BYTES
+#define WS2812_SPI_RESET_BYTES 96
+#endif
+
+#define BUFFER_SIZE (RGBLED_NUM * WS2812_ENCODED_BYTES_PER_LED + WS2812_SPI_RESET_BYTES)
+
+static uint8_t buffers[2][BUFFER_SIZE];
+static size_t lengths[2];
+// The buffer that is, or was last, being sent
+static uint8_t sending;
+static volatile bool busy;
+// The other buffer holds a frame that hasn't been sent yet
+static volatile bool pending;
+
+static void spi_end(SPIDriver *spip) {
+  chSysLockFromISR();
+  if (pending) {
+    pending = false;
+    sending ^= 1;
+    spiStartSendI(spip, lengths[sending], buffers[sending]);
+  } else {
+    busy = false;
+  }
+  chSysUnlockFromISR();
+}
+
+static const SPIConfig spi_config = {
+  spi_end,
+  WS2812_SPI_LLD_CONFIG
+};
+
+void ws2812_setleds(struct cRGB *ledarray, uint16_t leds) {
+  static bool started = false;
+
+  if (!started) {
+    spiStart(&WS2812_SPI_DRIVER, &spi_config);
+    started = true;
+  }
+  if (leds > RGBLED_NUM) {
+    leds = RGBLED_NUM;
+  }
+
+  // Keeps the callback from starting the idle buffer while it's written
+  chSysLock();
+  pending = false;
+  uint8_t next = sending ^ 1;
+  chSysUnlock();
+
+  size_t length = ws2812_encode((const uint8_t*)ledarray, leds, buffers[next]);
+  memset(&buffers[next][length], 0, WS2812_SPI_RESET_BYTES);
+  lengths[next] = length + WS2812_SPI_RESET_BYTES;
+
+  chSysLock();
+  if (busy) {
+    pending = true;
+  } else {
+    busy = true;
+    sending = next;
+    spiStartSendI(&WS2812_SPI_DRIVER, lengths[next], buffers[next]);
+  }
+  chSysUnlock();
+}
@@ -1,9 +1,10 @@
 #include <stdint.h>
+#include <stdbool.h>
 #include <avr/io.h>
 #include <avr/interrupt.h>
-#include <avr/pgmspace.h>
 #include "led.h"
 #include "sleep_led.h"
+#include "led_fade.h"
 
 /* Software PWM
  *  ______           ______           __
@@ -11,25 +12,30 @@
  * |<-------------->|<-------------->|<- ....
  *     PWM period       PWM period
  *
- * 256              interrupts/period[resolution]
+ * The timer restarts at every edge, and the interrupt sets the length of
+ * the following ON or OFF time, so it only fires twice a period.
+ *
  * 64               periods/second[frequency]
- * 256*64           interrupts/second
- * F_CPU/(256*64)   clocks/interrupt
+ * 256              periods/breath, a 4 second breath cycle
+ * F_CPU/(8*64)     timer ticks/period, at clk/8
  */
-#define SLEEP_LED_TIMER_TOP F_CPU/(256*64)
+#define SLEEP_LED_PERIOD (F_CPU/(8*64))
+/* Shortest ON or OFF time, so that the interrupt sets the next compare
+ * value before the timer gets there */
+#define SLEEP_LED_MIN_TICKS 64
 
 void sleep_led_init(void)
 {
     /* Timer1 setup */
     /* CTC mode */
     TCCR1B |= _BV(WGM12);
-    /* Clock selelct: clk/1 */
-    TCCR1B |= _BV(CS10);
+    /* Clock selelct: clk/8 */
+    TCCR1B |= _BV(CS11);
     /* Set TOP value */
     uint8_t sreg = SREG;
     cli();
-    OCR1AH = (SLEEP_LED_TIMER_TOP>>8)&0xff;
-    OCR1AL = SLEEP_LED_TIMER_TOP&0xff;
+    OCR1AH = ((SLEEP_LED_PERIOD-1)>>8)&0xff;
+    OCR1AL = (SLEEP_LED_PERIOD-1)&0xff;
     SREG = sreg;
 }
 
@@ -52,44 +58,49 @@ void sleep_led_toggle(void)
 }
 
 
-/* Breathing Sleep LED brighness(PWM On period) table
- * (64[steps] * 4[duration]) / 64[PWM periods/s] = 4 second breath cycle
- *
- * http://www.wolframalpha.com/input/?i=%28sin%28+x%2F64*pi%29**8+*+255%2C+x%3D0+to+63
- * (0..63).each {|x| p ((sin(x/64.0*PI)**8)*255).to_i }
+/* ON time of a period of the breath, 0 for off and SLEEP_LED_PERIOD for on
+ * the whole period
  */
-static const uint8_t breathing_table[64] PROGMEM = {
-0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 6, 10,
-15, 23, 32, 44, 58, 74, 93, 113, 135, 157, 179, 199, 218, 233, 245, 252,
-255, 252, 245, 233, 218, 199, 179, 157, 135, 113, 93, 74, 58, 44, 32, 23,
-15, 10, 6, 4, 2, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
-};
+static uint16_t breathing_on_ticks(uint8_t index)
+{
+    uint16_t duty = led_gamma(led_breathing_level(index << 8));
+    uint16_t ticks = ((uint32_t)duty * SLEEP_LED_PERIOD) >> 16;
+
+    if (ticks < SLEEP_LED_MIN_TICKS) {
+        return 0;
+    }
+    if (ticks > SLEEP_LED_PERIOD - SLEEP_LED_MIN_TICKS) {
+        return SLEEP_LED_PERIOD;
+    }
+    return ticks;
+}
 
 ISR(TIMER1_COMPA_vect)
 {
-    /* Software PWM
-     * timer:1111 1111 1111 1111
-     *       \_____/\/ \_______/____  count(0-255)
-     *          \    \______________  duration of step(4)
-     *           \__________________  index of step table(0-63)
-     */
-    static union {
-        uint16_t row;
-        struct {
-            uint8_t count:8;
-            uint8_t duration:2;
-            uint8_t index:6;
-        } pwm;
-    } timer = { .row = 0 };
+    static uint8_t index = 0;
+    static uint16_t on_ticks = 0;
+    static uint16_t next_on_ticks = 0;
+    static bool off_edge = false;
 
-    timer.row++;
-    
-    // LED on
-    if (timer.pwm.count == 0) {
-        led_set(1<<USB_LED_CAPS_LOCK);
-    }
-    // LED off
-    if (timer.pwm.count == pgm_read_byte(&breathing_table[timer.pwm.index])) {
+    // The compare value goes first, led_set() may take a while
+    if (off_edge) {
+        OCR1A = SLEEP_LED_PERIOD - on_ticks - 1;
+        off_edge = false;
+        // LED off
         led_set(0);
+        return;
+    }
+
+    on_ticks = next_on_ticks;
+    if (on_ticks == 0 || on_ticks == SLEEP_LED_PERIOD) {
+        OCR1A = SLEEP_LED_PERIOD - 1;
+    } else {
+        OCR1A = on_ticks - 1;
+        off_edge = true;
     }
+    // LED on
+    led_set(on_ticks ? 1<<USB_LED_CAPS_LOCK : 0);
+
+    // The next period is computed now, while there is time to
+    next_on_ticks = breathing_on_ticks(index++);
 }
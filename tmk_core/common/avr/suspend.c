@@ -7,6 +7,7 @@
 #include "backlight.h"
 #include "suspend_avr.h"
 #include "suspend.h"
+#include "eeconfig.h"
 #include "timer.h"
 #include "led.h"
 
@@ -101,6 +102,7 @@ static void power_down(uint8_t wdto)
 
 void suspend_power_down(void)
 {
+    eeconfig_flush();
     power_down(WDTO_15MS);
 }
 
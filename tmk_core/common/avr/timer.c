@@ -110,6 +110,24 @@ uint32_t timer_elapsed32(uint32_t last)
     return TIMER_DIFF_32(t, last);
 }
 
+uint16_t timer_read_us(void)
+{
+    uint32_t t;
+    uint8_t raw;
+
+    uint8_t sreg = SREG;
+    cli();
+    t = timer_count;
+    raw = TIMER_RAW;
+    // The counter wrapped, but the interrupt hasn't counted it yet
+    if ((TIFR0 & (1<<OCF0A)) && raw < TIMER_RAW_TOP / 2) {
+        t++;
+    }
+    SREG = sreg;
+
+    return (uint16_t)t * 1000 + (uint16_t)((uint32_t)raw * 1000 / TIMER_RAW_TOP);
+}
+
 // excecuted once per 1ms.(excess for just timer count?)
 ISR(TIMER0_COMPA_vect)
 {
@@ -308,47 +308,30 @@ void do_flash_cmd(volatile uint8_t *fstat)
 #elif defined(KL2x) /* chip selection */
 /* Teensy LC (emulated) */
 
+#include <stdbool.h>
+#include "eeprom_log.h"
+
 #define SYMVAL(sym) (uint32_t)(((uint8_t *)&(sym)) - ((uint8_t *)0))
 
 extern uint32_t __eeprom_workarea_start__;
 extern uint32_t __eeprom_workarea_end__;
 
-#define EEPROM_SIZE 128
+#define EEPROM_SIZE EEPROM_LOG_SIZE
 
-static uint32_t flashend = 0;
+static bool initialized = false;
 
+/* The log is only scanned here, all reads are served by the RAM mirror */
 void eeprom_initialize(void)
 {
-	const uint16_t *p = (uint16_t *)SYMVAL(__eeprom_workarea_start__);
-
-	do {
-		if (*p++ == 0xFFFF) {
-			flashend = (uint32_t)(p - 2);
-			return;
-		}
-	} while (p < (uint16_t *)SYMVAL(__eeprom_workarea_end__));
-	flashend = (uint32_t)((uint16_t *)SYMVAL(__eeprom_workarea_end__) - 1);
+	eeprom_log_init((uint16_t *)SYMVAL(__eeprom_workarea_start__),
+		(uint16_t *)SYMVAL(__eeprom_workarea_end__));
+	initialized = true;
 }
 
 uint8_t eeprom_read_byte(const uint8_t *addr)
 {
-	uint32_t offset = (uint32_t)addr;
-	const uint16_t *p = (uint16_t *)SYMVAL(__eeprom_workarea_start__);
-	const uint16_t *end = (const uint16_t *)((uint32_t)flashend);
-	uint16_t val;
-	uint8_t data=0xFF;
-
-	if (!end) {
-		eeprom_initialize();
-		end = (const uint16_t *)((uint32_t)flashend);
-	}
-	if (offset < EEPROM_SIZE) {
-		while (p <= end) {
-			val = *p++;
-			if ((val & 255) == offset) data = val >> 8;
-		}
-	}
-	return data;
+	if (!initialized) eeprom_initialize();
+	return eeprom_log_read((uint32_t)addr);
 }
 
 static void flash_write(const uint16_t *code, uint32_t addr, uint32_t data)
@@ -367,69 +350,39 @@ static void flash_write(const uint16_t *code, uint32_t addr, uint32_t data)
 	MCM->PLACR |= MCM_PLACR_CFCC;
 }
 
-void eeprom_write_byte(uint8_t *addr, uint8_t data)
+void eeprom_log_program(uint16_t *addr, uint32_t data)
 {
-	uint32_t offset = (uint32_t)addr;
-	const uint16_t *p, *end = (const uint16_t *)((uint32_t)flashend);
-	uint32_t i, val, flashaddr;
 	uint16_t do_flash_cmd[] = {
 		0x2380, 0x7003, 0x7803, 0xb25b, 0x2b00, 0xdafb, 0x4770};
-	uint8_t buf[EEPROM_SIZE];
 
-	if (offset >= EEPROM_SIZE) return;
-	if (!end) {
-		eeprom_initialize();
-		end = (const uint16_t *)((uint32_t)flashend);
-	}
-	if (++end < (uint16_t *)SYMVAL(__eeprom_workarea_end__)) {
-		val = (data << 8) | offset;
-		flashaddr = (uint32_t)end;
-		flashend = flashaddr;
-		if ((flashaddr & 2) == 0) {
-			val |= 0xFFFF0000;
-		} else {
-			val <<= 16;
-			val |= 0x0000FFFF;
-		}
-		flash_write(do_flash_cmd, flashaddr, val);
-	} else {
-		for (i=0; i < EEPROM_SIZE; i++) {
-			buf[i] = 0xFF;
-		}
-		val = 0;
-		for (p = (uint16_t *)SYMVAL(__eeprom_workarea_start__); p < (uint16_t *)SYMVAL(__eeprom_workarea_end__); p++) {
-			val = *p;
-			if ((val & 255) < EEPROM_SIZE) {
-				buf[val & 255] = val >> 8;
-			}
-		}
-		buf[offset] = data;
-		for (flashaddr=(uint32_t)(uint16_t *)SYMVAL(__eeprom_workarea_start__); flashaddr < (uint32_t)(uint16_t *)SYMVAL(__eeprom_workarea_end__); flashaddr += 1024) {
-			*(uint32_t *)&(FTFA->FCCOB3) = 0x09000000 | flashaddr;
-			__disable_irq();
-			(*((void (*)(volatile uint8_t *))((uint32_t)do_flash_cmd | 1)))(&(FTFA->FSTAT));
-			__enable_irq();
-			val = FTFA->FSTAT & (FTFA_FSTAT_RDCOLERR|FTFA_FSTAT_ACCERR|FTFA_FSTAT_FPVIOL);;
-			if (val) FTFA->FSTAT = val;
-			MCM->PLACR |= MCM_PLACR_CFCC;
-		}
-		flashaddr=(uint32_t)(uint16_t *)SYMVAL(__eeprom_workarea_start__);
-		for (i=0; i < EEPROM_SIZE; i++) {
-			if (buf[i] == 0xFF) continue;
-			if ((flashaddr & 2) == 0) {
-				val = (buf[i] << 8) | i;
-			} else {
-				val = val | (buf[i] << 24) | (i << 16);
-				flash_write(do_flash_cmd, flashaddr, val);
-			}
-			flashaddr += 2;
-		}
-		flashend = flashaddr;
-		if ((flashaddr & 2)) {
-			val |= 0xFFFF0000;
-			flash_write(do_flash_cmd, flashaddr, val);
-		}
-	}
+	flash_write(do_flash_cmd, (uint32_t)addr, data);
+}
+
+void eeprom_log_erase(uint16_t *sector)
+{
+	uint32_t val;
+	uint16_t do_flash_cmd[] = {
+		0x2380, 0x7003, 0x7803, 0xb25b, 0x2b00, 0xdafb, 0x4770};
+
+	*(uint32_t *)&(FTFA->FCCOB3) = 0x09000000 | (uint32_t)sector;
+	__disable_irq();
+	(*((void (*)(volatile uint8_t *))((uint32_t)do_flash_cmd | 1)))(&(FTFA->FSTAT));
+	__enable_irq();
+	val = FTFA->FSTAT & (FTFA_FSTAT_RDCOLERR|FTFA_FSTAT_ACCERR|FTFA_FSTAT_FPVIOL);
+	if (val) FTFA->FSTAT = val;
+	MCM->PLACR |= MCM_PLACR_CFCC;
+}
+
+void eeprom_write_byte(uint8_t *addr, uint8_t data)
+{
+	if (!initialized) eeprom_initialize();
+	eeprom_log_write((uint32_t)addr, data);
+}
+
+/* Compacts the log in the background, one flash operation per call */
+void eeprom_task(void)
+{
+	if (initialized) eeprom_log_task();
 }
 
 /*
@@ -559,6 +512,10 @@ void eeprom_write_block(const void *buf, void *addr, uint32_t len) {
 }
 
 #endif /* chip selection */
+
+#if !defined(KL2x)
+void eeprom_task(void) {}
+#endif
 // The update functions just calls write for now, but could probably be optimized
 
 void eeprom_update_byte(uint8_t *addr, uint8_t value) {
@@ -0,0 +1,271 @@
+#include <stdbool.h>
+#include "eeprom_log.h"
+
+#define SECTOR_RECORDS (EEPROM_LOG_SECTOR_SIZE / sizeof(uint16_t))
+/* The header takes the first word of a bank */
+#define HEADER_RECORDS 2
+
+enum {
+	SPARE_DIRTY,
+	SPARE_ERASED,
+	SPARE_COPYING,
+};
+
+static uint16_t *log_start;
+static uint16_t *bank_start[2];
+static uint32_t bank_records;
+
+static uint8_t active;
+static uint16_t sequence;
+/* First free record of each bank */
+static uint16_t *active_next;
+static uint16_t *spare_next;
+
+static uint8_t spare_state;
+static uint32_t erase_sector;
+static uint32_t copy_pos;
+/* Addresses written after they were copied, they are copied again */
+static uint8_t recopy[EEPROM_LOG_SIZE / 8];
+
+static uint8_t mirror[EEPROM_LOG_SIZE];
+
+static uint16_t *bank_end(uint8_t bank)
+{
+	return bank_start[bank] + bank_records;
+}
+
+/* The flash is programmed in 32-bit words, so a record in the upper half
+ * leaves the already written lower half alone by programming it with ones
+ */
+static void append(uint16_t **next, uint16_t record)
+{
+	uint16_t *p = *next;
+
+	if (((p - log_start) & 1) == 0) {
+		eeprom_log_program(p, 0xFFFF0000 | record);
+	} else {
+		eeprom_log_program(p - 1, ((uint32_t)record << 16) | 0x0000FFFF);
+	}
+	*next = p + 1;
+}
+
+static bool header_valid(uint8_t bank)
+{
+	return bank_start[bank][0] == EEPROM_LOG_MAGIC;
+}
+
+static bool is_erased(uint16_t *start, uint16_t *end)
+{
+	while (start < end) {
+		if (*start++ != 0xFFFF) return false;
+	}
+	return true;
+}
+
+/* Replays the records from start up to the first free one, returns it */
+static uint16_t *replay(uint16_t *start, uint16_t *end)
+{
+	uint16_t *p = start;
+
+	while (p < end && *p != 0xFFFF) {
+		if ((*p & 255) < EEPROM_LOG_SIZE) {
+			mirror[*p & 255] = *p >> 8;
+		}
+		p++;
+	}
+	return p;
+}
+
+static void write_image(uint8_t bank)
+{
+	uint32_t i;
+
+	spare_next = bank_start[bank] + HEADER_RECORDS;
+	for (i=0; i < EEPROM_LOG_SIZE; i++) {
+		if (mirror[i] != 0xFF) {
+			append(&spare_next, (mirror[i] << 8) | i);
+		}
+	}
+}
+
+static void start_erase(void)
+{
+	spare_state = SPARE_DIRTY;
+	erase_sector = 0;
+}
+
+static void commit(void)
+{
+	uint8_t spare = active ^ 1;
+
+	sequence++;
+	eeprom_log_program(bank_start[spare], ((uint32_t)sequence << 16) | EEPROM_LOG_MAGIC);
+	active = spare;
+	active_next = spare_next;
+	start_erase();
+}
+
+static bool recopy_pending(void)
+{
+	uint32_t i;
+
+	for (i=0; i < sizeof(recopy); i++) {
+		if (recopy[i]) return true;
+	}
+	return false;
+}
+
+/* Next record to copy into the spare bank, first the whole mirror, then
+ * the addresses that were written after they had been copied
+ */
+static bool next_copy(uint16_t *record)
+{
+	uint32_t i;
+
+	while (copy_pos < EEPROM_LOG_SIZE) {
+		i = copy_pos++;
+		if (mirror[i] != 0xFF) {
+			*record = (mirror[i] << 8) | i;
+			return true;
+		}
+	}
+	for (i=0; i < EEPROM_LOG_SIZE; i++) {
+		if (recopy[i / 8] & (1 << (i % 8))) {
+			recopy[i / 8] &= ~(1 << (i % 8));
+			*record = (mirror[i] << 8) | i;
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Does one flash operation of the compaction, if there is one to do */
+static void compaction_step(bool force)
+{
+	uint8_t spare = active ^ 1;
+	uint16_t first, second;
+	uint32_t i;
+
+	switch (spare_state) {
+	case SPARE_DIRTY:
+		/* The header is in the first sector, so a partially erased bank is
+		 * never mistaken for a valid one */
+		eeprom_log_erase(bank_start[spare] + erase_sector * SECTOR_RECORDS);
+		if (++erase_sector * SECTOR_RECORDS >= bank_records) {
+			spare_state = SPARE_ERASED;
+			spare_next = bank_start[spare] + HEADER_RECORDS;
+		}
+		break;
+
+	case SPARE_ERASED:
+		if (!force && bank_end(active) - active_next >= EEPROM_LOG_COMPACT_THRESHOLD) {
+			break;
+		}
+		spare_state = SPARE_COPYING;
+		copy_pos = 0;
+		for (i=0; i < sizeof(recopy); i++) {
+			recopy[i] = 0;
+		}
+		/* fall through */
+	case SPARE_COPYING:
+		if (next_copy(&first)) {
+			if (((spare_next - log_start) & 1) == 0 && next_copy(&second)) {
+				/* Two records per word */
+				eeprom_log_program(spare_next, ((uint32_t)second << 16) | first);
+				spare_next += 2;
+			} else {
+				append(&spare_next, first);
+			}
+		}
+		/* Commit in the same step as the last copy, otherwise a write
+		 * between every step would keep the compaction from finishing */
+		if (copy_pos == EEPROM_LOG_SIZE && !recopy_pending()) {
+			commit();
+		}
+		break;
+	}
+}
+
+void eeprom_log_init(uint16_t *start, uint16_t *end)
+{
+	uint32_t i;
+	uint8_t spare;
+
+	log_start = start;
+	bank_records = (end - start) / 2;
+	bank_start[0] = start;
+	bank_start[1] = start + bank_records;
+
+	for (i=0; i < EEPROM_LOG_SIZE; i++) {
+		mirror[i] = 0xFF;
+	}
+
+	if (header_valid(0) && header_valid(1)) {
+		/* Power was lost before the old bank was erased */
+		active = (int16_t)(bank_start[1][1] - bank_start[0][1]) > 0 ? 1 : 0;
+	} else if (header_valid(0) || header_valid(1)) {
+		active = header_valid(0) ? 0 : 1;
+	} else if (is_erased(start, end)) {
+		active = 0;
+		sequence = 0;
+		eeprom_log_program(bank_start[0], EEPROM_LOG_MAGIC);
+		active_next = bank_start[0] + HEADER_RECORDS;
+		spare_state = SPARE_ERASED;
+		spare_next = bank_start[1] + HEADER_RECORDS;
+		return;
+	} else {
+		/* A log without banks, convert it in one go */
+		replay(start, end);
+		for (i=0; i < (uint32_t)(end - start); i += SECTOR_RECORDS) {
+			eeprom_log_erase(start + i);
+		}
+		active = 1;
+		sequence = 0xFFFF;
+		write_image(0);
+		commit();
+		spare_state = SPARE_ERASED;
+		spare_next = bank_start[1] + HEADER_RECORDS;
+		return;
+	}
+
+	sequence = bank_start[active][1];
+	active_next = replay(bank_start[active] + HEADER_RECORDS, bank_end(active));
+	spare = active ^ 1;
+	if (is_erased(bank_start[spare], bank_end(spare))) {
+		spare_state = SPARE_ERASED;
+		spare_next = bank_start[spare] + HEADER_RECORDS;
+	} else {
+		start_erase();
+	}
+}
+
+uint8_t eeprom_log_read(uint32_t offset)
+{
+	if (offset >= EEPROM_LOG_SIZE) return 0xFF;
+	return mirror[offset];
+}
+
+void eeprom_log_write(uint32_t offset, uint8_t value)
+{
+	uint16_t current = sequence;
+
+	if (offset >= EEPROM_LOG_SIZE) return;
+	mirror[offset] = value;
+	if (spare_state == SPARE_COPYING && offset < copy_pos) {
+		recopy[offset / 8] |= 1 << (offset % 8);
+	}
+	if (active_next < bank_end(active)) {
+		append(&active_next, (value << 8) | offset);
+	} else {
+		/* The task didn't keep up, finish the compaction here, the new
+		 * bank gets the value from the mirror */
+		while (sequence == current) {
+			compaction_step(true);
+		}
+	}
+}
+
+void eeprom_log_task(void)
+{
+	compaction_step(false);
+}
@@ -0,0 +1,54 @@
+#ifndef EEPROM_LOG_H
+#define EEPROM_LOG_H
+
+#include <stdint.h>
+
+/* Emulated EEPROM on top of a log in flash, used by the Teensy LC (KL2x)
+ *
+ * Every write appends a 16-bit record (value << 8 | address) to the flash
+ * work area, the last record for an address wins. The log is replayed into
+ * a RAM mirror once, so reads never touch the flash.
+ *
+ * The work area is split into two banks. The active bank starts with a
+ * header word, EEPROM_LOG_MAGIC in the lower half and a sequence number in
+ * the upper half, followed by the records. When the active bank runs low on
+ * space, eeprom_log_task() copies the mirror into the other bank, two records
+ * per call, and programs its header last, which makes it the active bank in
+ * a single word program. The old bank is then erased, one sector per call.
+ * A write only programs one word, as long as the task keeps up.
+ *
+ * After a power loss, the bank with a valid header and the newest sequence
+ * number wins, and the other one is erased in the background.
+ */
+
+#define EEPROM_LOG_SIZE 128
+#define EEPROM_LOG_SECTOR_SIZE 1024
+#define EEPROM_LOG_MAGIC 0xE0E0
+/* The compaction starts when fewer records than this are left, which gives
+ * it enough writes to copy the mirror two records per word, and everything
+ * written in the meantime once more
+ */
+#define EEPROM_LOG_COMPACT_THRESHOLD (EEPROM_LOG_SIZE + EEPROM_LOG_SIZE / 4)
+
+/* Replays the log between start and end into the mirror
+ * The work area must be aligned to EEPROM_LOG_SECTOR_SIZE, and be an even
+ * number of sectors, so that each bank has at least one sector.
+ * A log written before the banks were introduced is converted here, which
+ * erases and rewrites the whole work area once.
+ */
+void eeprom_log_init(uint16_t *start, uint16_t *end);
+uint8_t eeprom_log_read(uint32_t offset);
+void eeprom_log_write(uint32_t offset, uint8_t value);
+/* Does a step of the background compaction, which is at most one sector
+ * erase, or two word programs
+ */
+void eeprom_log_task(void);
+
+/* Flash backend, implemented by the platform */
+
+/* Programs the 32-bit word at addr, bits can only be cleared */
+void eeprom_log_program(uint16_t *addr, uint32_t data);
+/* Erases the EEPROM_LOG_SECTOR_SIZE bytes at sector to all ones */
+void eeprom_log_erase(uint16_t *sector);
+
+#endif
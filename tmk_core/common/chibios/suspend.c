@@ -10,6 +10,7 @@
 #include "host.h"
 #include "backlight.h"
 #include "suspend.h"
+#include "eeconfig.h"
 
 void suspend_idle(uint8_t time) {
 	// TODO: this is not used anywhere - what units is 'time' in?
@@ -17,6 +18,8 @@ void suspend_idle(uint8_t time) {
 }
 
 void suspend_power_down(void) {
+	eeconfig_flush();
+
 	// TODO: figure out what to power down and how
 	// shouldn't power down TPM/FTM if we want a breathing LED
 	// also shouldn't power down USB
@@ -0,0 +1,377 @@
+#include "gtest/gtest.h"
+#include <cstdlib>
+extern "C" {
+#include "common/chibios/eeprom_log.h"
+}
+
+// Simulates the flash of the Teensy LC, two erase sectors of work area,
+// so each bank is one sector
+static const int NUM_SECTORS = 2;
+static const int SECTOR_RECORDS = EEPROM_LOG_SECTOR_SIZE / sizeof(uint16_t);
+static const int NUM_RECORDS = NUM_SECTORS * SECTOR_RECORDS;
+static const int BANK_RECORDS = NUM_RECORDS / 2;
+static const int HEADER_RECORDS = 2;
+
+class EepromLog : public testing::Test {
+public:
+    EepromLog() {
+        Instance = this;
+        reset();
+    }
+
+    ~EepromLog() {
+        Instance = nullptr;
+    }
+
+    void reset() {
+        for (int i = 0; i < NUM_RECORDS; i++) {
+            flash[i] = 0xFFFF;
+        }
+        for (int i = 0; i < EEPROM_LOG_SIZE; i++) {
+            reference[i] = 0xFF;
+        }
+        num_programs = 0;
+        num_erases = 0;
+        ops_left = -1;
+        init();
+    }
+
+    void init() {
+        eeprom_log_init(flash, flash + NUM_RECORDS);
+    }
+
+    // Flash operations after this many are lost, as if the power was cut
+    void fail_after(int ops) {
+        ops_left = ops;
+    }
+
+    bool powered() {
+        return ops_left != 0;
+    }
+
+    void restore_power() {
+        ops_left = -1;
+    }
+
+    bool use_op() {
+        if (ops_left == 0) {
+            return false;
+        }
+        if (ops_left > 0) {
+            ops_left--;
+        }
+        return true;
+    }
+
+    void program(uint16_t* addr, uint32_t data) {
+        int index = addr - flash;
+        ASSERT_GE(index, 0);
+        ASSERT_LT(index, NUM_RECORDS);
+        ASSERT_EQ(index % 2, 0);
+        if (!use_op()) {
+            return;
+        }
+        uint16_t low = data & 0xFFFF;
+        uint16_t high = data >> 16;
+        // A half word is never programmed twice
+        if (low != 0xFFFF) {
+            ASSERT_EQ(flash[index], 0xFFFF);
+        }
+        if (high != 0xFFFF) {
+            ASSERT_EQ(flash[index + 1], 0xFFFF);
+        }
+        // Programming can only clear bits
+        flash[index] &= low;
+        flash[index + 1] &= high;
+        num_programs++;
+    }
+
+    void erase(uint16_t* sector) {
+        int index = sector - flash;
+        ASSERT_GE(index, 0);
+        ASSERT_LT(index, NUM_RECORDS);
+        ASSERT_EQ(index % SECTOR_RECORDS, 0);
+        if (!use_op()) {
+            return;
+        }
+        for (int i = 0; i < SECTOR_RECORDS; i++) {
+            flash[index + i] = 0xFFFF;
+        }
+        num_erases++;
+    }
+
+    int num_ops() {
+        return num_programs + num_erases;
+    }
+
+    void write(uint32_t offset, uint8_t value) {
+        eeprom_log_write(offset, value);
+        reference[offset] = value;
+    }
+
+    void expect_reference() {
+        for (int i = 0; i < EEPROM_LOG_SIZE; i++) {
+            EXPECT_EQ(eeprom_log_read(i), reference[i]) << "at offset " << i;
+        }
+    }
+
+    bool bank_valid(int bank) {
+        return flash[bank * BANK_RECORDS] == EEPROM_LOG_MAGIC;
+    }
+
+    uint16_t bank_sequence(int bank) {
+        return flash[bank * BANK_RECORDS + 1];
+    }
+
+    bool bank_erased(int bank) {
+        for (int i = 0; i < BANK_RECORDS; i++) {
+            if (flash[bank * BANK_RECORDS + i] != 0xFFFF) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    int num_used_records(int bank) {
+        int i = HEADER_RECORDS;
+        while (i < BANK_RECORDS && flash[bank * BANK_RECORDS + i] != 0xFFFF) {
+            i++;
+        }
+        return i - HEADER_RECORDS;
+    }
+
+    // Runs the task until there is nothing left to do
+    void run_task() {
+        for (int i = 0; i < EEPROM_LOG_SIZE * 4; i++) {
+            eeprom_log_task();
+        }
+    }
+
+    alignas(EEPROM_LOG_SECTOR_SIZE) uint16_t flash[NUM_RECORDS];
+    uint8_t reference[EEPROM_LOG_SIZE];
+    int num_programs;
+    int num_erases;
+    int ops_left;
+    static EepromLog* Instance;
+};
+
+EepromLog* EepromLog::Instance = nullptr;
+
+extern "C" {
+void eeprom_log_program(uint16_t* addr, uint32_t data) {
+    EepromLog::Instance->program(addr, data);
+}
+
+void eeprom_log_erase(uint16_t* sector) {
+    EepromLog::Instance->erase(sector);
+}
+}
+
+TEST_F(EepromLog, empty_flash_reads_as_erased) {
+    expect_reference();
+    EXPECT_TRUE(bank_valid(0));
+    EXPECT_EQ(bank_sequence(0), 0);
+    EXPECT_TRUE(bank_erased(1));
+}
+
+TEST_F(EepromLog, reads_back_written_bytes) {
+    write(0, 0x12);
+    write(1, 0x34);
+    write(127, 0x56);
+    expect_reference();
+    EXPECT_EQ(num_used_records(0), 3);
+    EXPECT_EQ(flash[HEADER_RECORDS + 0], 0x1200);
+    EXPECT_EQ(flash[HEADER_RECORDS + 1], 0x3401);
+    EXPECT_EQ(flash[HEADER_RECORDS + 2], 0x567F);
+}
+
+TEST_F(EepromLog, the_last_write_wins) {
+    write(5, 0x01);
+    write(5, 0x02);
+    write(5, 0x03);
+    expect_reference();
+    init();
+    expect_reference();
+}
+
+TEST_F(EepromLog, survives_a_reinit) {
+    write(10, 0xAB);
+    write(20, 0xCD);
+    write(10, 0xEF);
+    init();
+    expect_reference();
+    write(30, 0x42);
+    init();
+    expect_reference();
+    EXPECT_EQ(num_used_records(0), 4);
+}
+
+TEST_F(EepromLog, converts_a_log_without_banks) {
+    // As written by earlier firmware
+    for (int i = 0; i < NUM_RECORDS; i++) {
+        flash[i] = 0xFFFF;
+    }
+    flash[0] = 0x1103;
+    flash[1] = 0x2204;
+    flash[2] = 0x3303;
+    flash[BANK_RECORDS + 10] = 0x1234;
+    init();
+    reference[3] = 0x33;
+    reference[4] = 0x22;
+    expect_reference();
+    EXPECT_TRUE(bank_valid(0));
+    EXPECT_EQ(num_used_records(0), 2);
+    EXPECT_TRUE(bank_erased(1));
+    init();
+    expect_reference();
+}
+
+TEST_F(EepromLog, reads_are_served_from_ram) {
+    write(7, 0x77);
+    flash[HEADER_RECORDS] = 0x0007;
+    EXPECT_EQ(eeprom_log_read(7), 0x77);
+}
+
+TEST_F(EepromLog, out_of_range_accesses_are_ignored) {
+    int ops = num_ops();
+    eeprom_log_write(EEPROM_LOG_SIZE, 0x12);
+    eeprom_log_write(0x1000, 0x12);
+    EXPECT_EQ(num_ops(), ops);
+    EXPECT_EQ(eeprom_log_read(EEPROM_LOG_SIZE), 0xFF);
+    EXPECT_EQ(eeprom_log_read(0x1000), 0xFF);
+}
+
+TEST_F(EepromLog, the_task_does_nothing_while_there_is_space) {
+    write(1, 0x11);
+    int ops = num_ops();
+    run_task();
+    EXPECT_EQ(num_ops(), ops);
+}
+
+TEST_F(EepromLog, compacts_into_the_other_bank_in_the_background) {
+    for (int i = 0; i < BANK_RECORDS - HEADER_RECORDS - EEPROM_LOG_COMPACT_THRESHOLD + 1; i++) {
+        write(i % 4, i & 0x7F);
+    }
+    EXPECT_FALSE(bank_valid(1));
+    int ops = num_ops();
+    while (!bank_valid(1)) {
+        eeprom_log_task();
+        ASSERT_GT(num_ops(), ops);
+        ASSERT_LE(num_ops(), ops + 2);
+        ops = num_ops();
+    }
+    EXPECT_EQ(bank_sequence(1), 1);
+    EXPECT_EQ(num_used_records(1), 4);
+    eeprom_log_task();
+    EXPECT_TRUE(bank_erased(0));
+    expect_reference();
+    init();
+    expect_reference();
+}
+
+TEST_F(EepromLog, writes_during_the_compaction_are_kept) {
+    for (int i = 0; i < BANK_RECORDS - HEADER_RECORDS - EEPROM_LOG_COMPACT_THRESHOLD + 1; i++) {
+        write(i % EEPROM_LOG_SIZE, i & 0x7F);
+    }
+    for (int i = 0; i < 20; i++) {
+        eeprom_log_task();
+    }
+    // Already copied, and still to be copied
+    write(0, 0xA0);
+    write(1, 0xFF);
+    write(100, 0xA1);
+    run_task();
+    EXPECT_TRUE(bank_valid(1));
+    EXPECT_TRUE(bank_erased(0));
+    expect_reference();
+    init();
+    expect_reference();
+}
+
+TEST_F(EepromLog, each_write_programs_one_word_when_the_task_keeps_up) {
+    srand(1234);
+    for (int i = 0; i < NUM_RECORDS * 5; i++) {
+        int ops = num_ops();
+        write(rand() % EEPROM_LOG_SIZE, rand() & 0xFF);
+        ASSERT_EQ(num_ops(), ops + 1);
+        ops = num_ops();
+        eeprom_log_task();
+        ASSERT_LE(num_ops(), ops + 2);
+    }
+    EXPECT_GT(num_erases, 0);
+    expect_reference();
+    init();
+    expect_reference();
+}
+
+TEST_F(EepromLog, compacts_on_a_write_when_the_task_is_not_called) {
+    srand(4321);
+    for (int i = 0; i < NUM_RECORDS * 5; i++) {
+        write(rand() % EEPROM_LOG_SIZE, rand() & 0xFF);
+        if (rand() % 64 == 0) {
+            init();
+        }
+    }
+    EXPECT_GT(num_erases, 0);
+    expect_reference();
+    init();
+    expect_reference();
+}
+
+// Runs writes and tasks, and cuts the power at every possible flash
+// operation. Every write that returned before the power loss has to be
+// there after the restart, and the write that was interrupted has either
+// its old or its new value.
+TEST_F(EepromLog, survives_a_power_loss_at_any_point) {
+    const int num_writes = BANK_RECORDS * 3;
+    int total_ops = -1;
+    for (int fail_at = 0; total_ops < 0; fail_at++) {
+        reset();
+        int ops_at_start = num_ops();
+        fail_after(fail_at);
+        srand(5678);
+        int uncertain = -1;
+        uint8_t old_value = 0;
+        for (int i = 0; i < num_writes && powered(); i++) {
+            uint32_t offset = rand() % EEPROM_LOG_SIZE;
+            uint8_t value = rand() & 0xFF;
+            uint8_t previous = reference[offset];
+            write(offset, value);
+            if (!powered()) {
+                uncertain = offset;
+                old_value = previous;
+                break;
+            }
+            // Skip the task now and then, so that some writes compact
+            if (rand() % 8 != 0) {
+                eeprom_log_task();
+            }
+        }
+        if (powered()) {
+            // Ran to the end, every operation has been interrupted once
+            total_ops = num_ops() - ops_at_start;
+            continue;
+        }
+
+        restore_power();
+        init();
+        for (int i = 0; i < EEPROM_LOG_SIZE; i++) {
+            uint8_t value = eeprom_log_read(i);
+            if (i == uncertain && value == old_value) {
+                reference[i] = old_value;
+            }
+            ASSERT_EQ(value, reference[i]) << "at offset " << i << " power lost after " << fail_at;
+        }
+
+        // And it keeps working
+        for (int i = 0; i < BANK_RECORDS; i++) {
+            write(rand() % EEPROM_LOG_SIZE, rand() & 0xFF);
+            eeprom_log_task();
+        }
+        init();
+        for (int i = 0; i < EEPROM_LOG_SIZE; i++) {
+            ASSERT_EQ(eeprom_log_read(i), reference[i]) << "at offset " << i << " power lost after " << fail_at;
+        }
+    }
+    EXPECT_GT(total_ops, 0);
+}
@@ -0,0 +1,3 @@
+chibios_eeprom_log_SRC :=\
+	$(TMK_PATH)/common/chibios/tests/eeprom_log_tests.cpp \
+	$(TMK_PATH)/common/chibios/eeprom_log.c
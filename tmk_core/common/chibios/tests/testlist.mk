@@ -0,0 +1,2 @@
+TEST_LIST +=\
+	chibios_eeprom_log
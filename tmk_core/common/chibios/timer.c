@@ -25,3 +25,28 @@ uint32_t timer_elapsed32(uint32_t last)
 {
     return ST2MS(chVTTimeElapsedSinceX(MS2ST(last)));
 }
+
+#define US_PER_TICK (1000000 / CH_CFG_ST_FREQUENCY)
+
+uint16_t timer_read_us(void)
+{
+#if CH_CFG_ST_TIMEDELTA == 0
+    // A tick is a millisecond on most boards, so count the time within it
+    // with the SysTick, which counts down the core clocks of each tick
+    syssts_t sts = chSysGetStatusAndLockX();
+    systime_t ticks = chVTGetSystemTimeX();
+    uint32_t load = SysTick->LOAD;
+    uint32_t val = SysTick->VAL;
+    // The SysTick wrapped, but the tick wasn't counted yet
+    if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {
+        val = SysTick->VAL;
+        ticks++;
+    }
+    chSysRestoreStatusX(sts);
+    // Multiplied out of ST2US, so that it wraps along with the system time
+    return (uint16_t)(ticks * US_PER_TICK + (load - val) * US_PER_TICK / (load + 1));
+#else
+    // The tickless timer only counts whole ticks, see SCHEDULER_TIME_RESOLUTION
+    return (uint16_t)(chVTGetSystemTimeX() * US_PER_TICK);
+#endif
+}
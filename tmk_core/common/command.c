@@ -24,6 +24,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "debug.h"
 #include "util.h"
 #include "timer.h"
+#include "scheduler.h"
 #include "keyboard.h"
 #include "bootloader.h"
 #include "action_layer.h"
@@ -55,6 +56,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
     #include "audio.h"
 #endif /* AUDIO_ENABLE */
 
+#ifdef SERIAL_LINK_ENABLE
+    #include "serial_link/system/serial_link.h"
+#endif
+
 
 static bool command_common(uint8_t code);
 static void command_common_help(void);
@@ -242,6 +247,14 @@ static void print_status(void)
 #endif
     print_val_hex32(timer_read32());
 
+#ifdef RGBLIGHT_ENABLE
+    rgblight_debug_frames();
+#endif
+#if defined(BACKLIGHT_ENABLE) && defined(BACKLIGHT_PIN)
+    backlight_debug_frames();
+#endif
+    scheduler_debug();
+
 #ifdef PROTOCOL_PJRC
     print_val_hex8(UDCON);
     print_val_hex8(UDIEN);
@@ -292,6 +305,8 @@ static void print_eeconfig(void)
     print(".level: "); print_dec(bc.level); print("\n");
 #endif /* BACKLIGHT_ENABLE */
 
+    print("eeprom writes: "); print_dec(eeconfig_write_count()); print("\n");
+
 #endif /* !NO_PRINT */
 
 }
@@ -368,6 +383,7 @@ static bool command_common(uint8_t code)
             #else
 	            wait_ms(1000);
             #endif
+            eeconfig_flush();
             bootloader_jump(); // not return
             break;
 
@@ -532,6 +548,9 @@ static void command_console_help(void)
           "ESC/q:	quit\n"
 #ifdef MOUSEKEY_ENABLE
           "m:	mousekey\n"
+#endif
+#ifdef SERIAL_LINK_ENABLE
+          "s:	serial link statistics\n"
 #endif
     );
 }
@@ -553,6 +572,11 @@ static bool command_console(uint8_t code)
             print("M> ");
             command_state = MOUSEKEY;
             return true;
+#endif
+#ifdef SERIAL_LINK_ENABLE
+        case KC_S:
+            serial_link_print_statistics();
+            break;
 #endif
         default:
             print("?");
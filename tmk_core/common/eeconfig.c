@@ -2,55 +2,149 @@
 #include <stdbool.h>
 #include "eeprom.h"
 #include "eeconfig.h"
+#include "timer.h"
+
+/* The eeconfig area is cached in RAM, so that settings which are stepped
+ * through with repeated key presses, like the backlight or rgblight levels,
+ * are written once when they settle instead of on every step.
+ */
+#if EECONFIG_SIZE > 16
+#   error "the dirty mask only covers 16 bytes"
+#endif
+
+static uint8_t cache[EECONFIG_SIZE];
+static uint16_t dirty;
+static bool cache_loaded = false;
+static uint16_t last_change;
+static uint16_t write_count = 0;
+
+static void load_cache(void)
+{
+    eeprom_read_block(cache, (const void *)0, EECONFIG_SIZE);
+    dirty = 0;
+    cache_loaded = true;
+}
+
+uint8_t eeconfig_read_byte(const uint8_t *addr)
+{
+    uint16_t i = (uintptr_t)addr;
+    if (i >= EECONFIG_SIZE) return eeprom_read_byte(addr);
+    if (!cache_loaded) load_cache();
+    return cache[i];
+}
+
+void eeconfig_update_byte(uint8_t *addr, uint8_t val)
+{
+    uint16_t i = (uintptr_t)addr;
+    if (i >= EECONFIG_SIZE) {
+        eeprom_update_byte(addr, val);
+        return;
+    }
+    if (!cache_loaded) load_cache();
+    if (cache[i] != val) {
+        cache[i] = val;
+        dirty |= (1 << i);
+        last_change = timer_read();
+    }
+}
+
+uint16_t eeconfig_read_word(const uint16_t *addr)
+{
+    const uint8_t *p = (const uint8_t *)addr;
+    return eeconfig_read_byte(p) | (eeconfig_read_byte(p + 1) << 8);
+}
+
+void eeconfig_update_word(uint16_t *addr, uint16_t val)
+{
+    uint8_t *p = (uint8_t *)addr;
+    eeconfig_update_byte(p, val);
+    eeconfig_update_byte(p + 1, val >> 8);
+}
+
+uint32_t eeconfig_read_dword(const uint32_t *addr)
+{
+    const uint16_t *p = (const uint16_t *)addr;
+    return eeconfig_read_word(p) | ((uint32_t)eeconfig_read_word(p + 1) << 16);
+}
+
+void eeconfig_update_dword(uint32_t *addr, uint32_t val)
+{
+    uint16_t *p = (uint16_t *)addr;
+    eeconfig_update_word(p, val);
+    eeconfig_update_word(p + 1, val >> 16);
+}
+
+void eeconfig_flush(void)
+{
+    for (uint8_t i = 0; dirty; i++) {
+        if (dirty & (1 << i)) {
+            eeprom_update_byte((uint8_t *)(uintptr_t)i, cache[i]);
+            dirty &= ~(1 << i);
+            write_count++;
+        }
+    }
+}
+
+void eeconfig_task(void)
+{
+    if (dirty && timer_elapsed(last_change) >= EECONFIG_FLUSH_DELAY) {
+        eeconfig_flush();
+    }
+}
+
+uint16_t eeconfig_write_count(void)
+{
+    return write_count;
+}
 
 void eeconfig_init(void)
 {
-    eeprom_update_word(EECONFIG_MAGIC,          EECONFIG_MAGIC_NUMBER);
-    eeprom_update_byte(EECONFIG_DEBUG,          0);
-    eeprom_update_byte(EECONFIG_DEFAULT_LAYER,  0);
-    eeprom_update_byte(EECONFIG_KEYMAP,         0);
-    eeprom_update_byte(EECONFIG_MOUSEKEY_ACCEL, 0);
+    eeconfig_update_word(EECONFIG_MAGIC,          EECONFIG_MAGIC_NUMBER);
+    eeconfig_update_byte(EECONFIG_DEBUG,          0);
+    eeconfig_update_byte(EECONFIG_DEFAULT_LAYER,  0);
+    eeconfig_update_byte(EECONFIG_KEYMAP,         0);
+    eeconfig_update_byte(EECONFIG_MOUSEKEY_ACCEL, 0);
 #ifdef BACKLIGHT_ENABLE
-    eeprom_update_byte(EECONFIG_BACKLIGHT,      0);
+    eeconfig_update_byte(EECONFIG_BACKLIGHT,      0);
 #endif
 #ifdef AUDIO_ENABLE
-    eeprom_update_byte(EECONFIG_AUDIO,             0xFF); // On by default
+    eeconfig_update_byte(EECONFIG_AUDIO,             0xFF); // On by default
 #endif
 #ifdef RGBLIGHT_ENABLE
-    eeprom_update_dword(EECONFIG_RGBLIGHT,      0);
+    eeconfig_update_dword(EECONFIG_RGBLIGHT,      0);
 #endif
 }
 
 void eeconfig_enable(void)
 {
-    eeprom_update_word(EECONFIG_MAGIC, EECONFIG_MAGIC_NUMBER);
+    eeconfig_update_word(EECONFIG_MAGIC, EECONFIG_MAGIC_NUMBER);
 }
 
 void eeconfig_disable(void)
 {
-    eeprom_update_word(EECONFIG_MAGIC, 0xFFFF);
+    eeconfig_update_word(EECONFIG_MAGIC, 0xFFFF);
 }
 
 bool eeconfig_is_enabled(void)
 {
-    return (eeprom_read_word(EECONFIG_MAGIC) == EECONFIG_MAGIC_NUMBER);
+    return (eeconfig_read_word(EECONFIG_MAGIC) == EECONFIG_MAGIC_NUMBER);
 }
 
-uint8_t eeconfig_read_debug(void)      { return eeprom_read_byte(EECONFIG_DEBUG); }
-void eeconfig_update_debug(uint8_t val) { eeprom_update_byte(EECONFIG_DEBUG, val); }
+uint8_t eeconfig_read_debug(void)      { return eeconfig_read_byte(EECONFIG_DEBUG); }
+void eeconfig_update_debug(uint8_t val) { eeconfig_update_byte(EECONFIG_DEBUG, val); }
 
-uint8_t eeconfig_read_default_layer(void)      { return eeprom_read_byte(EECONFIG_DEFAULT_LAYER); }
-void eeconfig_update_default_layer(uint8_t val) { eeprom_update_byte(EECONFIG_DEFAULT_LAYER, val); }
+uint8_t eeconfig_read_default_layer(void)      { return eeconfig_read_byte(EECONFIG_DEFAULT_LAYER); }
+void eeconfig_update_default_layer(uint8_t val) { eeconfig_update_byte(EECONFIG_DEFAULT_LAYER, val); }
 
-uint8_t eeconfig_read_keymap(void)      { return eeprom_read_byte(EECONFIG_KEYMAP); }
-void eeconfig_update_keymap(uint8_t val) { eeprom_update_byte(EECONFIG_KEYMAP, val); }
+uint8_t eeconfig_read_keymap(void)      { return eeconfig_read_byte(EECONFIG_KEYMAP); }
+void eeconfig_update_keymap(uint8_t val) { eeconfig_update_byte(EECONFIG_KEYMAP, val); }
 
 #ifdef BACKLIGHT_ENABLE
-uint8_t eeconfig_read_backlight(void)      { return eeprom_read_byte(EECONFIG_BACKLIGHT); }
-void eeconfig_update_backlight(uint8_t val) { eeprom_update_byte(EECONFIG_BACKLIGHT, val); }
+uint8_t eeconfig_read_backlight(void)      { return eeconfig_read_byte(EECONFIG_BACKLIGHT); }
+void eeconfig_update_backlight(uint8_t val) { eeconfig_update_byte(EECONFIG_BACKLIGHT, val); }
 #endif
 
 #ifdef AUDIO_ENABLE
-uint8_t eeconfig_read_audio(void)      { return eeprom_read_byte(EECONFIG_AUDIO); }
-void eeconfig_update_audio(uint8_t val) { eeprom_update_byte(EECONFIG_AUDIO, val); }
+uint8_t eeconfig_read_audio(void)      { return eeconfig_read_byte(EECONFIG_AUDIO); }
+void eeconfig_update_audio(uint8_t val) { eeconfig_update_byte(EECONFIG_AUDIO, val); }
 #endif
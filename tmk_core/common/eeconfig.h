@@ -33,6 +33,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define EECONFIG_BACKLIGHT                          (uint8_t *)6
 #define EECONFIG_AUDIO                              (uint8_t *)7
 #define EECONFIG_RGBLIGHT                           (uint32_t *)8
+/* size of the area above, which is cached in RAM */
+#define EECONFIG_SIZE                               12
+
+/* changes are written to the eeprom once they have been left alone for this many ms */
+#ifndef EECONFIG_FLUSH_DELAY
+#define EECONFIG_FLUSH_DELAY                        3000
+#endif
 
 
 /* debug bit */
@@ -52,6 +59,21 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define EECONFIG_KEYMAP_NKRO                        (1<<7)
 
 
+/* cached access, addresses outside of the eeconfig area go straight to the eeprom */
+uint8_t eeconfig_read_byte(const uint8_t *addr);
+void eeconfig_update_byte(uint8_t *addr, uint8_t val);
+uint16_t eeconfig_read_word(const uint16_t *addr);
+void eeconfig_update_word(uint16_t *addr, uint16_t val);
+uint32_t eeconfig_read_dword(const uint32_t *addr);
+void eeconfig_update_dword(uint32_t *addr, uint32_t val);
+
+/* writes pending changes after EECONFIG_FLUSH_DELAY, call it regularly */
+void eeconfig_task(void);
+/* writes pending changes now, before a suspend or a reset */
+void eeconfig_flush(void);
+/* number of bytes written to the eeprom so far */
+uint16_t eeconfig_write_count(void);
+
 bool eeconfig_is_enabled(void);
 
 void eeconfig_init(void);
@@ -30,6 +30,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "eeconfig.h"
 #include "backlight.h"
 #include "action_layer.h"
+#include "scheduler.h"
 #ifdef BOOTMAGIC_ENABLE
 #   include "bootmagic.h"
 #else
@@ -185,10 +186,15 @@ MATRIX_LOOP_END:
 	serial_link_update();
 #endif
 
+    // LED frames, and anything else registered with scheduler_add()
+    scheduler_task();
+
 #ifdef VISUALIZER_ENABLE
     visualizer_update(default_layer_state, layer_state, host_keyboard_leds());
 #endif
 
+    eeconfig_task();
+
     // update LED
     if (led_status != host_keyboard_leds()) {
         led_status = host_keyboard_leds();
@@ -0,0 +1,66 @@
+#include "led_fade.h"
+#include "progmem.h"
+
+/* CIE 1931 lightness to luminance, for levels 0, 1024, ... 65536
+ * (0..64).each {|x| l = x/64.0*100; p (((l > 8) ? ((l+16)/116)**3 : l/903.3)*65535).round }
+ */
+static const uint16_t gamma_table[65] PROGMEM = {
+    0,   113,   227,   340,   453,   567,   686,   821,
+  972,  1141,  1328,  1535,  1762,  2010,  2281,  2575,
+ 2894,  3237,  3607,  4004,  4429,  4883,  5367,  5882,
+ 6429,  7009,  7623,  8272,  8956,  9677, 10436, 11234,
+12071, 12948, 13868, 14830, 15835, 16885, 17980, 19121,
+20310, 21547, 22833, 24170, 25558, 26997, 28490, 30037,
+31639, 33297, 35012, 36785, 38616, 40507, 42460, 44473,
+46550, 48690, 50895, 53166, 55503, 57907, 60380, 62922,
+65535,
+};
+
+uint16_t led_gamma(uint16_t level)
+{
+    // Full on has to stay exact, the interpolation stops just short of it
+    if (level == 0xFFFF) {
+        return 0xFFFF;
+    }
+    uint8_t index = level >> 10;
+    uint16_t frac = level & 0x3FF;
+    uint16_t low = pgm_read_word(&gamma_table[index]);
+    uint16_t high = pgm_read_word(&gamma_table[index + 1]);
+    return low + (uint16_t)(((uint32_t)(high - low) * frac) >> 10);
+}
+
+uint16_t led_breathing_level(uint16_t phase)
+{
+    // A triangle, the gamma curve makes it look like a breath
+    if (phase & 0x8000) {
+        phase = ~phase;
+    }
+    return (phase << 1) | (phase >> 14);
+}
+
+void led_fade_start(led_fade_t *fade, uint16_t target, uint16_t frames)
+{
+    uint16_t distance = target > fade->level ? target - fade->level : fade->level - target;
+
+    fade->target = target;
+    if (frames == 0) {
+        fade->level = target;
+        fade->step = 0;
+    } else {
+        // Rounded up, so the fade never takes longer than asked
+        fade->step = ((uint32_t)distance + frames - 1) / frames;
+    }
+}
+
+bool led_fade_next(led_fade_t *fade)
+{
+    if (fade->level == fade->target) {
+        return false;
+    }
+    if (fade->level < fade->target) {
+        fade->level = fade->target - fade->level > fade->step ? fade->level + fade->step : fade->target;
+    } else {
+        fade->level = fade->level - fade->target > fade->step ? fade->level - fade->step : fade->target;
+    }
+    return true;
+}
@@ -0,0 +1,32 @@
+#ifndef LED_FADE_H
+#define LED_FADE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Brightness for PWM driven LEDs
+ *
+ * Levels are perceived brightness, 0 to 0xFFFF, and go through a gamma
+ * curve to a 16-bit PWM duty cycle, see led_gamma(). Fades move the level
+ * a fixed step per frame, so the caller only does the math once a frame,
+ * not once a PWM period.
+ */
+
+typedef struct {
+    uint16_t level;
+    uint16_t target;
+    uint16_t step;
+} led_fade_t;
+
+// Duty cycle for a level, 0 is off and 0xFFFF fully on
+uint16_t led_gamma(uint16_t level);
+
+// Brightness of a breathing cycle, from off at phase 0 to the peak at 0x8000
+uint16_t led_breathing_level(uint16_t phase);
+
+// Fades to target in the given number of frames, 0 jumps there
+void led_fade_start(led_fade_t *fade, uint16_t target, uint16_t frames);
+// Moves one frame, returns false when the target was already reached
+bool led_fade_next(led_fade_t *fade);
+
+#endif
@@ -0,0 +1,99 @@
+#include "scheduler.h"
+#include "timer.h"
+#include "print.h"
+#if defined(__AVR__)
+#include <util/atomic.h>
+#endif
+
+#if defined(PROTOCOL_CHIBIOS) && !defined(SCHEDULER_TIME_RESOLUTION)
+#include "ch.h"
+#if CH_CFG_ST_TIMEDELTA > 0
+// timer_read_us() only moves a tick at a time there
+#define SCHEDULER_TIME_RESOLUTION (1000000 / CH_CFG_ST_FREQUENCY)
+#endif
+#endif
+
+// The us a measured time can be off by, a run only counts as over its
+// budget when it took longer for sure
+#ifndef SCHEDULER_TIME_RESOLUTION
+#define SCHEDULER_TIME_RESOLUTION 1
+#endif
+
+static scheduler_job_t *jobs = NULL;
+static uint16_t deferred = 0;
+
+void scheduler_add(scheduler_job_t *job)
+{
+    scheduler_job_t **place = &jobs;
+
+    // Behind the jobs of the same priority
+    while (*place && (*place)->priority <= job->priority) {
+        if (*place == job) {
+            return;
+        }
+        place = &(*place)->next;
+    }
+    job->next = *place;
+    job->last_run = timer_read();
+    *place = job;
+}
+
+void scheduler_account(scheduler_job_t *job, uint16_t time)
+{
+    job->runs++;
+    job->time = time;
+    if (time > job->time_max) {
+        job->time_max = time;
+    }
+    if (time >= (uint32_t)job->budget + SCHEDULER_TIME_RESOLUTION) {
+        job->overruns++;
+    }
+}
+
+void scheduler_task(void)
+{
+    uint16_t pass_start = timer_read_us();
+    bool ran = false;
+
+    for (scheduler_job_t *job = jobs; job; job = job->next) {
+        if (!job->run) {
+            continue;
+        }
+        if (job->interval && timer_elapsed(job->last_run) < job->interval) {
+            continue;
+        }
+        // At least one job a pass, however long they take
+        if (ran && (uint16_t)(timer_read_us() - pass_start) >= SCHEDULER_PASS_BUDGET) {
+            deferred++;
+            return;
+        }
+
+        uint16_t start = timer_read_us();
+        job->last_run = timer_read();
+        job->run();
+        scheduler_account(job, timer_read_us() - start);
+        ran = true;
+    }
+}
+
+uint16_t scheduler_deferred(void)
+{
+    return deferred;
+}
+
+void scheduler_debug(void)
+{
+    xprintf("scheduler passes deferred: %u\n", deferred);
+    for (scheduler_job_t *job = jobs; job; job = job->next) {
+        scheduler_job_t copy;
+        // Interrupts update theirs at any time
+#if defined(__AVR__)
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            copy = *job;
+        }
+#else
+        copy = *job;
+#endif
+        xprintf("%s: %u runs, %uus, max %uus, %u over %uus\n", copy.name, copy.runs, copy.time, copy.time_max, copy.overruns, copy.budget);
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Periodic jobs of the main loop, and the time they take
+ *
+ * Jobs run from keyboard_task(), highest priority first, once their
+ * interval passed since they last ran. A pass of the main loop stops
+ * starting jobs after SCHEDULER_PASS_BUDGET microseconds, so that the
+ * matrix and USB get their turn, the jobs left over run in the next pass.
+ * Interrupts with work of their own report their time with
+ * scheduler_account(). Every job has a budget, the times it went over are
+ * counted, see scheduler_debug().
+ */
+
+#ifndef SCHEDULER_PASS_BUDGET
+#define SCHEDULER_PASS_BUDGET 1000
+#endif
+
+// Lower runs first
+enum scheduler_priority {
+    SCHEDULER_PRIORITY_AUDIO,
+    SCHEDULER_PRIORITY_RGBLIGHT,
+    SCHEDULER_PRIORITY_BACKLIGHT,
+    SCHEDULER_PRIORITY_LOW,
+};
+
+typedef struct scheduler_job {
+    const char *name;
+    // NULL for an interrupt, which only reports its time
+    void (*run)(void);
+    uint8_t  priority;
+    // ms between runs, 0 runs every pass
+    uint16_t interval;
+    // us a run should take at most
+    uint16_t budget;
+
+    uint16_t last_run;
+    uint16_t runs;
+    uint16_t overruns;
+    // us the last run took, and the longest one
+    uint16_t time;
+    uint16_t time_max;
+    struct scheduler_job *next;
+} scheduler_job_t;
+
+#define SCHEDULER_JOB(job_name, job_run, job_priority, job_interval, job_budget) \
+    { .name = job_name, .run = job_run, .priority = job_priority, \
+      .interval = job_interval, .budget = job_budget }
+
+// The job has to stay around, it's linked into the list
+void scheduler_add(scheduler_job_t *job);
+void scheduler_task(void);
+// Counts a run of an interrupt that took time us
+void scheduler_account(scheduler_job_t *job, uint16_t time);
+// Passes that left jobs for the next one
+uint16_t scheduler_deferred(void);
+void scheduler_debug(void);
+
+#endif
@@ -0,0 +1,80 @@
+#include "gtest/gtest.h"
+#include <cmath>
+extern "C" {
+#include "led_fade.h"
+}
+
+static double cie_luminance(double lightness) {
+    double l = lightness * 100;
+    return l > 8 ? std::pow((l + 16) / 116, 3) : l / 903.3;
+}
+
+TEST(LedFade, the_gamma_curve_ends_at_off_and_fully_on) {
+    EXPECT_EQ(led_gamma(0), 0);
+    EXPECT_EQ(led_gamma(0xFFFF), 0xFFFF);
+}
+
+TEST(LedFade, the_gamma_curve_rises_with_every_level) {
+    uint16_t previous = 0;
+    for (uint32_t level = 1; level <= 0xFFFF; level++) {
+        uint16_t duty = led_gamma(level);
+        ASSERT_GE(duty, previous) << "level " << level;
+        previous = duty;
+    }
+}
+
+TEST(LedFade, the_gamma_curve_follows_cie_lightness) {
+    for (uint32_t level = 0; level <= 0xFFFF; level += 97) {
+        double expected = cie_luminance(level / 65535.0) * 65535;
+        // Linear between the table entries, which are 1024 levels apart
+        ASSERT_NEAR(led_gamma(level), expected, 40) << "level " << level;
+    }
+}
+
+TEST(LedFade, breathing_goes_from_off_to_the_peak_and_back) {
+    EXPECT_EQ(led_breathing_level(0), 0);
+    EXPECT_NEAR(led_breathing_level(0x4000), 0x8000, 1);
+    EXPECT_EQ(led_breathing_level(0x7FFF), 0xFFFF);
+    EXPECT_EQ(led_breathing_level(0x8000), 0xFFFF);
+    EXPECT_NEAR(led_breathing_level(0xC000), 0x8000, 2);
+    EXPECT_EQ(led_breathing_level(0xFFFF), 0);
+}
+
+TEST(LedFade, a_fade_reaches_the_target_in_the_given_frames) {
+    led_fade_t fade = {0, 0, 0};
+    led_fade_start(&fade, 0xFFFF, 8);
+    int frames = 0;
+    uint16_t previous = fade.level;
+    while (led_fade_next(&fade)) {
+        frames++;
+        EXPECT_GT(fade.level, previous);
+        previous = fade.level;
+    }
+    EXPECT_EQ(frames, 8);
+    EXPECT_EQ(fade.level, 0xFFFF);
+}
+
+TEST(LedFade, a_fade_can_go_down_and_change_target_halfway) {
+    led_fade_t fade = {0, 0, 0};
+    led_fade_start(&fade, 40000, 0);
+    EXPECT_EQ(fade.level, 40000);
+    led_fade_start(&fade, 10000, 3);
+    led_fade_next(&fade);
+    EXPECT_EQ(fade.level, 30000);
+    led_fade_start(&fade, 35000, 2);
+    led_fade_next(&fade);
+    led_fade_next(&fade);
+    EXPECT_EQ(fade.level, 35000);
+    EXPECT_FALSE(led_fade_next(&fade));
+}
+
+TEST(LedFade, short_fades_take_no_more_frames_than_asked) {
+    led_fade_t fade = {0, 0, 0};
+    led_fade_start(&fade, 3, 10);
+    int frames = 0;
+    while (led_fade_next(&fade)) {
+        frames++;
+    }
+    EXPECT_EQ(frames, 3);
+    EXPECT_EQ(fade.level, 3);
+}
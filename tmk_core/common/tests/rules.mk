@@ -0,0 +1,8 @@
+led_fade_SRC :=\
+	$(TMK_PATH)/common/tests/led_fade_tests.cpp \
+	$(TMK_PATH)/common/led_fade.c
+
+scheduler_DEFS := -DNO_PRINT
+scheduler_SRC :=\
+	$(TMK_PATH)/common/tests/scheduler_tests.cpp \
+	$(TMK_PATH)/common/scheduler.c
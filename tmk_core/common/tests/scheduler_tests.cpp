@@ -0,0 +1,130 @@
+#include "gtest/gtest.h"
+#include <string>
+extern "C" {
+#include "scheduler.h"
+#include "timer.h"
+}
+
+// The jobs advance the time themselves, by what they cost
+static uint32_t now_us;
+
+extern "C" {
+uint16_t timer_read(void) {
+    return now_us / 1000;
+}
+uint16_t timer_elapsed(uint16_t last) {
+    return TIMER_DIFF_16(timer_read(), last);
+}
+uint16_t timer_read_us(void) {
+    return now_us;
+}
+}
+
+static std::string order;
+
+static void run_audio(void) {
+    order += "a";
+    now_us += 100;
+}
+static void run_rgblight(void) {
+    order += "r";
+    now_us += 600;
+}
+static void run_backlight(void) {
+    order += "b";
+    now_us += 50;
+}
+static void run_slow(void) {
+    order += "s";
+    now_us += 1500;
+}
+
+class Scheduler : public testing::Test {
+public:
+    void SetUp() override {
+        now_us = 0;
+        order.clear();
+    }
+    // Runs the main loop for ms, a pass every 10us, up to and including the last
+    void run_for(uint32_t ms) {
+        uint32_t end = now_us + ms * 1000;
+        while (now_us <= end) {
+            scheduler_task();
+            now_us += 10;
+        }
+    }
+};
+
+// The list lives as long as the test program, so every test has jobs of its own
+TEST_F(Scheduler, jobs_run_in_priority_order) {
+    static scheduler_job_t backlight = SCHEDULER_JOB("backlight", run_backlight, SCHEDULER_PRIORITY_BACKLIGHT, 0, 100);
+    static scheduler_job_t rgblight = SCHEDULER_JOB("rgblight", run_rgblight, SCHEDULER_PRIORITY_RGBLIGHT, 0, 1000);
+    static scheduler_job_t audio = SCHEDULER_JOB("audio", run_audio, SCHEDULER_PRIORITY_AUDIO, 0, 200);
+    scheduler_add(&backlight);
+    scheduler_add(&rgblight);
+    scheduler_add(&audio);
+    scheduler_task();
+    EXPECT_EQ(order, "arb");
+    EXPECT_EQ(audio.time, 100);
+    EXPECT_EQ(rgblight.time, 600);
+    EXPECT_EQ(backlight.time, 50);
+    EXPECT_EQ(audio.overruns + rgblight.overruns + backlight.overruns, 0);
+    // Keep them out of the other tests
+    audio.interval = rgblight.interval = backlight.interval = UINT16_MAX;
+}
+
+TEST_F(Scheduler, a_job_runs_once_an_interval) {
+    static scheduler_job_t backlight = SCHEDULER_JOB("backlight", run_backlight, SCHEDULER_PRIORITY_BACKLIGHT, 16, 100);
+    scheduler_add(&backlight);
+    run_for(160);
+    EXPECT_EQ(order, std::string(10, 'b'));
+    EXPECT_EQ(backlight.runs, 10);
+    backlight.interval = UINT16_MAX;
+}
+
+TEST_F(Scheduler, adding_a_job_twice_keeps_one) {
+    static scheduler_job_t backlight = SCHEDULER_JOB("backlight", run_backlight, SCHEDULER_PRIORITY_LOW, 16, 100);
+    scheduler_add(&backlight);
+    scheduler_add(&backlight);
+    run_for(16);
+    EXPECT_EQ(order, "b");
+    backlight.interval = UINT16_MAX;
+}
+
+TEST_F(Scheduler, runs_over_the_budget_are_counted) {
+    static scheduler_job_t slow = SCHEDULER_JOB("slow", run_slow, SCHEDULER_PRIORITY_LOW, 10, 1000);
+    scheduler_add(&slow);
+    run_for(100);
+    EXPECT_GT(slow.runs, 0);
+    EXPECT_EQ(slow.overruns, slow.runs);
+    EXPECT_EQ(slow.time_max, 1500);
+    slow.interval = UINT16_MAX;
+}
+
+TEST_F(Scheduler, a_pass_over_its_budget_leaves_the_rest_for_the_next) {
+    static scheduler_job_t slow = SCHEDULER_JOB("slow", run_slow, SCHEDULER_PRIORITY_AUDIO, 10, 2000);
+    static scheduler_job_t backlight = SCHEDULER_JOB("backlight", run_backlight, SCHEDULER_PRIORITY_LOW, 10, 100);
+    scheduler_add(&slow);
+    scheduler_add(&backlight);
+    now_us += 10000;
+    uint16_t deferred = scheduler_deferred();
+    scheduler_task();
+    EXPECT_EQ(order, "s");
+    EXPECT_EQ(scheduler_deferred(), deferred + 1);
+    scheduler_task();
+    EXPECT_EQ(order, "sb");
+    slow.interval = backlight.interval = UINT16_MAX;
+}
+
+TEST_F(Scheduler, interrupts_only_report_their_time) {
+    static scheduler_job_t isr = SCHEDULER_JOB("isr", NULL, SCHEDULER_PRIORITY_AUDIO, 0, 40);
+    scheduler_add(&isr);
+    scheduler_task();
+    scheduler_account(&isr, 20);
+    scheduler_account(&isr, 50);
+    scheduler_account(&isr, 30);
+    EXPECT_EQ(isr.runs, 3);
+    EXPECT_EQ(isr.time, 30);
+    EXPECT_EQ(isr.time_max, 50);
+    EXPECT_EQ(isr.overruns, 1);
+}
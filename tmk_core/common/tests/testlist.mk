@@ -0,0 +1,3 @@
+TEST_LIST +=\
+	led_fade \
+	scheduler
@@ -45,6 +45,8 @@ uint16_t timer_read(void);
 uint32_t timer_read32(void);
 uint16_t timer_elapsed(uint16_t last);
 uint32_t timer_elapsed32(uint32_t last);
+// Microseconds, for timing short work, wraps every 65ms
+uint16_t timer_read_us(void);
 
 #ifdef __cplusplus
 }
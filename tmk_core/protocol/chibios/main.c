@@ -32,6 +32,7 @@
 #include "sendchar.h"
 #include "debug.h"
 #include "printf.h"
+#include "eeprom.h"
 #ifdef SLEEP_LED_ENABLE
 #include "sleep_led.h"
 #endif
@@ -182,5 +183,6 @@ int main(void) {
     }
 
     keyboard_task();
+    eeprom_task();
   }
 }
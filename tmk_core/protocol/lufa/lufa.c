@@ -47,6 +47,10 @@
 #ifdef SLEEP_LED_ENABLE
 #include "sleep_led.h"
 #endif
+#ifdef DYNAMIC_KEYMAP_ENABLE
+#include <string.h>
+#include "dynamic_keymap.h"
+#endif
 #include "suspend.h"
 
 #include "descriptor.h"
@@ -164,6 +168,21 @@ USB_ClassInfo_CDC_Device_t cdc_device =
  * Console
  ******************************************************************************/
 #ifdef CONSOLE_ENABLE
+#ifdef DYNAMIC_KEYMAP_ENABLE
+/* Output reports of the console interface come in through SET_REPORT,
+ * and are handled in the main loop, since they write to the eeprom */
+static uint8_t console_report[CONSOLE_EPSIZE];
+static volatile uint8_t console_report_length;
+
+static void Console_Receive_Task(void)
+{
+    if (console_report_length) {
+        dynamic_keymap_process_report(console_report, console_report_length);
+        console_report_length = 0;
+    }
+}
+#endif
+
 static void Console_Task(void)
 {
     /* Device must be connected and configured for the task to run */
@@ -416,6 +435,23 @@ void EVENT_USB_Device_ControlRequest(void)
                     Endpoint_ClearOUT();
                     Endpoint_ClearStatusStage();
                     break;
+#if defined(CONSOLE_ENABLE) && defined(DYNAMIC_KEYMAP_ENABLE)
+                case CONSOLE_INTERFACE:
+                {
+                    uint8_t report[CONSOLE_EPSIZE];
+
+                    Endpoint_ClearSETUP();
+                    ReportSize = MIN(USB_ControlRequest.wLength, sizeof(report));
+                    Endpoint_Read_Control_Stream_LE(report, ReportSize);
+                    Endpoint_ClearStatusStage();
+                    // Dropped while the previous report is being processed
+                    if (!console_report_length) {
+                        memcpy(console_report, report, ReportSize);
+                        console_report_length = ReportSize;
+                    }
+                    break;
+                }
+#endif
                 }
 
             }
@@ -1038,6 +1074,10 @@ int main(void)
 #endif
         keyboard_task();
 
+#if defined(CONSOLE_ENABLE) && defined(DYNAMIC_KEYMAP_ENABLE)
+        Console_Receive_Task();
+#endif
+
 #ifdef VIRTSER_ENABLE
         virtser_task();
         CDC_Device_USBTask(&cdc_device);